@@ -0,0 +1,1227 @@
+// bench.cpp
+// micro benchmarks, build at the optimisation level of interest and compare timings, ie:
+// c++ --std=c++11 -O1 .test/bench.cpp -o .test/bench && ./.test/bench
+
+#include "../vec.h"
+#include "../mat.h"
+#include "../quat.h"
+#include "../maths.h"
+#include "../expr.h"
+#include "../hull.h"
+#include "../bvh.h"
+#include "../sap.h"
+#include "../grid.h"
+#include "../octree.h"
+#include "../reorder.h"
+#include "../anim.h"
+#include "../compress.h"
+#include "../skin.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+namespace
+{
+    typedef std::chrono::high_resolution_clock bench_clock;
+
+    const size_t k_elements = 1 << 12;
+    const size_t k_iterations = 1 << 9;
+    const size_t k_large_iterations = 1 << 4;
+
+    f32 checksum = 0.0f;
+
+    // runs f iterations times and prints the average time per run and per element
+    template <typename F>
+    void bench(const char* name, size_t elements, F f, size_t iterations = k_iterations)
+    {
+        // warm up
+        f();
+
+        auto start = bench_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            f();
+        auto end = bench_clock::now();
+
+        f64 ns = (f64)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        printf("%-40s %10.3f ms %8.3f ns / element\n", name, ns / 1e6 / (f64)iterations, ns / (f64)(iterations * elements));
+    }
+
+    template <size_t N>
+    std::vector<Vec<N, f32>> random_vecs(size_t count)
+    {
+        std::vector<Vec<N, f32>> res(count);
+        for (size_t i = 0; i < count; ++i)
+            for (size_t j = 0; j < N; ++j)
+                res[i][j] = (f32)(rand() % 2000) / 1000.0f - 1.0f;
+        return res;
+    }
+}
+
+void bench_expr()
+{
+    std::vector<vec3f> a = random_vecs<3>(k_elements);
+    std::vector<vec3f> b = random_vecs<3>(k_elements);
+    std::vector<vec3f> c = random_vecs<3>(k_elements);
+    std::vector<vec3f> r(k_elements);
+    f32 f = 0.3f;
+
+    printf("\nexpression templates\n");
+
+    bench("eager a * (1 - f) + b * f", k_elements, [&]() {
+        for (size_t i = 0; i < k_elements; ++i)
+            r[i] = a[i] * (1 - f) + b[i] * f;
+    });
+    checksum += r[0].x;
+
+    bench("lazy a * (1 - f) + b * f", k_elements, [&]() {
+        for (size_t i = 0; i < k_elements; ++i)
+            r[i] = lazy(a[i]) * (1 - f) + b[i] * f;
+    });
+    checksum += r[0].x;
+
+    bench("eager a * b + c * f - a / c.zxy", k_elements, [&]() {
+        for (size_t i = 0; i < k_elements; ++i)
+            r[i] = a[i] * b[i] + c[i] * f - a[i] / c[i].zxy;
+    });
+    checksum += r[0].x;
+
+    bench("lazy a * b + c * f - a / c.zxy", k_elements, [&]() {
+        for (size_t i = 0; i < k_elements; ++i)
+            r[i] = lazy(a[i]) * b[i] + lazy(c[i]) * f - lazy(a[i]) / c[i].zxy;
+    });
+    checksum += r[0].x;
+}
+
+void bench_frustum_cull()
+{
+    const size_t count = 200000;
+    mat4 view_proj = mat::create_perspective_projection(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 100.0f);
+    vec4f planes[6];
+    maths::get_frustum_planes_from_matrix(view_proj, &planes[0]);
+
+    std::vector<vec3f> pos = random_vecs<3>(count);
+    std::vector<vec3f> ext = random_vecs<3>(count);
+    std::vector<vec4f> spheres(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pos[i] *= 100.0f;
+        ext[i] = abs(ext[i]);
+        spheres[i] = vec4f(pos[i], ext[i].x);
+    }
+
+    soa3f soa_pos(pos), soa_ext(ext);
+    soa4f soa_spheres(spheres);
+    std::vector<u32> visible((count + 31) / 32);
+    u32 num_visible = 0;
+
+    printf("\nfrustum culling %i instances\n", (int)count);
+
+    bench("aabb_vs_frustum", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            num_visible += maths::aabb_vs_frustum(pos[i], ext[i], planes) ? 1 : 0;
+    }, k_large_iterations);
+
+    bench("aabb_vs_frustum<4>", count, [&]() { maths::aabb_vs_frustum<4>(soa_pos, soa_ext, planes, visible.data()); });
+    bench("aabb_vs_frustum<8>", count, [&]() { maths::aabb_vs_frustum<8>(soa_pos, soa_ext, planes, visible.data()); });
+    bench("aabb_vs_frustum<16>", count, [&]() { maths::aabb_vs_frustum<16>(soa_pos, soa_ext, planes, visible.data()); });
+
+    bench("sphere_vs_frustum", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            num_visible += maths::sphere_vs_frustum(pos[i], ext[i].x, planes) ? 1 : 0;
+    }, k_large_iterations);
+
+    bench("sphere_vs_frustum<4>", count, [&]() { maths::sphere_vs_frustum<4>(soa_spheres, planes, visible.data()); });
+    bench("sphere_vs_frustum<8>", count, [&]() { maths::sphere_vs_frustum<8>(soa_spheres, planes, visible.data()); });
+    bench("sphere_vs_frustum<16>", count, [&]() { maths::sphere_vs_frustum<16>(soa_spheres, planes, visible.data()); });
+
+    checksum += (f32)(num_visible + visible[0]);
+}
+
+void bench_convex_hull()
+{
+    const size_t count = 1000000;
+    std::vector<vec2f> points(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        f32 a = (f32)(rand() % 10000) / 10000.0f * (f32)M_TWO_PI;
+        f32 r = sqrt((f32)(rand() % 10000) / 10000.0f) * 100.0f;
+        points[i] = vec2f(cos(a) * r, sin(a) * r);
+    }
+
+    std::vector<vec2f> scratch(count), hull(count + 1);
+    size_t hull_size = 0;
+
+    printf("\nconvex hull %i points\n", (int)count);
+
+    bench("convex_hull_from_points 1 thread", count, [&]() {
+        hull_size = maths::convex_hull_from_points(hull.data(), points.data(), count, scratch.data(), 1);
+    }, k_large_iterations);
+
+    bench("convex_hull_from_points", count, [&]() {
+        hull_size = maths::convex_hull_from_points(hull.data(), points.data(), count, scratch.data());
+    }, k_large_iterations);
+
+    checksum += (f32)hull_size;
+}
+
+void bench_convex_hull_3d()
+{
+    const size_t count = 1000000;
+    std::vector<vec3f> points(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        vec3f d = normalised(vec3f(rand() % 2001, rand() % 2001, rand() % 2001) - vec3f(1000.0f));
+        points[i] = d * (f32)(rand() % 1000) / 10.0f;
+    }
+
+    maths::convex_hull hull;
+
+    printf("\nconvex hull 3d %i points\n", (int)count);
+
+    bench("convex_hull_from_points 3d 1 thread", count, [&]() {
+        maths::convex_hull_from_points(hull, points, 0, 1);
+    }, k_large_iterations);
+
+    bench("convex_hull_from_points 3d", count, [&]() {
+        maths::convex_hull_from_points(hull, points);
+    }, k_large_iterations);
+
+    bench("convex_hull_from_points 3d 64 vertices", count, [&]() {
+        maths::convex_hull_from_points(hull, points, 64);
+    }, k_large_iterations);
+
+    checksum += (f32)hull.vertices.size();
+}
+
+void bench_bvh()
+{
+    // triangle soup grid of small triangles
+    const size_t count = 100000;
+    const size_t num_rays = 1000;
+    std::vector<vec3f> vertices = random_vecs<3>(count * 3);
+    std::vector<vec3f> centres = random_vecs<3>(count);
+    for (size_t i = 0; i < count * 3; ++i)
+        vertices[i] = centres[i / 3] * 100.0f + vertices[i];
+
+    std::vector<vec3f> r0 = random_vecs<3>(num_rays);
+    std::vector<vec3f> rv = random_vecs<3>(num_rays);
+    for (size_t i = 0; i < num_rays; ++i)
+    {
+        r0[i] *= 150.0f;
+        rv[i] = normalised(rv[i] * 50.0f - r0[i]);
+    }
+
+    maths::bvh tree;
+    maths::bvh_hit hit;
+    u32 num_hits = 0;
+
+    printf("\nbvh %i triangles, %i queries\n", (int)count, (int)num_rays);
+
+    bench("build_bvh", count, [&]() {
+        maths::build_bvh(tree, vertices, std::vector<u32>());
+    }, k_large_iterations);
+
+    bench("ray_vs_triangle brute force", num_rays, [&]() {
+        for (size_t r = 0; r < num_rays; ++r)
+        {
+            f32 best = FLT_MAX, t;
+            for (size_t i = 0; i < count; ++i)
+                if (maths::ray_vs_triangle(r0[r], rv[r], vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], t))
+                    best = std::min(best, t);
+            num_hits += best != FLT_MAX ? 1 : 0;
+        }
+    }, 1);
+
+    bench("ray_vs_bvh", num_rays, [&]() {
+        for (size_t r = 0; r < num_rays; ++r)
+            num_hits += maths::ray_vs_bvh(tree, r0[r], rv[r], hit) ? 1 : 0;
+    });
+
+    bench("ray_vs_bvh_any", num_rays, [&]() {
+        for (size_t r = 0; r < num_rays; ++r)
+            num_hits += maths::ray_vs_bvh_any(tree, r0[r], rv[r]) ? 1 : 0;
+    });
+
+    bench("closest_point_on_bvh", num_rays, [&]() {
+        for (size_t r = 0; r < num_rays; ++r)
+            num_hits += maths::closest_point_on_bvh(tree, r0[r], hit) ? 1 : 0;
+    });
+
+    // coherent camera rays, rows of 8 neighbouring pixels
+    const size_t res = 128;
+    std::vector<vec3f> cam_r0(res * res, vec3f(0.0f, 0.0f, -150.0f));
+    std::vector<vec3f> cam_rv(res * res);
+    for (size_t y = 0; y < res; ++y)
+        for (size_t x = 0; x < res; ++x)
+            cam_rv[y * res + x] = normalised(vec3f((f32)x / res - 0.5f, (f32)y / res - 0.5f, 1.0f));
+
+    std::vector<maths::bvh_hit> hits(res * res);
+    std::vector<u32> hit_mask((res * res + 31) / 32);
+
+    bench("ray_vs_bvh camera rays", res * res, [&]() {
+        for (size_t r = 0; r < res * res; ++r)
+            num_hits += maths::ray_vs_bvh(tree, cam_r0[r], cam_rv[r], hits[r]) ? 1 : 0;
+    }, k_large_iterations);
+
+    bench("ray_vs_bvh<8> camera rays", res * res, [&]() {
+        maths::ray_vs_bvh<8>(tree, cam_r0.data(), cam_rv.data(), res * res, hits.data(), hit_mask.data());
+    }, k_large_iterations);
+
+    checksum += (f32)(num_hits + hit_mask[0]);
+}
+
+void bench_ray_packets()
+{
+    const size_t count = 1 << 16;
+    std::vector<vec3f> r0 = random_vecs<3>(count);
+    std::vector<vec3f> rv = random_vecs<3>(count);
+    std::vector<vec3f> inv_rv(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        rv[i] = normalised(-r0[i] + rv[i] * 0.1f);
+        r0[i] *= 10.0f;
+        inv_rv[i] = vec3f::one() / rv[i];
+    }
+
+    // packets are transposed once and then tested against many volumes during traversal
+    soa3f soa_r0(r0), soa_rv(rv), soa_inv_rv(inv_rv);
+
+    const vec3f emin(-1.0f), emax(1.0f);
+    const vec3f t0(-1.0f, -1.0f, 0.0f), t1(1.0f, -1.0f, 0.0f), t2(0.0f, 1.0f, 0.0f);
+    u32 num_hits = 0;
+
+    printf("\nray packets %i rays\n", (int)count);
+
+    bench("ray_vs_aabb", count, [&]() {
+        f32 t;
+        for (size_t i = 0; i < count; ++i)
+            num_hits += maths::ray_vs_aabb(emin, emax, r0[i], inv_rv[i], FLT_MAX, t) ? 1 : 0;
+    });
+
+    bench("ray_vs_aabb<8>", count, [&]() {
+        f32x8 t;
+        for (size_t i = 0; i < count; i += 8)
+            num_hits += movemask(maths::ray_vs_aabb(emin, emax, soa_r0.load<8>(i), soa_inv_rv.load<8>(i), f32x8(FLT_MAX), t));
+    });
+
+    bench("ray_vs_triangle", count, [&]() {
+        f32 t;
+        for (size_t i = 0; i < count; ++i)
+            num_hits += maths::ray_vs_triangle(r0[i], rv[i], t0, t1, t2, t) ? 1 : 0;
+    });
+
+    bench("ray_vs_triangle<8>", count, [&]() {
+        f32x8 t;
+        for (size_t i = 0; i < count; i += 8)
+            num_hits += movemask(maths::ray_vs_triangle(soa_r0.load<8>(i), soa_rv.load<8>(i), t0, t1, t2, t));
+    });
+
+    checksum += (f32)num_hits;
+}
+
+void bench_obb_vs_obb()
+{
+    const size_t count = 1 << 14;
+    std::vector<vec3f> pos = random_vecs<3>(count);
+    std::vector<vec3f> rot = random_vecs<3>(count);
+    std::vector<vec3f> scale = random_vecs<3>(count);
+
+    std::vector<mat4> obbs(count);
+    maths::soa_obb soa(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        obbs[i] = mat::create_translation(pos[i] * 20.0f) * mat::create_z_rotation(rot[i].z * (f32)M_PI) *
+                  mat::create_y_rotation(rot[i].y * (f32)M_PI) * mat::create_x_rotation(rot[i].x * (f32)M_PI) *
+                  mat::create_scale(abs(scale[i]) + vec3f(0.1f));
+        soa.set(i, obbs[i]);
+    }
+
+    const mat4 query = mat::create_y_rotation(0.3f) * mat::create_scale(vec3f(4.0f, 2.0f, 1.0f));
+    std::vector<u32> overlap(count / 32);
+    u32 num_overlaps = 0;
+
+    printf("\nobb vs obb %i obbs\n", (int)count);
+
+    bench("obb_vs_obb", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            num_overlaps += maths::obb_vs_obb(query, obbs[i]) ? 1 : 0;
+    }, k_large_iterations * 4);
+
+    bench("obb_vs_obb<8>", count, [&]() {
+        maths::obb_vs_obb<8>(query, soa, overlap.data());
+        num_overlaps += overlap[0];
+    }, k_large_iterations * 4);
+
+    checksum += (f32)num_overlaps;
+}
+
+void bench_sweep_and_prune()
+{
+    const size_t count = 50000;
+    std::vector<vec3f> pos = random_vecs<3>(count);
+    std::vector<vec3f> vel = random_vecs<3>(count);
+    std::vector<vec3f> size = random_vecs<3>(count);
+
+    maths::sweep_and_prune sap;
+    for (size_t i = 0; i < count; ++i)
+    {
+        pos[i] *= 100.0f;
+        vel[i] *= 0.01f;
+        size[i] = abs(size[i]) * 0.5f + vec3f(0.25f);
+        maths::sap_add(sap, pos[i] - size[i], pos[i] + size[i]);
+    }
+
+    printf("\nsweep and prune %i aabbs\n", (int)count);
+
+    maths::sweep_and_prune initial = sap;
+    bench("sap_update (initial)", count, [&]() {
+        sap = initial;
+        maths::sap_update(sap);
+    }, 1);
+
+    // moves every stride'th box a small step per update, the cost is dominated by the number of endpoint swaps
+    size_t events = 0;
+    auto move = [&](size_t stride) {
+        for (size_t i = 0; i < count; i += stride)
+        {
+            pos[i] += vel[i];
+            maths::sap_move(sap, (u32)i, pos[i] - size[i], pos[i] + size[i]);
+        }
+        maths::sap_update(sap);
+        events += sap.added.size() + sap.removed.size();
+    };
+
+    bench("sap_update (all moving)", count, [&]() {
+        move(1);
+    }, k_large_iterations * 4);
+
+    bench("sap_update (10% moving)", count, [&]() {
+        move(10);
+    }, k_large_iterations * 4);
+
+    printf("%i pairs\n", (int)sap.pairs.size());
+    checksum += (f32)events;
+}
+
+void bench_hash_grid()
+{
+    // crowd like distribution, agents spread over a plane
+    const size_t count = 100000;
+    std::vector<vec3f> pos = random_vecs<3>(count);
+    for (size_t i = 0; i < count; ++i)
+        pos[i] *= vec3f(150.0f, 1.0f, 150.0f);
+
+    const f32 radius = 1.0f;
+    maths::hash_grid grid;
+    std::vector<u32> results;
+    std::vector<maths::hash_grid_pair> pairs;
+
+    printf("\nhash grid %i points\n", (int)count);
+
+    bench("build_hash_grid", count, [&]() {
+        maths::build_hash_grid(grid, pos.data(), nullptr, count, radius * 2.0f, 1);
+    }, k_large_iterations);
+
+    bench("hash_grid_query", count, [&]() {
+        results.clear();
+        for (size_t i = 0; i < count; ++i)
+            maths::hash_grid_query(grid, pos[i], radius, results);
+    }, k_large_iterations);
+
+    bench("brute force query (1% of points)", count / 100, [&]() {
+        results.clear();
+        for (size_t i = 0; i < count; i += 100)
+            for (size_t j = 0; j < count; ++j)
+                if (maths::point_inside_sphere(pos[i], radius, pos[j]))
+                    results.push_back((u32)j);
+    }, 1);
+
+    bench("hash_grid_pairs (1 thread)", count, [&]() {
+        maths::hash_grid_pairs(grid, radius, pairs, 1);
+    }, k_large_iterations);
+
+    bench("hash_grid_pairs", count, [&]() {
+        maths::hash_grid_pairs(grid, radius, pairs);
+    }, k_large_iterations);
+
+    printf("%i pairs\n", (int)pairs.size());
+    checksum += (f32)(results.size() + pairs.size());
+}
+
+void bench_octree()
+{
+    const size_t count = 100000;
+    std::vector<vec3f> pos = random_vecs<3>(count);
+    std::vector<vec3f> vel = random_vecs<3>(count);
+    std::vector<vec3f> ext = random_vecs<3>(count);
+
+    maths::octree tree;
+    maths::create_octree(tree, vec3f::zero(), 500.0f, 6);
+    std::vector<u32> ids(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pos[i] *= 500.0f;
+        vel[i] *= 0.1f;
+        ext[i] = abs(ext[i]) + vec3f(0.1f);
+        ids[i] = maths::octree_add(tree, pos[i] - ext[i], pos[i] + ext[i]);
+    }
+
+    mat4 view = mat::create_translation(vec3f(0.0f, 0.0f, 400.0f));
+    mat4 view_proj = mat::create_perspective_projection(-0.5f, 0.5f, -0.5f, 0.5f, 1.0f, 500.0f) * mat::inverse4x4(view);
+    vec4f planes[6];
+    maths::get_frustum_planes_from_matrix(view_proj, &planes[0]);
+
+    std::vector<vec3f> r0 = random_vecs<3>(1000);
+    std::vector<vec3f> rv = random_vecs<3>(1000);
+    for (size_t i = 0; i < r0.size(); ++i)
+    {
+        r0[i] *= 500.0f;
+        rv[i] = normalised(rv[i] + vec3f(0.01f));
+    }
+
+    std::vector<u32> results;
+    printf("\noctree %i aabbs\n", (int)count);
+
+    bench("octree_move", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            pos[i] += vel[i];
+            maths::octree_move(tree, ids[i], pos[i] - ext[i], pos[i] + ext[i]);
+        }
+    }, k_large_iterations);
+
+    bench("aabb_vs_frustum (brute force)", count, [&]() {
+        results.clear();
+        for (size_t i = 0; i < count; ++i)
+            if (maths::aabb_vs_frustum(pos[i], ext[i], planes))
+                results.push_back((u32)i);
+    }, k_large_iterations);
+
+    bench("octree_vs_frustum", count, [&]() {
+        results.clear();
+        maths::octree_vs_frustum(tree, planes, results);
+    }, k_large_iterations);
+
+    bench("ray_vs_aabb (brute force, 10 rays)", 10, [&]() {
+        results.clear();
+        for (size_t r = 0; r < 10; ++r)
+        {
+            vec3f inv_rv = vec3f::one() / rv[r];
+            for (size_t i = 0; i < count; ++i)
+            {
+                f32 t;
+                if (maths::ray_vs_aabb(pos[i] - ext[i], pos[i] + ext[i], r0[r], inv_rv, 200.0f, t))
+                    results.push_back((u32)i);
+            }
+        }
+    }, 1);
+
+    bench("ray_vs_octree", r0.size(), [&]() {
+        results.clear();
+        for (size_t r = 0; r < r0.size(); ++r)
+            maths::ray_vs_octree(tree, r0[r], rv[r], results, 200.0f);
+    }, k_large_iterations);
+
+    checksum += (f32)results.size();
+}
+
+void bench_space_filling_curves()
+{
+    const size_t count = 1 << 20;
+    std::vector<vec3f> points = random_vecs<3>(count);
+    std::vector<u32> codes32(count);
+    std::vector<u64> codes64(count);
+    vec3f bmin = vec3f(-1.0f);
+    vec3f bmax = vec3f(1.0f);
+    maths::curve_quantiser q10(bmin, bmax, 10);
+    maths::curve_quantiser q21(bmin, bmax, 21);
+
+    printf("\nspace filling curves %i points, bmi2 %s\n", (int)count, cpu_supports_bmi2() ? "yes" : "no");
+
+    bench("morton_encode u32 (shift and mask)", count, [&]() {
+        maths::morton_encode_generic(points.data(), count, q10, codes32.data());
+    }, k_large_iterations);
+
+    bench("morton_encode u32", count, [&]() {
+        maths::morton_encode(points.data(), count, bmin, bmax, codes32.data());
+    }, k_large_iterations);
+
+    bench("morton_encode u64 (shift and mask)", count, [&]() {
+        maths::morton_encode_generic(points.data(), count, q21, codes64.data());
+    }, k_large_iterations);
+
+    bench("morton_encode u64", count, [&]() {
+        maths::morton_encode(points.data(), count, bmin, bmax, codes64.data());
+    }, k_large_iterations);
+
+    bench("hilbert_encode u32 (shift and mask)", count, [&]() {
+        maths::hilbert_encode_generic(points.data(), count, q10, 10, codes32.data());
+    }, k_large_iterations);
+
+    bench("hilbert_encode u32", count, [&]() {
+        maths::hilbert_encode(points.data(), count, bmin, bmax, codes32.data());
+    }, k_large_iterations);
+
+    bench("hilbert_encode u64", count, [&]() {
+        maths::hilbert_encode(points.data(), count, bmin, bmax, codes64.data());
+    }, k_large_iterations);
+
+    checksum += (f32)(codes32[count / 2] & 0xff) + (f32)(codes64[count / 2] & 0xff);
+}
+
+void bench_spatial_reorder()
+{
+    // grid mesh with vertices and triangles shuffled, as meshes and point clouds often arrive
+    const u32 res = 1024;
+    const size_t num_verts = res * res;
+    std::vector<vec3f> verts(num_verts);
+    std::vector<u32> shuffle(num_verts);
+    for (size_t i = 0; i < num_verts; ++i)
+        shuffle[i] = (u32)i;
+    for (size_t i = num_verts - 1; i > 0; --i)
+        std::swap(shuffle[i], shuffle[hash_u32((u32)i) % (i + 1)]);
+    for (u32 y = 0; y < res; ++y)
+        for (u32 x = 0; x < res; ++x)
+            verts[shuffle[y * res + x]] = vec3f((f32)x, sin((f32)x * 0.1f) * cos((f32)y * 0.1f), (f32)y);
+
+    std::vector<u32> tris;
+    for (u32 y = 0; y < res - 1; ++y)
+        for (u32 x = 0; x < res - 1; ++x)
+        {
+            u32 i = y * res + x;
+            u32 q[6] = {i, i + res, i + 1, i + 1, i + res, i + res + 1};
+            for (u32 j = 0; j < 6; ++j)
+                tris.push_back(shuffle[q[j]]);
+        }
+    size_t num_tris = tris.size() / 3;
+    std::vector<u32> tri_order(num_tris);
+    for (size_t i = 0; i < num_tris; ++i)
+        tri_order[i] = (u32)i;
+    for (size_t i = num_tris - 1; i > 0; --i)
+        std::swap(tri_order[i], tri_order[hash_u32((u32)i * 3) % (i + 1)]);
+    std::vector<u32> indices(tris.size());
+    for (size_t i = 0; i < num_tris; ++i)
+        for (u32 j = 0; j < 3; ++j)
+            indices[i * 3 + j] = tris[tri_order[i] * 3 + j];
+
+    std::vector<vec3f> normals(num_verts);
+    auto vertex_normals = [&](const std::vector<vec3f>& v, const std::vector<u32>& idx) {
+        std::fill(normals.begin(), normals.end(), vec3f::zero());
+        for (size_t i = 0; i < idx.size(); i += 3)
+        {
+            vec3f n = cross(v[idx[i + 1]] - v[idx[i]], v[idx[i + 2]] - v[idx[i]]);
+            normals[idx[i]] += n;
+            normals[idx[i + 1]] += n;
+            normals[idx[i + 2]] += n;
+        }
+    };
+
+    vec3f bmin = vec3f(0.0f, -1.0f, 0.0f);
+    vec3f bmax = vec3f((f32)res, 1.0f, (f32)res);
+    auto closest_points = [&](const std::vector<vec3f>& v, const std::vector<u32>& idx) {
+        f32 d = 0.0f;
+        for (size_t i = 0; i < idx.size(); ++i)
+            d += dist2(v[idx[i]], maths::closest_point_on_aabb(v[idx[i]] * 2.0f, bmin, bmax));
+        return d;
+    };
+
+    printf("\nspatial reorder %i vertices %i triangles\n", (int)num_verts, (int)num_tris);
+
+    bench("vertex normals (shuffled)", num_tris, [&]() { vertex_normals(verts, indices); }, k_large_iterations);
+    bench("closest_point_on_aabb (shuffled)", indices.size(), [&]() {
+        checksum += closest_points(verts, indices);
+    }, k_large_iterations);
+
+    std::vector<u32> perm, inv(num_verts);
+    std::vector<vec3f> sorted(num_verts);
+    std::vector<u32> sorted_indices(indices.size());
+    bench("spatial_sort", num_verts, [&]() {
+        maths::spatial_sort(verts.data(), num_verts, perm);
+    }, 4);
+
+    bench("reorder vertices and triangles", num_verts, [&]() {
+        // triangles are sorted by their first vertex so they walk the vertices in order
+        maths::reorder(verts.data(), perm.data(), num_verts, sorted.data());
+        maths::invert_permutation(perm.data(), num_verts, inv.data());
+
+        std::vector<u32> tri_keys(num_tris), tri_perm(num_tris);
+        for (size_t i = 0; i < num_tris; ++i)
+        {
+            tri_keys[i] = inv[indices[i * 3]];
+            tri_perm[i] = (u32)i;
+        }
+        maths::radix_sort(tri_keys.data(), tri_perm.data(), num_tris);
+        for (size_t i = 0; i < num_tris; ++i)
+            for (u32 j = 0; j < 3; ++j)
+                sorted_indices[i * 3 + j] = inv[indices[tri_perm[i] * 3 + j]];
+    }, 4);
+
+    bench("vertex normals (sorted)", num_tris, [&]() { vertex_normals(sorted, sorted_indices); }, k_large_iterations);
+    bench("closest_point_on_aabb (sorted)", indices.size(), [&]() {
+        checksum += closest_points(sorted, sorted_indices);
+    }, k_large_iterations);
+
+    checksum += normals[0].y;
+}
+
+void bench_batch_transform()
+{
+    struct vertex
+    {
+        vec3f pos;
+        vec3f normal;
+        vec2f uv;
+    };
+
+    const size_t count = 1 << 20;
+    std::vector<vertex> src(count), dst(count);
+    std::vector<vec3f> rnd = random_vecs<3>(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        src[i].pos = rnd[i] * 100.0f;
+        src[i].normal = normalised(rnd[i] + vec3f(0.01f));
+        src[i].uv = rnd[i].xy;
+    }
+
+    mat4 m = mat::create_translation(vec3f(1.0f, 2.0f, 3.0f)) * mat::create_y_rotation(0.5f) *
+             mat::create_scale(vec3f(2.0f, 1.0f, 0.5f));
+
+    printf("\nbatch transform %i interleaved vertices (%i bytes each)\n", (int)count, (int)sizeof(vertex));
+
+    bench("memcpy (bandwidth reference)", count, [&]() {
+        memcpy(dst.data(), src.data(), count * sizeof(vertex));
+    }, k_large_iterations);
+
+    bench("transform_vector loop", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            dst[i].pos = m.transform_vector(src[i].pos);
+    }, k_large_iterations);
+
+    bench("transform_points", count, [&]() {
+        mat::transform_points(m, &src[0].pos, sizeof(vertex), &dst[0].pos, sizeof(vertex), count);
+    }, k_large_iterations);
+
+    std::vector<vec3f> packed(count);
+    bench("transform_points (packed)", count, [&]() {
+        mat::transform_points(m, &src[0].pos, sizeof(vertex), &packed[0], sizeof(vec3f), count);
+    }, k_large_iterations);
+
+    bench("transform_points (packed, non temporal)", count, [&]() {
+        mat::transform_points(m, &src[0].pos, sizeof(vertex), &packed[0], sizeof(vec3f), count, true);
+    }, k_large_iterations);
+
+    bench("transform_points + normals", count, [&]() {
+        mat::transform_points(m, &src[0].pos, sizeof(vertex), &dst[0].pos, sizeof(vertex), count);
+        mat::transform_normals(m, &src[0].normal, sizeof(vertex), &dst[0].normal, sizeof(vertex), count);
+    }, k_large_iterations);
+
+    checksum += dst[count / 2].pos.x + dst[count / 2].normal.y;
+}
+
+void bench_affine()
+{
+    // transform hierarchy where each node's parent comes before it
+    const size_t count = 1 << 16;
+    std::vector<u32> parent(count);
+    std::vector<mat4> local4(count), world4(count);
+    std::vector<mat34> local34(count), world34(count);
+    std::vector<vec3f> rnd = random_vecs<3>(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        parent[i] = i > 0 ? (u32)(rand() % i) : 0;
+        local4[i] = mat::create_translation(rnd[i]) * mat::create_rotation(normalised(rnd[i] + vec3f(0.1f)), rnd[i].x);
+        local34[i] = mat::to3x4(local4[i]);
+    }
+    world4[0] = local4[0];
+    world34[0] = local34[0];
+
+    printf("\naffine hierarchy %i nodes\n", (int)count);
+
+    bench("mat4 world = parent * local", count, [&]() {
+        for (size_t i = 1; i < count; ++i)
+            world4[i] = world4[parent[i]] * local4[i];
+    }, k_large_iterations);
+
+    bench("mat34 world = parent * local", count, [&]() {
+        for (size_t i = 1; i < count; ++i)
+            world34[i] = world34[parent[i]] * local34[i];
+    }, k_large_iterations);
+
+    bench("inverse4x4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            local4[i] = mat::inverse4x4(world4[i]);
+    }, k_large_iterations);
+
+    bench("inverse3x4 (mat34)", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            local34[i] = mat::inverse3x4(world34[i]);
+    }, k_large_iterations);
+
+    checksum += world4[count - 1].m[3] + world34[count - 1].m[3] + local4[1].m[0] + local34[1].m[0];
+}
+
+void bench_mat_multiply()
+{
+    const size_t count = k_elements;
+    std::vector<mat4> a(count), b(count), o(count);
+    std::vector<Mat<4, 4, f64>> ad(count), bd(count), od(count);
+    std::vector<vec4f> v = random_vecs<4>(count), ov(count);
+    std::vector<Vec<4, f64>> vd(count), ovd(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t j = 0; j < 16; ++j)
+        {
+            a[i].m[j] = (f32)(rand() % 2000) / 1000.0f - 1.0f;
+            b[i].m[j] = (f32)(rand() % 2000) / 1000.0f - 1.0f;
+            ad[i].m[j] = a[i].m[j];
+            bd[i].m[j] = b[i].m[j];
+        }
+        vd[i] = Vec<4, f64>(v[i].x, v[i].y, v[i].z, v[i].w);
+    }
+
+    printf("\nmat4 multiply\n");
+
+    bench("mat4 * mat4 (generic)", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            o[i] = mat_multiply<4, 4, f32>(a[i], b[i]);
+    });
+
+    bench("mat4 * mat4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            o[i] = a[i] * b[i];
+    });
+
+    bench("mat4 * vec4 (generic)", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            ov[i] = mat_multiply<4, 4, f32>(a[i], v[i]);
+    });
+
+    bench("mat4 * vec4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            ov[i] = a[i] * v[i];
+    });
+
+    bench("mat4d * mat4d (generic)", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            od[i] = mat_multiply<4, 4, f64>(ad[i], bd[i]);
+    });
+
+    bench("mat4d * mat4d", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            od[i] = ad[i] * bd[i];
+    });
+
+    bench("mat4d * vec4d (generic)", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            ovd[i] = mat_multiply<4, 4, f64>(ad[i], vd[i]);
+    });
+
+    bench("mat4d * vec4d", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            ovd[i] = ad[i] * vd[i];
+    });
+
+    checksum += o[1].m[5] + ov[1].y + (f32)od[1].m[5] + (f32)ovd[1].y;
+}
+
+void bench_batch_inverse()
+{
+    const size_t count = k_elements;
+    std::vector<mat4> mats(count), inv(count), nm(count);
+    std::vector<vec3f> axes = random_vecs<3>(count);
+    soa_mat4f soa(count), soa_inv;
+    soa_mat3f soa_nm;
+    for (size_t i = 0; i < count; ++i)
+    {
+        mats[i] = mat::create_translation(axes[i]) * mat::create_rotation(normalised(axes[i] + vec3f(0.1f)), (f32)i) *
+                  mat::create_scale(vec3f(1.0f + axes[i].x * 0.5f));
+        soa.set(i, Vec<16, f32>(mats[i].m));
+    }
+
+    printf("\nbatch inverse\n");
+
+    bench("mat::inverse4x4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            inv[i] = mat::inverse4x4(mats[i]);
+    });
+
+    bench("inverse4x4 soa", count, [&]() {
+        maths::inverse4x4(soa, soa_inv);
+    });
+
+    bench("mat::inverse4x4 + inverse3x3 transposed", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            inv[i] = mat::inverse4x4(mats[i]);
+            nm[i] = mat::inverse3x3(mats[i]).transposed();
+        }
+    });
+
+    bench("inverse4x4 + normal matrix soa (fused)", count, [&]() {
+        maths::inverse4x4(soa, soa_inv, soa_nm);
+    });
+
+    checksum += inv[1].m[5] + nm[1].m[5] + soa_inv.component(5)[1] + soa_nm.component(4)[1];
+}
+
+void bench_mat_layout()
+{
+    const size_t count = k_elements;
+    std::vector<mat4> a(count), b(count), o(count);
+    std::vector<mat4_cm> ac(count), bc(count), oc(count);
+    std::vector<vec4f> v = random_vecs<4>(count), ov(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t j = 0; j < 16; ++j)
+        {
+            a[i].m[j] = (f32)(rand() % 2000) / 1000.0f - 1.0f;
+            b[i].m[j] = (f32)(rand() % 2000) / 1000.0f - 1.0f;
+        }
+        ac[i] = a[i];
+        bc[i] = b[i];
+    }
+
+    printf("\nmat4 layout\n");
+
+    bench("row major mat4 * mat4 + transpose", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            o[i] = (a[i] * b[i]).transposed();
+    });
+
+    bench("column major mat4 * mat4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            oc[i] = ac[i] * bc[i];
+    });
+
+    bench("row major mat4 * vec4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            ov[i] = a[i] * v[i];
+    });
+
+    bench("column major mat4 * vec4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            ov[i] = ac[i] * v[i];
+    });
+
+    checksum += o[1].m[5] + oc[1].m[5] + ov[1].y;
+}
+
+void bench_quat_slerp()
+{
+    // a frame of joint rotations
+    const size_t count = 40000;
+    std::vector<quat> a(count), b(count), o(count);
+    std::vector<f32> t(count);
+    soa_quatf sa(count), sb(count), so;
+    for (size_t i = 0; i < count; ++i)
+    {
+        a[i] = quat((f32)(rand() % 360), (f32)(rand() % 360), (f32)(rand() % 360));
+        b[i] = quat((f32)(rand() % 360), (f32)(rand() % 360), (f32)(rand() % 360));
+        t[i] = (f32)(rand() % 1000) / 1000.0f;
+        sa.set(i, vec4f(a[i].x, a[i].y, a[i].z, a[i].w));
+        sb.set(i, vec4f(b[i].x, b[i].y, b[i].z, b[i].w));
+    }
+
+    printf("\nquat slerp\n");
+
+    bench("slerp", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            o[i] = slerp(a[i], b[i], t[i]);
+    });
+
+    bench("slerp soa", count, [&]() {
+        maths::slerp(sa, sb, t.data(), so);
+    });
+
+    bench("lerp", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            o[i] = lerp(a[i], b[i], t[i]);
+    });
+
+    bench("nlerp soa", count, [&]() {
+        maths::nlerp(sa, sb, t.data(), so);
+    });
+
+    checksum += o[1].x + so.component(0)[1];
+}
+
+void bench_anim_sample()
+{
+    // 500 instances of an 80 joint clip, 40k joints per frame
+    const size_t joints = 80;
+    const size_t instances = 500;
+    const u32    num_keys = 60;
+    std::vector<maths::anim_channel_keys> keys(joints);
+    for (size_t c = 0; c < joints; ++c)
+    {
+        for (u32 k = 0; k < num_keys; ++k)
+        {
+            f32 t = (f32)k / 30.0f;
+            keys[c].translation_times.push_back(t);
+            keys[c].translations.push_back(vec3f((f32)(rand() % 100), (f32)(rand() % 100), (f32)(rand() % 100)));
+            keys[c].rotation_times.push_back(t);
+            keys[c].rotations.push_back(quat((f32)(rand() % 360), (f32)(rand() % 360), (f32)(rand() % 360)));
+            keys[c].scale_times.push_back(t);
+            keys[c].scales.push_back(vec3f(1.0f + (f32)(rand() % 100) / 100.0f));
+        }
+    }
+
+    maths::anim_clip clip;
+    maths::create_anim_clip(clip, keys.data(), joints);
+
+    std::vector<maths::anim_cursor> cursors(instances);
+    std::vector<f32> time(instances);
+    for (size_t i = 0; i < instances; ++i)
+        time[i] = fmod((f32)i * 0.137f, clip.duration);
+
+    std::vector<maths::transform> pose(joints * instances);
+    std::vector<mat34> mats(joints * instances);
+    f32 dt = 1.0f / 60.0f;
+
+    printf("\nanim sample\n");
+
+    // searching keys per channel and sampling with the scalar functions
+    bench("binary search + slerp / lerp", joints * instances, [&]() {
+        for (size_t i = 0; i < instances; ++i)
+        {
+            time[i] = fmod(time[i] + dt, clip.duration);
+            for (size_t c = 0; c < joints; ++c)
+            {
+                const maths::anim_channel_keys& ck = keys[c];
+                size_t k = std::upper_bound(ck.rotation_times.begin(), ck.rotation_times.end(), time[i]) - ck.rotation_times.begin() - 1;
+                size_t k1 = std::min(k + 1, ck.rotation_times.size() - 1);
+                f32 u = k1 > k ? (time[i] - ck.rotation_times[k]) / (ck.rotation_times[k1] - ck.rotation_times[k]) : 0.0f;
+                maths::transform& out = pose[i * joints + c];
+                out.translation = lerp(ck.translations[k], ck.translations[k1], u);
+                out.rotation = slerp(ck.rotations[k], ck.rotations[k1], u);
+                out.scale = lerp(ck.scales[k], ck.scales[k1], u);
+            }
+        }
+    }, 10);
+
+    bench("anim_sample transform", joints * instances, [&]() {
+        for (size_t i = 0; i < instances; ++i)
+        {
+            time[i] = fmod(time[i] + dt, clip.duration);
+            maths::anim_sample(clip, cursors[i], time[i], &pose[i * joints]);
+        }
+    }, 10);
+
+    bench("anim_sample mat34", joints * instances, [&]() {
+        for (size_t i = 0; i < instances; ++i)
+        {
+            time[i] = fmod(time[i] + dt, clip.duration);
+            maths::anim_sample(clip, cursors[i], time[i], &mats[i * joints]);
+        }
+    }, 10);
+
+    checksum += pose[1].rotation.x + mats[1].m[5];
+}
+
+void bench_quat_compress()
+{
+    // a frame of joint rotations
+    const size_t count = 40000;
+    std::vector<quat> q(count), o(count);
+    std::vector<u32> p32(count);
+    std::vector<maths::packed_quat48> p48(count);
+    soa_quatf sq(count), so;
+    for (size_t i = 0; i < count; ++i)
+    {
+        q[i] = quat((f32)(rand() % 360), (f32)(rand() % 360), (f32)(rand() % 360));
+        sq.set(i, vec4f(q[i].x, q[i].y, q[i].z, q[i].w));
+    }
+
+    printf("\nquat compress\n");
+
+    bench("pack quat32", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            p32[i] = maths::pack_quat32(q[i]);
+    });
+
+    bench("pack quat32 soa", count, [&]() {
+        maths::pack_quat32(sq, p32.data());
+    });
+
+    bench("unpack quat32", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            o[i] = maths::unpack_quat32(p32[i]);
+    });
+
+    bench("unpack quat32 soa", count, [&]() {
+        maths::unpack_quat32(p32.data(), count, so);
+    });
+
+    bench("pack quat48 soa", count, [&]() {
+        maths::pack_quat48(sq, p48.data());
+    });
+
+    bench("unpack quat48 soa", count, [&]() {
+        maths::unpack_quat48(p48.data(), count, so);
+    });
+
+    // error per bit budget with the bytes of a packed quaternion, translations are in a 100 unit range
+    std::vector<vec3f> t(count);
+    for (size_t i = 0; i < count; ++i)
+        t[i] = vec3f((f32)(rand() % 10000), (f32)(rand() % 10000), (f32)(rand() % 10000)) / 100.0f;
+
+    printf("\n%-6s%-8s%-24s%-24s\n", "bits", "bytes", "rotation max / mean deg", "translation max / mean");
+    for (u32 bits = 8; bits <= 20; bits += 2)
+    {
+        maths::quantise_error qe = maths::quat_quantise_error(q.data(), count, bits);
+        maths::quantise_error te = maths::vec3_quantise_error(t.data(), count, vec3f::zero(), vec3f(100.0f), bits);
+        printf("%-6u%-8u%-12.5f%-12.5f%-12.5f%-12.5f\n", bits, (2 + 3 * bits + 7) / 8,
+               qe.max_error * 180.0f / F_PI, qe.mean_error * 180.0f / F_PI, te.max_error, te.mean_error);
+    }
+
+    checksum += o[1].x + so.component(0)[1] + (f32)p32[1];
+}
+
+void bench_compose_affine()
+{
+    // world matrices for a frame of objects
+    const size_t count = k_elements;
+    std::vector<maths::transform> t(count);
+    std::vector<mat4> m4(count);
+    std::vector<mat34> m34(count);
+    soa3f st(count), ss(count);
+    soa_quatf sr(count);
+    std::vector<vec3f> rnd = random_vecs<3>(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        t[i].translation = rnd[i] * 100.0f;
+        t[i].rotation = quat((f32)(rand() % 360), (f32)(rand() % 360), (f32)(rand() % 360));
+        t[i].scale = vec3f(1.0f) + abs(rnd[i]);
+        st.set(i, t[i].translation);
+        sr.set(i, vec4f(t[i].rotation.v));
+        ss.set(i, t[i].scale);
+    }
+
+    printf("\ncompose affine %i transforms\n", (int)count);
+
+    bench("get_matrix + translation * rot * scale", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            mat4 rot;
+            t[i].rotation.get_matrix(rot);
+            m4[i] = mat::create_translation(t[i].translation) * rot * mat::create_scale(t[i].scale);
+        }
+    });
+
+    bench("get_matrix_from_transform", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+            m4[i] = maths::get_matrix_from_transform(t[i]);
+    });
+
+    bench("compose_affine soa mat4", count, [&]() {
+        maths::compose_affine(st, sr, ss, m4.data());
+    });
+
+    bench("compose_affine soa mat34", count, [&]() {
+        maths::compose_affine(st, sr, ss, m34.data());
+    });
+
+    checksum += m4[1].m[0] + m34[1].m[5];
+}
+
+void bench_skin()
+{
+    // a 64 bone character, 4 influences per vertex
+    const size_t num_bones = 64;
+    const size_t count = 1 << 16;
+    std::vector<maths::transform> t(num_bones);
+    std::vector<mat4> mats(num_bones);
+    std::vector<dual_quat> bones(num_bones);
+    for (size_t i = 0; i < num_bones; ++i)
+    {
+        t[i].rotation = quat((f32)(rand() % 360), (f32)(rand() % 360), (f32)(rand() % 360));
+        t[i].translation = vec3f((f32)(rand() % 100), (f32)(rand() % 100), (f32)(rand() % 100));
+        mats[i] = maths::get_matrix_from_transform(t[i]);
+        bones[i] = maths::get_dual_quat_from_transform(t[i]);
+    }
+
+    std::vector<vec3f> rnd = random_vecs<3>(count);
+    std::vector<u32> indices(count * 4);
+    std::vector<vec4f> w(count);
+    std::vector<vec3f> pos(count), nrm(count), out_pos(count), out_nrm(count);
+    soa4f weights(count);
+    soa3f positions(count), normals(count), sp, sn;
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t k = 0; k < 4; ++k)
+            indices[i * 4 + k] = (u32)(rand() % num_bones);
+        w[i] = vec4f(1.0f + (f32)(rand() % 100), (f32)(rand() % 100), (f32)(rand() % 50), (f32)(rand() % 10));
+        w[i] /= w[i].x + w[i].y + w[i].z + w[i].w;
+        pos[i] = rnd[i] * 100.0f;
+        nrm[i] = normalised(rnd[i] + vec3f(0.01f));
+        weights.set(i, w[i]);
+        positions.set(i, pos[i]);
+        normals.set(i, nrm[i]);
+    }
+
+    printf("\nskin %i vertices, 4 influences\n", (int)count);
+
+    bench("linear blend mat4", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const u32* b = &indices[i * 4];
+            mat4 m = mats[b[0]] * w[i].x;
+            for (size_t k = 1; k < 4; ++k)
+                for (size_t j = 0; j < 12; ++j)
+                    m.m[j] += mats[b[k]].m[j] * w[i][k];
+            out_pos[i] = m.transform_vector(pos[i]);
+            out_nrm[i] = normalised(m.transform_vector(vec4f(nrm[i], 0.0f)).xyz);
+        }
+    }, 10);
+
+    bench("dual quat blend", count, [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const u32* b = &indices[i * 4];
+            dual_quat dqs[4] = {bones[b[0]], bones[b[1]], bones[b[2]], bones[b[3]]};
+            dual_quat dq = blend(dqs, &w[i].x, 4);
+            out_pos[i] = dq.transform_point(pos[i]);
+            out_nrm[i] = dq.transform_vector(nrm[i]);
+        }
+    }, 10);
+
+    bench("skin_dual_quat soa (1 thread)", count, [&]() {
+        maths::skin_dual_quat(bones.data(), indices.data(), weights, positions, normals, sp, sn, 1);
+    }, 10);
+
+    bench("skin_dual_quat soa", count, [&]() {
+        maths::skin_dual_quat(bones.data(), indices.data(), weights, positions, normals, sp, sn);
+    }, 10);
+
+    checksum += out_pos[1].x + out_nrm[1].y + sp.component(0)[1] + sn.component(1)[1];
+}
+
+int main()
+{
+    bench_expr();
+    bench_frustum_cull();
+    bench_convex_hull();
+    bench_convex_hull_3d();
+    bench_bvh();
+    bench_ray_packets();
+    bench_obb_vs_obb();
+    bench_sweep_and_prune();
+    bench_hash_grid();
+    bench_octree();
+    bench_space_filling_curves();
+    bench_spatial_reorder();
+    bench_batch_transform();
+    bench_affine();
+    bench_mat_multiply();
+    bench_batch_inverse();
+    bench_mat_layout();
+    bench_quat_slerp();
+    bench_compose_affine();
+    bench_anim_sample();
+    bench_quat_compress();
+    bench_skin();
+
+    printf("\nchecksum %f\n", checksum);
+    return 0;
+}
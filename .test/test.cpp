@@ -2,7 +2,19 @@
 #include "../mat.h"
 #include "../quat.h"
 #include "../maths.h"
+#include "../soa.h"
+#include "../expr.h"
+#include "../hull.h"
+#include "../bvh.h"
+#include "../sap.h"
+#include "../grid.h"
+#include "../octree.h"
+#include "../reorder.h"
+#include "../anim.h"
+#include "../compress.h"
+#include "../skin.h"
 #include <stdio.h>
+#include <set>
 
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
@@ -619,6 +631,186 @@ TEST_CASE("geometric funcs", "[vec/swizzle]")
     REQUIRE(require_func(pp2, vec2f(-1.0f, 0.0f)));
 }
 
+TEST_CASE("vec4 simd operators", "[vec]")
+{
+    vec4f a = vec4f(1.0f, -2.0f, 3.5f, 4.0f);
+    vec4f b = vec4f(0.5f, 8.0f, -1.0f, 2.0f);
+    
+    REQUIRE(require_func(a + b, {1.5f, 6.0f, 2.5f, 6.0f}));
+    REQUIRE(require_func(a - b, {0.5f, -10.0f, 4.5f, 2.0f}));
+    REQUIRE(require_func(a * b, {0.5f, -16.0f, -3.5f, 8.0f}));
+    REQUIRE(require_func(a / b, {2.0f, -0.25f, -3.5f, 2.0f}));
+    REQUIRE(require_func(a * 2.0f, {2.0f, -4.0f, 7.0f, 8.0f}));
+    REQUIRE(require_func(2.0f * a, {2.0f, -4.0f, 7.0f, 8.0f}));
+    REQUIRE(require_func(a / 2.0f, {0.5f, -1.0f, 1.75f, 2.0f}));
+    REQUIRE(require_func(a + 1.0f, {2.0f, -1.0f, 4.5f, 5.0f}));
+    REQUIRE(require_func(-a, {-1.0f, 2.0f, -3.5f, -4.0f}));
+    
+    vec4f c = a;
+    c += b;
+    c *= 2.0f;
+    c -= a;
+    c /= b;
+    REQUIRE(require_func(c, {4.0f, 1.75f, -1.5f, 4.0f}));
+    
+    REQUIRE(require_func(dot(a, b), -11.0f));
+    REQUIRE(require_func(mag2(a), 33.25f));
+    REQUIRE(require_func(dist2(a, b), 124.5f));
+    REQUIRE(require_func(mag(normalised(a)), 1.0f));
+    REQUIRE(require_func(min_union(a, b), {0.5f, -2.0f, -1.0f, 2.0f}));
+    REQUIRE(require_func(max_union(a, b), {1.0f, 8.0f, 3.5f, 4.0f}));
+    REQUIRE(require_func(lerp(a, b, 0.5f), {0.75f, 3.0f, 1.25f, 3.0f}));
+    REQUIRE(require_func(clamp(a, -1.0f, 3.0f), {1.0f, -1.0f, 3.0f, 3.0f}));
+    
+    // swizzles still alias the components
+    vec4f sw = a.wzyx + b;
+    REQUIRE(require_func(sw, {4.5f, 11.5f, -3.0f, 3.0f}));
+    
+    Vec4d ad = Vec4d(1.0, -2.0, 3.5, 4.0);
+    Vec4d bd = Vec4d(0.5, 8.0, -1.0, 2.0);
+    REQUIRE(require_func((f32)dot(ad, bd), -11.0f));
+    REQUIRE(require_func((f32)mag2(ad - bd), 124.5f));
+}
+
+TEST_CASE("vec3a padded", "[vec]")
+{
+    REQUIRE(sizeof(vec3fa) == 16);
+    REQUIRE(alignof(vec3fa) == 16);
+    
+    vec3fa a = vec3fa(1.0f, 2.0f, 3.0f);
+    vec3fa b = vec3f(-4.0f, 0.5f, 2.0f);
+    
+    REQUIRE(require_func((vec3f)(a + b), {-3.0f, 2.5f, 5.0f}));
+    REQUIRE(require_func((vec3f)(a / b), {-0.25f, 4.0f, 1.5f}));
+    REQUIRE(require_func((vec3f)(a - 1.0f), {0.0f, 1.0f, 2.0f}));
+    REQUIRE(require_func(dot(a / b, a), 12.25f));
+    REQUIRE(require_func(dot(a - 1.0f, b), 4.5f));
+    REQUIRE(require_func(mag2(a), 14.0f));
+    REQUIRE(require_func(mag(normalised(b)), 1.0f));
+    REQUIRE(require_func((vec3f)cross(a, b), cross(vec3f(a), vec3f(b))));
+    REQUIRE(require_func((vec3f)min_union(a, b), {-4.0f, 0.5f, 2.0f}));
+    REQUIRE(require_func((vec3f)max_union(a, b), {1.0f, 2.0f, 3.0f}));
+    REQUIRE(require_func((vec3f)lerp(a, b, 0.25f), lerp(vec3f(a), vec3f(b), 0.25f)));
+    REQUIRE(require_func(dot(clamp(a, 1.5f, 2.5f), vec3fa(1.0f)), 6.0f));
+    
+    vec3f sw = a.zyx;
+    REQUIRE(require_func(sw, {3.0f, 2.0f, 1.0f}));
+    a.xy = b.zz;
+    REQUIRE(require_func((vec3f)a, {2.0f, 2.0f, 3.0f}));
+}
+
+template<size_t W>
+void test_soa_lanes(const std::vector<vec3f>& a, const std::vector<vec3f>& b)
+{
+    soa3f sa(a);
+    soa3f sb(b);
+    soa3f sn(a.size());
+    
+    for(size_t i = 0; i < sa.size(); i += W)
+    {
+        Vec<3, Wide<W>> va = sa.template load<W>(i);
+        Vec<3, Wide<W>> vb = sb.template load<W>(i);
+        Wide<W> d = dot(va, vb);
+        Wide<W> m = mag(va);
+        Vec<3, Wide<W>> c = cross(va, vb);
+        Vec<3, Wide<W>> l = lerp(va, vb, Wide<W>(0.25f));
+        Vec<3, Wide<W>> cl = clamp(va, Wide<W>(-1.0f), Wide<W>(1.0f));
+        Vec<3, Wide<W>> mn = min_union(va, vb);
+        Vec<3, Wide<W>> mx = max_union(va, vb);
+        u32 closer = movemask(mag2(vb) < mag2(va));
+        sn.store(i, normalised(va));
+        
+        for(size_t j = 0; j < W && i + j < sa.size(); ++j)
+        {
+            const vec3f& sca = a[i + j];
+            const vec3f& scb = b[i + j];
+            REQUIRE(require_func(d[j], dot(sca, scb)));
+            REQUIRE(require_func(m[j], mag(sca)));
+            REQUIRE(require_func(lane(c, j), cross(sca, scb)));
+            REQUIRE(require_func(lane(l, j), lerp(sca, scb, 0.25f)));
+            REQUIRE(require_func(lane(cl, j), clamp(sca, -1.0f, 1.0f)));
+            REQUIRE(require_func(lane(mn, j), min_union(sca, scb)));
+            REQUIRE(require_func(lane(mx, j), max_union(sca, scb)));
+            REQUIRE(require_func((bool)(closer & (1 << j)), mag2(scb) < mag2(sca)));
+        }
+    }
+    
+    std::vector<vec3f> n;
+    sn.to_aos(n);
+    REQUIRE(n.size() == a.size());
+    for(size_t i = 0; i < n.size(); ++i)
+        REQUIRE(require_func(n[i], normalised(a[i])));
+}
+
+TEST_CASE("soa lanes", "[soa]")
+{
+    std::vector<vec3f> a;
+    std::vector<vec3f> b;
+    for(size_t i = 0; i < 37; ++i)
+    {
+        f32 f = (f32)i;
+        a.push_back(vec3f(sin(f) * 2.0f, cos(f * 0.5f), f * 0.1f - 1.5f));
+        b.push_back(vec3f(cos(f) * 0.5f, f * 0.05f, sin(f * 0.3f) * 3.0f));
+    }
+    
+    test_soa_lanes<4>(a, b);
+    test_soa_lanes<8>(a, b);
+    test_soa_lanes<16>(a, b);
+    
+    f32x8 s = f32x8(2.0f);
+    f32x8 t = 1 - s * 0.5f;
+    REQUIRE(require_func(t[7], 0.0f));
+    REQUIRE(require_func(movemask(select(s > t, s, t) == s), (u32)0xff));
+    REQUIRE(require_func(all(abs(-s) == s), true));
+    REQUIRE(require_func(any(s < t), false));
+    
+    // store writes into the padding, resize zeroes it again
+    soa3f sp(a);
+    sp.store(37, Vec<3, Wide<8>>(Wide<8>(7.0f)));
+    REQUIRE(require_func(sp.component(0)[39], 7.0f));
+    sp.resize(35);
+    u32 dirty = 0;
+    for(size_t i = 35; i < k_soa_pad * 3; ++i)
+        for(size_t j = 0; j < 3; ++j)
+            if(sp.component(j)[i] != 0.0f)
+                ++dirty;
+    REQUIRE(dirty == 0);
+    REQUIRE(require_func(sp.get(34), a[34]));
+}
+
+TEST_CASE("lazy expressions", "[vec]")
+{
+    vec3f a = vec3f(1.0f, 2.0f, 3.0f);
+    vec3f b = vec3f(-4.0f, 0.5f, 2.0f);
+    vec4f c = vec4f(0.5f, 1.5f, -2.0f, 8.0f);
+    f32 f = 0.25f;
+    
+    vec3f r = lazy(a) * (1.0f - f) + b * f;
+    REQUIRE(require_func(r, lerp(a, b, f)));
+    
+    r = 2.0f * lazy(a) - b / 2.0f;
+    REQUIRE(require_func(r, a * 2.0f - b / 2.0f));
+    
+    r = -lazy(b) / a + c.zyx;
+    REQUIRE(require_func(r, -b / a + vec3f(c.zyx)));
+    
+    r = lazy(c.wzy) * c.xxx - a;
+    REQUIRE(require_func(r, {3.0f, -3.0f, -2.25f}));
+    
+    r = lazy(a) + lazy(b) * lazy(c.xyz);
+    REQUIRE(require_func(r, {-1.0f, 2.75f, -1.0f}));
+    
+    // compound ops may alias the destination
+    vec3f d = a;
+    d += lazy(d.zyx) * 2.0f;
+    REQUIRE(require_func(d, {7.0f, 6.0f, 5.0f}));
+    d *= lazy(a) - 1.0f;
+    REQUIRE(require_func(d, {0.0f, 6.0f, 10.0f}));
+    
+    REQUIRE(require_func(dot((lazy(a) + b).eval(), a), 17.0f));
+    REQUIRE(require_func((lazy(a) - b)[2], 1.0f));
+}
+
 TEST_CASE( "AABB vs Frustum", "[maths]")
 {
 	mat4 view_proj = {
@@ -729,6 +921,59 @@ TEST_CASE( "Sphere vs Frustum", "[maths]")
 	}	
 }
 
+template<size_t W>
+void test_batch_frustum(const soa3f& pos, const soa3f& ext, const soa4f& spheres, const vec4f* planes)
+{
+    size_t n = pos.size();
+    std::vector<u32> aabb_vis((n + 31) / 32, 0xffffffff);
+    std::vector<u32> sphere_vis((n + 31) / 32, 0xffffffff);
+    maths::aabb_vs_frustum<W>(pos, ext, planes, aabb_vis.data());
+    maths::sphere_vs_frustum<W>(spheres, planes, sphere_vis.data());
+    
+    for(size_t i = 0; i < n; ++i)
+    {
+        bool av = aabb_vis[i / 32] & (1u << (i % 32));
+        bool sv = sphere_vis[i / 32] & (1u << (i % 32));
+        vec4f s = spheres.get(i);
+        REQUIRE(av == maths::aabb_vs_frustum(pos.get(i), ext.get(i), (vec4f*)planes));
+        REQUIRE(sv == maths::sphere_vs_frustum(s.xyz, s.w, (vec4f*)planes));
+    }
+    
+    // bits past the end are clear
+    REQUIRE((aabb_vis.back() >> (n % 32)) == 0);
+    REQUIRE((sphere_vis.back() >> (n % 32)) == 0);
+}
+
+TEST_CASE( "Batch Frustum Culling", "[maths]")
+{
+    mat4 view_proj = {
+        (f32)0.85501, (f32)1.45179e-08, (f32)0.467094, (f32)0,
+        (f32)0.39811, (f32)1.52002, (f32)-0.728735, (f32)0,
+        (f32)0.420904, (f32)-0.479617, (f32)-0.770459, (f32)60.004,
+        (f32)0.420736, (f32)-0.479426, (f32)-0.770151, (f32)60
+    };
+    
+    vec4f planes[6];
+    maths::get_frustum_planes_from_matrix(view_proj, &planes[0]);
+    
+    size_t n = 1000 + 13;
+    soa3f pos(n), ext(n);
+    soa4f spheres(n);
+    srand(1);
+    for(size_t i = 0; i < n; ++i)
+    {
+        vec3f p = vec3f(rand() % 2000, rand() % 2000, rand() % 2000) / 100.0f - 10.0f;
+        vec3f e = vec3f(rand() % 1000, rand() % 1000, rand() % 1000) / 200.0f;
+        pos.set(i, p);
+        ext.set(i, e);
+        spheres.set(i, vec4f(p, e.x));
+    }
+    
+    test_batch_frustum<4>(pos, ext, spheres, planes);
+    test_batch_frustum<8>(pos, ext, spheres, planes);
+    test_batch_frustum<16>(pos, ext, spheres, planes);
+}
+
 TEST_CASE( "Point Plane Distance", "[maths]")
 {
     {
@@ -3103,6 +3348,2086 @@ TEST_CASE( "Point Inside OBB / Closest Point on OBB", "[maths]")
         REQUIRE(require_func(result,vec3f((f32)3.99812, (f32)0.973554, (f32)6.40428)));
     }
 }
+TEST_CASE( "Prepared OBB / Unproject", "[maths]")
+{
+    mat4 obb_mat = mat::create_translation(vec3f(1.5f, -2.0f, 3.0f)) * mat::create_rotation(normalised(vec3f(1.0f, 2.0f, -0.5f)), 0.7f) * mat::create_scale(vec3f(2.0f, 0.5f, 3.0f));
+    maths::prepared_obb obb = maths::prepare_obb(obb_mat);
+    
+    const size_t n = 67;
+    std::vector<vec3f> p(n), r1(n), rv(n);
+    srand(2);
+    for(size_t i = 0; i < n; ++i)
+    {
+        p[i] = vec3f(rand() % 1000, rand() % 1000, rand() % 1000) / 100.0f - 5.0f;
+        r1[i] = vec3f(rand() % 1000, rand() % 1000, rand() % 1000) / 50.0f - 10.0f;
+        rv[i] = normalised(obb_mat.get_translation() + p[i] * 0.2f - r1[i]);
+    }
+    
+    std::vector<vec3f> cp(n), ip(n);
+    std::vector<u32> inside((n + 31) / 32), hit((n + 31) / 32);
+    maths::closest_point_on_obb(obb, p.data(), cp.data(), n);
+    maths::point_inside_obb(obb, p.data(), n, inside.data());
+    maths::ray_vs_obb(obb, r1.data(), rv.data(), ip.data(), n, hit.data());
+    
+    u32 num_inside = 0, num_hit = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        bool pi = inside[i / 32] & (1u << (i % 32));
+        bool rh = hit[i / 32] & (1u << (i % 32));
+        num_inside += pi ? 1 : 0;
+        num_hit += rh ? 1 : 0;
+        
+        REQUIRE(require_func(cp[i], maths::closest_point_on_obb(obb_mat, p[i])));
+        REQUIRE(require_func(pi, maths::point_inside_obb(obb_mat, p[i])));
+        
+        vec3f sip;
+        REQUIRE(require_func(rh, maths::ray_vs_obb(obb_mat, r1[i], rv[i], sip)));
+        if(rh)
+            REQUIRE(require_func(ip[i], sip));
+    }
+    REQUIRE(num_inside > 0);
+    REQUIRE(num_hit > 0);
+    
+    // unproject round trips through the prepared inverse
+    mat4 view_proj = mat::create_perspective_projection(-1.0f, 1.0f, -1.0f, 1.0f, 0.1f, 100.0f) * mat::create_translation(vec3f(0.0f, 0.0f, -10.0f));
+    maths::prepared_view_projection vp = maths::prepare_view_projection(view_proj);
+    vec2i viewport = vec2i(1280, 720);
+    
+    std::vector<vec3f> sc(n), world(n);
+    for(size_t i = 0; i < n; ++i)
+        sc[i] = vec3f(rand() % 1280, rand() % 720, (rand() % 100) / 100.0f);
+    
+    maths::unproject_sc(sc.data(), world.data(), n, vp, viewport);
+    for(size_t i = 0; i < n; ++i)
+    {
+        REQUIRE(require_func(world[i], maths::unproject_sc(sc[i], view_proj, viewport)));
+        vec3f ndc = vec3f((sc[i].xy / (vec2f)viewport) * 2.0f - 1.0f, sc[i].z);
+        REQUIRE(require_func(maths::project_to_ndc(world[i], view_proj), ndc));
+    }
+}
+
+TEST_CASE( "Convex Hull", "[maths]")
+{
+    {
+        std::vector<vec2f> points = {{0.0f, 0.0f}, {1.0f, 0.0f}, {0.5f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}, {0.5f, 0.5f}, {0.2f, 0.7f}};
+        std::vector<vec2f> hull;
+        maths::convex_hull_from_points(hull, points);
+        REQUIRE(hull.size() == 4);
+        REQUIRE(require_func(hull[0], {1.0f, 1.0f}));
+        REQUIRE(require_func(hull[1], {0.0f, 1.0f}));
+        REQUIRE(require_func(hull[2], {0.0f, 0.0f}));
+        REQUIRE(require_func(hull[3], {1.0f, 0.0f}));
+        REQUIRE(maths::point_inside_convex_hull(vec2f(0.5f, 0.4f), hull));
+        REQUIRE(!maths::point_inside_convex_hull(vec2f(1.5f, 0.4f), hull));
+    }
+    
+    // coincident points collapse to a single point
+    {
+        std::vector<vec2f> points = {{1.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 1.0f}};
+        std::vector<vec2f> hull;
+        maths::convex_hull_from_points(hull, points);
+        REQUIRE(hull.size() == 1);
+        REQUIRE(require_func(hull[0], {1.0f, 1.0f}));
+    }
+    
+    // large cloud split across threads matches the single threaded result
+    const size_t n = 100000;
+    std::vector<vec2f> points(n);
+    srand(3);
+    for(size_t i = 0; i < n; ++i)
+    {
+        f32 a = (f32)(rand() % 10000) / 10000.0f * (f32)M_TWO_PI;
+        f32 r = sqrt((f32)(rand() % 10000) / 10000.0f) * 10.0f;
+        points[i] = vec2f(cos(a) * r, sin(a) * r * 0.5f);
+    }
+    
+    std::vector<vec2f> scratch(n), hull(n + 1), hull_mt(n + 1);
+    size_t h = maths::convex_hull_from_points(hull.data(), points.data(), n, scratch.data(), 1);
+    size_t hmt = maths::convex_hull_from_points(hull_mt.data(), points.data(), n, scratch.data(), 4);
+    REQUIRE(h == hmt);
+    REQUIRE(h > 3);
+    
+    for(size_t i = 0; i < h; ++i)
+    {
+        REQUIRE(require_func(hull[i], hull_mt[i]));
+        
+        // convex, turning left at each corner
+        vec2f e0 = hull[(i + 1) % h] - hull[i];
+        vec2f e1 = hull[(i + 2) % h] - hull[(i + 1) % h];
+        REQUIRE(cross(e0, e1) > 0.0f);
+    }
+    
+    // all points are on or inside every edge
+    u32 outside = 0;
+    for(size_t i = 0; i < n; ++i)
+        for(size_t j = 0; j < h; ++j)
+            if(cross(hull[(j + 1) % h] - hull[j], points[i] - hull[j]) < -0.0001f)
+                ++outside;
+    REQUIRE(outside == 0);
+}
+
+namespace
+{
+    void require_convex_hull(const maths::convex_hull& hull, const std::vector<vec3f>& points)
+    {
+        size_t nv = hull.vertices.size();
+        size_t nf = hull.faces.size();
+        REQUIRE(nf == hull.planes.size());
+        
+        // closed triangulated convex polyhedron
+        REQUIRE(nf == nv * 2 - 4);
+        
+        // all points are inside or on every plane
+        u32 outside = 0;
+        for(auto& p : points)
+            for(auto& pl : hull.planes)
+                if(dot(p, (vec3f)pl.xyz) + pl.w > 0.001f)
+                    ++outside;
+        REQUIRE(outside == 0);
+        
+        // face winding matches the planes
+        for(size_t i = 0; i < nf; ++i)
+        {
+            vec3ui f = hull.faces[i];
+            vec3f n = maths::get_normal(hull.vertices[f.x], hull.vertices[f.y], hull.vertices[f.z]);
+            REQUIRE(require_func(n, (vec3f)hull.planes[i].xyz));
+        }
+    }
+}
+
+TEST_CASE( "Convex Hull 3D", "[maths]")
+{
+    // cube corners with interior and coplanar surface points
+    {
+        std::vector<vec3f> points;
+        for(u32 x = 0; x < 5; ++x)
+            for(u32 y = 0; y < 5; ++y)
+                for(u32 z = 0; z < 5; ++z)
+                    points.push_back(vec3f(x, y, z) * 0.5f - vec3f(1.0f));
+        
+        maths::convex_hull hull;
+        REQUIRE(maths::convex_hull_from_points(hull, points));
+        REQUIRE(hull.vertices.size() == 8);
+        REQUIRE(hull.faces.size() == 12);
+        require_convex_hull(hull, points);
+    }
+    
+    // degenerate
+    {
+        std::vector<vec3f> points = {{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {0.5f, 0.2f, 0.0f}};
+        maths::convex_hull hull;
+        REQUIRE(!maths::convex_hull_from_points(hull, points));
+        REQUIRE(hull.faces.empty());
+    }
+    
+    // random cloud, multithreaded matches single threaded
+    const size_t n = 50000;
+    std::vector<vec3f> points(n);
+    srand(4);
+    for(size_t i = 0; i < n; ++i)
+    {
+        vec3f d = normalised(vec3f(rand() % 2001, rand() % 2001, rand() % 2001) - vec3f(1000.0f));
+        points[i] = d * (f32)(rand() % 1000) / 100.0f * vec3f(1.0f, 0.5f, 2.0f);
+    }
+    
+    maths::convex_hull hull, hull_mt;
+    REQUIRE(maths::convex_hull_from_points(hull, points, 0, 1));
+    REQUIRE(maths::convex_hull_from_points(hull_mt, points, 0, 4));
+    require_convex_hull(hull, points);
+    REQUIRE(hull.vertices.size() == hull_mt.vertices.size());
+    REQUIRE(hull.faces.size() == hull_mt.faces.size());
+    for(size_t i = 0; i < hull.vertices.size(); ++i)
+        REQUIRE(require_func(hull.vertices[i], hull_mt.vertices[i]));
+    
+    // vertex budget gives a simplified hull of a subset of the points
+    maths::convex_hull simple;
+    REQUIRE(maths::convex_hull_from_points(simple, points, 24));
+    REQUIRE(simple.vertices.size() <= 24);
+    REQUIRE(simple.faces.size() == simple.vertices.size() * 2 - 4);
+    u32 outside = 0;
+    for(auto& v : simple.vertices)
+        for(auto& pl : hull.planes)
+            if(dot(v, (vec3f)pl.xyz) + pl.w > 0.001f)
+                ++outside;
+    REQUIRE(outside == 0);
+    
+    // the budget is spent on the most extreme points, so the full hull is close to the simplified one and gets
+    // closer as the budget grows
+    f32 prev = FLT_MAX;
+    for(u32 budget : {24, 64})
+    {
+        REQUIRE(maths::convex_hull_from_points(simple, points, budget));
+        REQUIRE(simple.vertices.size() == budget);
+        f32 furthest = 0.0f;
+        for(auto& v : hull.vertices)
+        {
+            f32 d = -FLT_MAX;
+            for(auto& pl : simple.planes)
+                d = std::max(d, dot(v, (vec3f)pl.xyz) + pl.w);
+            furthest = std::max(furthest, d);
+        }
+        REQUIRE(furthest < 2.0f);
+        REQUIRE(furthest < prev);
+        prev = furthest;
+    }
+    
+    // vertices buried by later expansions don't count towards the budget, small clouds hit the budget exactly
+    for(u32 c = 0; c < 300; ++c)
+    {
+        std::vector<vec3f> cloud(200);
+        for(u32 i = 0; i < 200; ++i)
+        {
+            auto rnd = [&](u32 k) { return (f32)(hash_u32(c * 4096 + i * 4 + k) % 20001) / 10000.0f - 1.0f; };
+            cloud[i] = vec3f(rnd(0), rnd(1), rnd(2));
+        }
+        
+        u32 budget = 6 + c % 20;
+        maths::convex_hull full, budgeted;
+        REQUIRE(maths::convex_hull_from_points(full, cloud, 0, 1));
+        REQUIRE(maths::convex_hull_from_points(budgeted, cloud, budget, 1));
+        CHECK(budgeted.vertices.size() == std::min<size_t>(budget, full.vertices.size()));
+    }
+}
+
+TEST_CASE( "BVH", "[maths]")
+{
+    // ray vs triangle
+    {
+        f32 t = 0.0f;
+        const vec3f t0 = {-1.0f, 0.0f, -1.0f};
+        const vec3f t1 = {1.0f, 0.0f, -1.0f};
+        const vec3f t2 = {0.0f, 0.0f, 1.0f};
+        REQUIRE(ray_vs_triangle(vec3f(0.0f, 2.0f, 0.0f), vec3f(0.0f, -0.5f, 0.0f), t0, t1, t2, t));
+        REQUIRE(require_func(t, 4.0f));
+        REQUIRE(ray_vs_triangle(vec3f(0.0f, -2.0f, 0.0f), vec3f(0.0f, 1.0f, 0.0f), t0, t1, t2, t));
+        REQUIRE(!ray_vs_triangle(vec3f(0.0f, 2.0f, 0.0f), vec3f(0.0f, 1.0f, 0.0f), t0, t1, t2, t));
+        REQUIRE(!ray_vs_triangle(vec3f(2.0f, 2.0f, 0.0f), vec3f(0.0f, -1.0f, 0.0f), t0, t1, t2, t));
+        REQUIRE(!ray_vs_triangle(vec3f(0.0f, 2.0f, 0.0f), vec3f(1.0f, 0.0f, 0.0f), t0, t1, t2, t));
+    }
+    
+    // random triangle soup, every query matches brute force
+    const size_t n = 2000;
+    std::vector<vec3f> vertices(n * 3);
+    srand(8);
+    auto rnd = []() {
+        return vec3f(rand() % 2001, rand() % 2001, rand() % 2001) / 1000.0f - vec3f(1.0f);
+    };
+    for(size_t i = 0; i < n; ++i)
+    {
+        vec3f c = rnd() * 10.0f;
+        for(size_t k = 0; k < 3; ++k)
+            vertices[i * 3 + k] = c + rnd();
+    }
+    
+    maths::bvh tree;
+    maths::build_bvh(tree, vertices, std::vector<u32>());
+    REQUIRE(tree.vertices.size() == n * 3);
+    
+    // each triangle is in exactly one leaf and leaves are bounded by their parents
+    u32 failures = 0;
+    std::vector<u32> seen(n, 0);
+    for(auto& node : tree.nodes)
+    {
+        if(node.count > 0)
+        {
+            for(u32 i = node.left_first; i < node.left_first + node.count; ++i)
+                seen[tree.triangles[i]]++;
+            continue;
+        }
+        
+        for(u32 c = node.left_first; c < node.left_first + 2; ++c)
+            if(!point_inside_aabb(node.aabb_min, node.aabb_max, tree.nodes[c].aabb_min) ||
+               !point_inside_aabb(node.aabb_min, node.aabb_max, tree.nodes[c].aabb_max))
+                ++failures;
+    }
+    for(size_t i = 0; i < n; ++i)
+        if(seen[i] != 1)
+            ++failures;
+    REQUIRE(failures == 0);
+    
+    u32 hits = 0;
+    for(size_t q = 0; q < 1000; ++q)
+    {
+        vec3f r0 = rnd() * 15.0f;
+        vec3f rv = q % 2 ? normalised(rnd()) : normalised(rnd() * 10.0f - r0);
+        
+        f32 bt = FLT_MAX;
+        u32 bi = 0;
+        for(size_t i = 0; i < n; ++i)
+        {
+            f32 t;
+            if(ray_vs_triangle(r0, rv, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], t) && t < bt)
+            {
+                bt = t;
+                bi = (u32)i;
+            }
+        }
+        
+        maths::bvh_hit hit;
+        bool h = maths::ray_vs_bvh(tree, r0, rv, hit);
+        if(h != (bt != FLT_MAX) || maths::ray_vs_bvh_any(tree, r0, rv) != h)
+            ++failures;
+        else if(h && (hit.triangle != bi || fabs(hit.t - bt) > k_e || dist(hit.p, r0 + rv * bt) > k_e))
+            ++failures;
+        
+        // occlusion only up to t_max
+        if(h && maths::ray_vs_bvh_any(tree, r0, rv, bt * 0.99f))
+            ++failures;
+        
+        hits += h ? 1 : 0;
+        
+        // closest point vs point_triangle_distance
+        vec3f p = rnd() * 15.0f;
+        f32 bd = FLT_MAX;
+        for(size_t i = 0; i < n; ++i)
+            bd = std::min(bd, point_triangle_distance(p, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]));
+        
+        maths::bvh_hit cp;
+        if(!maths::closest_point_on_bvh(tree, p, cp) || fabs(cp.t - bd) > k_e || fabs(dist(p, cp.p) - bd) > k_e)
+            ++failures;
+    }
+    REQUIRE(hits > 100);
+    REQUIRE(failures == 0);
+    
+    // indexed mesh, max distance
+    {
+        std::vector<vec3f> quad = {{-1.0f, 0.0f, -1.0f}, {1.0f, 0.0f, -1.0f}, {1.0f, 0.0f, 1.0f}, {-1.0f, 0.0f, 1.0f}};
+        std::vector<u32> indices = {0, 1, 2, 0, 2, 3};
+        maths::build_bvh(tree, quad, indices);
+        
+        maths::bvh_hit hit;
+        REQUIRE(maths::ray_vs_bvh(tree, vec3f(-0.5f, 1.0f, 0.5f), vec3f(0.0f, -1.0f, 0.0f), hit));
+        REQUIRE(hit.triangle == 1);
+        REQUIRE(require_func(hit.p, vec3f(-0.5f, 0.0f, 0.5f)));
+        REQUIRE(!maths::ray_vs_bvh(tree, vec3f(-0.5f, 1.0f, 0.5f), vec3f(0.0f, -1.0f, 0.0f), hit, 0.5f));
+        
+        REQUIRE(maths::closest_point_on_bvh(tree, vec3f(0.5f, 2.0f, -0.5f), hit));
+        REQUIRE(hit.triangle == 0);
+        REQUIRE(require_func(hit.p, vec3f(0.5f, 0.0f, -0.5f)));
+        REQUIRE(require_func(hit.t, 2.0f));
+        REQUIRE(!maths::closest_point_on_bvh(tree, vec3f(0.5f, 2.0f, -0.5f), hit, 1.0f));
+        
+        maths::build_bvh(tree, std::vector<vec3f>(), std::vector<u32>());
+        REQUIRE(!maths::ray_vs_bvh(tree, vec3f(0.0f), vec3f(1.0f, 0.0f, 0.0f), hit));
+    }
+}
+
+namespace
+{
+    template<size_t W>
+    u32 test_ray_packets(const std::vector<vec3f>& r0, const std::vector<vec3f>& rv, const std::vector<vec3f>& vertices)
+    {
+        u32 failures = 0;
+        for(size_t i = 0; i + W <= r0.size(); i += W)
+        {
+            Vec<3, Wide<W>> pr0 = gather<W>(&r0[i]);
+            Vec<3, Wide<W>> prv = gather<W>(&rv[i]);
+            Vec<3, Wide<W>> inv_rv = splat<W>(vec3f::one()) / prv;
+            
+            // aabb and triangle from the vertices
+            const vec3f* v = &vertices[(i % (vertices.size() / 3)) * 3];
+            vec3f emin = min_union(min_union(v[0], v[1]), v[2]);
+            vec3f emax = max_union(max_union(v[0], v[1]), v[2]);
+            
+            Wide<W> t_max = 20.0f;
+            Wide<W> ta, tt;
+            u32 aabb_mask = movemask(ray_vs_aabb(emin, emax, pr0, inv_rv, t_max, ta));
+            u32 tri_mask = movemask(ray_vs_triangle(pr0, prv, v[0], v[1], v[2], tt));
+            
+            for(size_t l = 0; l < W; ++l)
+            {
+                f32 t;
+                bool h = ray_vs_aabb(emin, emax, r0[i + l], vec3f::one() / rv[i + l], 20.0f, t);
+                if(h != ((aabb_mask & (1 << l)) != 0) || (h && fabs(t - ta[l]) > k_e))
+                    ++failures;
+                
+                h = ray_vs_triangle(r0[i + l], rv[i + l], v[0], v[1], v[2], t);
+                if(h != ((tri_mask & (1 << l)) != 0) || (h && fabs(t - tt[l]) > k_e))
+                    ++failures;
+            }
+        }
+        return failures;
+    }
+}
+
+TEST_CASE( "Ray Packets", "[maths]")
+{
+    // triangle soup and rays fired from a point towards it
+    const size_t n = 1000;
+    std::vector<vec3f> vertices(n * 3);
+    srand(9);
+    auto rnd = []() {
+        return vec3f(rand() % 2001, rand() % 2001, rand() % 2001) / 1000.0f - vec3f(1.0f);
+    };
+    for(size_t i = 0; i < n; ++i)
+    {
+        vec3f c = rnd() * 10.0f;
+        for(size_t k = 0; k < 3; ++k)
+            vertices[i * 3 + k] = c + rnd() * 2.0f;
+    }
+    
+    const size_t num_rays = 1003;
+    std::vector<vec3f> r0(num_rays), rv(num_rays);
+    for(size_t i = 0; i < num_rays; ++i)
+    {
+        r0[i] = vec3f(-15.0f, 0.0f, 0.0f) + rnd() * 0.1f;
+        rv[i] = normalised(vec3f(1.0f, 0.0f, 0.0f) + rnd() * 0.5f);
+        if(i % 7 == 0)
+            rv[i] = normalised(rnd());
+    }
+    
+    REQUIRE(test_ray_packets<4>(r0, rv, vertices) == 0);
+    REQUIRE(test_ray_packets<8>(r0, rv, vertices) == 0);
+    
+    // axis aligned directions with infinite reciprocals
+    {
+        Vec<3, Wide<8>> pr0 = splat<8>(vec3f(0.0f, 0.5f, 0.5f));
+        Vec<3, Wide<8>> prv = splat<8>(vec3f(1.0f, 0.0f, 0.0f));
+        Vec<3, Wide<8>> inv_rv = splat<8>(vec3f::one()) / prv;
+        Wide<8> t;
+        REQUIRE(all(ray_vs_aabb(vec3f(2.0f, 0.0f, 0.0f), vec3f(3.0f, 1.0f, 1.0f), pr0, inv_rv, Wide<8>(10.0f), t)));
+        REQUIRE(require_func(t[3], 2.0f));
+        REQUIRE(!any(ray_vs_aabb(vec3f(2.0f, 0.0f, 0.0f), vec3f(3.0f, 1.0f, 1.0f), pr0, inv_rv, Wide<8>(1.0f), t)));
+        REQUIRE(!any(ray_vs_aabb(vec3f(2.0f, 1.0f, 0.0f), vec3f(3.0f, 2.0f, 1.0f), pr0, inv_rv, Wide<8>(10.0f), t)));
+    }
+    
+    // packet bvh traversal matches single rays, including the partial last packet
+    maths::bvh tree;
+    maths::build_bvh(tree, vertices, std::vector<u32>());
+    
+    std::vector<maths::bvh_hit> hits(num_rays), hits4(num_rays);
+    std::vector<u32> mask((num_rays + 31) / 32), mask4((num_rays + 31) / 32);
+    maths::ray_vs_bvh(tree, r0.data(), rv.data(), num_rays, hits.data(), mask.data());
+    maths::ray_vs_bvh<4>(tree, r0.data(), rv.data(), num_rays, hits4.data(), mask4.data(), 25.0f);
+    
+    u32 failures = 0;
+    u32 num_hits = 0;
+    for(size_t i = 0; i < num_rays; ++i)
+    {
+        maths::bvh_hit hit;
+        bool h = maths::ray_vs_bvh(tree, r0[i], rv[i], hit);
+        bool ph = (mask[i / 32] & (1 << (i % 32))) != 0;
+        if(h != ph)
+            ++failures;
+        else if(h && (hits[i].triangle != hit.triangle || fabs(hits[i].t - hit.t) > k_e || dist(hits[i].p, hit.p) > k_e))
+            ++failures;
+        
+        // t_max limits the packet lanes
+        bool h4 = maths::ray_vs_bvh(tree, r0[i], rv[i], hit, 25.0f);
+        bool ph4 = (mask4[i / 32] & (1 << (i % 32))) != 0;
+        if(h4 != ph4 || (h4 && hits4[i].triangle != hit.triangle))
+            ++failures;
+        
+        num_hits += h ? 1 : 0;
+    }
+    REQUIRE(num_hits > 100);
+    REQUIRE(failures == 0);
+}
+
+namespace
+{
+    // reference sat projecting the 8 corners of each obb onto all 15 axes
+    bool obb_vs_obb_corners(const mat4& a, const mat4& b)
+    {
+        vec3f ca[8], cb[8];
+        for(u32 i = 0; i < 8; ++i)
+        {
+            vec3f c = vec3f(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+            ca[i] = a.transform_vector(vec4f(c, 1.0f)).xyz;
+            cb[i] = b.transform_vector(vec4f(c, 1.0f)).xyz;
+        }
+        
+        std::vector<vec3f> axes;
+        for(u32 i = 0; i < 3; ++i)
+        {
+            axes.push_back(a.get_column(i).xyz);
+            axes.push_back(b.get_column(i).xyz);
+            for(u32 j = 0; j < 3; ++j)
+                axes.push_back(cross((vec3f)a.get_column(i).xyz, (vec3f)b.get_column(j).xyz));
+        }
+        
+        for(auto& l : axes)
+        {
+            if(mag2(l) < 1e-6f)
+                continue;
+            
+            f32 amin = FLT_MAX, amax = -FLT_MAX, bmin = FLT_MAX, bmax = -FLT_MAX;
+            for(u32 i = 0; i < 8; ++i)
+            {
+                amin = std::min(amin, dot(ca[i], l));
+                amax = std::max(amax, dot(ca[i], l));
+                bmin = std::min(bmin, dot(cb[i], l));
+                bmax = std::max(bmax, dot(cb[i], l));
+            }
+            
+            if(amax < bmin || bmax < amin)
+                return false;
+        }
+        return true;
+    }
+    
+    mat4 random_obb(f32 range)
+    {
+        vec3f axis = normalised(vec3f(rand() % 2001, rand() % 2001, rand() % 2001) - vec3f(1000.0f));
+        vec3f pos = (vec3f(rand() % 2001, rand() % 2001, rand() % 2001) / 1000.0f - vec3f(1.0f)) * range;
+        vec3f scale = vec3f(rand() % 1000 + 1, rand() % 1000 + 1, rand() % 1000 + 1) / 500.0f;
+        f32 angle = (f32)(rand() % 1000) / 1000.0f * (f32)M_TWO_PI;
+        return mat::create_translation(pos) * mat::create_rotation(axis, angle) * mat::create_scale(scale);
+    }
+}
+
+TEST_CASE( "OBB vs OBB", "[maths]")
+{
+    mat4 unit = mat4::create_identity();
+    
+    // overlapping and separated axis aligned
+    REQUIRE(obb_vs_obb(unit, unit));
+    REQUIRE(obb_vs_obb(unit, mat::create_translation(vec3f(1.9f, 0.0f, 0.0f))));
+    REQUIRE(!obb_vs_obb(unit, mat::create_translation(vec3f(2.1f, 0.0f, 0.0f))));
+    
+    // rotated 45 degrees, the corner reaches 1 + sqrt(2) along x
+    mat4 rot = mat::create_z_rotation((f32)M_PI / 4.0f);
+    REQUIRE(obb_vs_obb(unit, mat::create_translation(vec3f(2.3f, 0.0f, 0.0f)) * rot));
+    REQUIRE(!obb_vs_obb(unit, mat::create_translation(vec3f(2.5f, 0.0f, 0.0f)) * rot));
+    
+    // both rotated and placed diagonally, the aabbs overlap but the obbs do not
+    REQUIRE(!obb_vs_obb(rot, mat::create_translation(vec3f(1.6f, 1.6f, 0.0f)) * rot));
+    REQUIRE(obb_vs_obb(rot, mat::create_translation(vec3f(1.3f, 1.3f, 0.0f)) * rot));
+    
+    // edge vs edge, only separated by a cross product axis
+    mat4 ea = mat::create_z_rotation((f32)M_PI / 4.0f);
+    mat4 eb = mat::create_translation(vec3f(0.0f, 3.0f, 0.0f)) * mat::create_x_rotation((f32)M_PI / 4.0f);
+    REQUIRE(!obb_vs_obb(ea, eb));
+    REQUIRE(obb_vs_obb(ea, mat::create_translation(vec3f(0.0f, 2.7f, 0.0f)) * mat::create_x_rotation((f32)M_PI / 4.0f)));
+    
+    // random obbs against the corner projection reference and the batch version
+    srand(10);
+    const size_t n = 1001;
+    soa_obb obbs(n);
+    std::vector<mat4> mats(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        mats[i] = random_obb(6.0f);
+        obbs.set(i, mats[i]);
+    }
+    
+    std::vector<u32> overlap4((n + 31) / 32), overlap8((n + 31) / 32), overlap16((n + 31) / 32);
+    u32 failures = 0;
+    u32 overlaps = 0;
+    for(size_t k = 0; k < 8; ++k)
+    {
+        mat4 obb = random_obb(2.0f);
+        obb_vs_obb<4>(obb, obbs, overlap4.data());
+        obb_vs_obb<8>(obb, obbs, overlap8.data());
+        obb_vs_obb<16>(obb, obbs, overlap16.data());
+        
+        for(size_t i = 0; i < n; ++i)
+        {
+            bool r = obb_vs_obb_corners(obb, mats[i]);
+            bool bit = (overlap8[i / 32] & (1 << (i % 32))) != 0;
+            if(obb_vs_obb(obb, mats[i]) != r || bit != r)
+                ++failures;
+            overlaps += r ? 1 : 0;
+        }
+        
+        for(size_t i = 0; i < overlap8.size(); ++i)
+            if(overlap4[i] != overlap8[i] || overlap16[i] != overlap8[i])
+                ++failures;
+    }
+    
+    REQUIRE(overlaps > 100);
+    REQUIRE(overlaps < n * 8 - 100);
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Sweep and Prune", "[maths]")
+{
+    // touching boxes overlap like aabb_vs_aabb
+    sweep_and_prune sap;
+    u32 a = sap_add(sap, vec3f(0.0f), vec3f(1.0f));
+    u32 b = sap_add(sap, vec3f(1.0f, 0.0f, 0.0f), vec3f(2.0f, 1.0f, 1.0f));
+    u32 c = sap_add(sap, vec3f(5.0f), vec3f(6.0f));
+    sap_update(sap);
+    REQUIRE(sap.added.size() == 1);
+    REQUIRE(sap.added[0].a == a);
+    REQUIRE(sap.added[0].b == b);
+    REQUIRE(sap.pairs.size() == 1);
+
+    sap_move(sap, b, vec3f(1.01f, 0.0f, 0.0f), vec3f(2.01f, 1.0f, 1.0f));
+    sap_move(sap, c, vec3f(0.5f), vec3f(1.5f));
+    sap_update(sap);
+    REQUIRE(sap.added.size() == 2);
+    REQUIRE(sap.removed.size() == 1);
+    REQUIRE(sap.removed[0].a == a);
+    REQUIRE(sap.removed[0].b == b);
+
+    sap_remove(sap, c);
+    sap_update(sap);
+    REQUIRE(sap.added.size() == 0);
+    REQUIRE(sap.removed.size() == 2);
+    REQUIRE(sap.pairs.empty());
+    REQUIRE(sap.axis[0].size() == 4);
+    REQUIRE(sap_add(sap, vec3f(0.0f), vec3f(1.0f)) == c);
+
+    // random moving boxes with adds and removes, tracking pairs from the events against brute force
+    srand(11);
+    sap_clear(sap);
+    std::vector<u32> ids;
+    std::set<u64> tracked;
+    for(u32 i = 0; i < 500; ++i)
+    {
+        vec3f p = vec3f(rand() % 2000, rand() % 2000, rand() % 2000) / 100.0f;
+        ids.push_back(sap_add(sap, p, p + vec3f(0.5f + (f32)(rand() % 100) / 50.0f)));
+    }
+
+    u32 failures = 0;
+    size_t total_events = 0;
+    for(u32 frame = 0; frame < 50; ++frame)
+    {
+        for(size_t i = 0; i < ids.size(); ++i)
+        {
+            const sap_aabb& box = sap.aabbs[ids[i]];
+            vec3f d = vec3f(rand() % 100 - 50, rand() % 100 - 50, rand() % 100 - 50) / 200.0f;
+            sap_move(sap, ids[i], box.aabb_min + d, box.aabb_max + d);
+        }
+
+        for(u32 k = 0; k < 5; ++k)
+        {
+            size_t r = rand() % ids.size();
+            sap_remove(sap, ids[r]);
+            ids.erase(ids.begin() + r);
+
+            vec3f p = vec3f(rand() % 2000, rand() % 2000, rand() % 2000) / 100.0f;
+            ids.push_back(sap_add(sap, p, p + vec3f(1.0f)));
+        }
+
+        sap_update(sap);
+
+        for(auto& p : sap.removed)
+            if(!tracked.erase(((u64)p.a << 32) | p.b))
+                ++failures;
+
+        for(auto& p : sap.added)
+            if(p.a >= p.b || !tracked.insert(((u64)p.a << 32) | p.b).second)
+                ++failures;
+
+        total_events += sap.added.size() + sap.removed.size();
+
+        std::set<u64> brute;
+        for(size_t i = 0; i < ids.size(); ++i)
+            for(size_t j = 0; j < ids.size(); ++j)
+            {
+                u32 ia = ids[i], ib = ids[j];
+                if(ia >= ib)
+                    continue;
+
+                const sap_aabb& ba = sap.aabbs[ia];
+                const sap_aabb& bb = sap.aabbs[ib];
+                if(aabb_vs_aabb(ba.aabb_min, ba.aabb_max, bb.aabb_min, bb.aabb_max))
+                    brute.insert(((u64)ia << 32) | ib);
+            }
+
+        if(brute != tracked || brute.size() != sap.pairs.size())
+            ++failures;
+    }
+
+    REQUIRE(total_events > 100);
+    REQUIRE(tracked.size() > 50);
+    REQUIRE(failures == 0);
+
+    // removing most boxes at once reports every pair they were in
+    for(size_t i = 0; i < 400; ++i)
+        sap_remove(sap, ids[i]);
+    ids.erase(ids.begin(), ids.begin() + 400);
+    sap_update(sap);
+
+    for(auto& p : sap.removed)
+        tracked.erase(((u64)p.a << 32) | p.b);
+
+    for(u64 k : tracked)
+    {
+        const sap_aabb& ba = sap.aabbs[(u32)(k >> 32)];
+        const sap_aabb& bb = sap.aabbs[(u32)k];
+        if(sap_removed(sap, (u32)(k >> 32)) || sap_removed(sap, (u32)k) || !aabb_vs_aabb(ba.aabb_min, ba.aabb_max, bb.aabb_min, bb.aabb_max))
+            ++failures;
+    }
+
+    REQUIRE(tracked.size() == sap.pairs.size());
+    REQUIRE(sap.axis[2].size() == ids.size() * 2);
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Hash Grid", "[maths]")
+{
+    srand(12);
+    const size_t n = 10000;
+    std::vector<vec3f> points(n);
+    std::vector<f32> radii(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        // negative coordinates and cells sharing buckets are both exercised
+        points[i] = vec3f(rand() % 2000, rand() % 2000, rand() % 500) / 50.0f - vec3f(20.0f, 20.0f, 5.0f);
+        radii[i] = (f32)(rand() % 100) / 200.0f;
+    }
+
+    hash_grid grid;
+    build_hash_grid(grid, points.data(), nullptr, n, 1.0f);
+    REQUIRE(grid.items.size() == n);
+    REQUIRE(grid.cell_start.back() == n);
+
+    // radius queries against brute force
+    u32 failures = 0;
+    size_t found = 0;
+    std::vector<u32> results;
+    for(size_t q = 0; q < 100; ++q)
+    {
+        vec3f p = points[rand() % n] + vec3f(0.1f, -0.2f, 0.3f);
+        f32 r = 0.2f + (f32)(rand() % 100) / 50.0f;
+        results.clear();
+        hash_grid_query(grid, p, r, results);
+        std::sort(results.begin(), results.end());
+
+        std::vector<u32> brute;
+        for(u32 i = 0; i < n; ++i)
+            if(point_inside_sphere(p, r, points[i]))
+                brute.push_back(i);
+
+        if(results != brute)
+            ++failures;
+        found += results.size();
+    }
+    REQUIRE(found > 100);
+    REQUIRE(failures == 0);
+
+    // all pairs of points and of spheres against brute force, on one and several threads (ranges of 4096 items)
+    for(u32 spheres = 0; spheres < 2; ++spheres)
+    {
+        f32 radius = spheres ? 0.0f : 0.8f;
+        build_hash_grid(grid, points.data(), spheres ? radii.data() : nullptr, n, 1.0f, 4);
+
+        std::vector<hash_grid_pair> pairs, threaded;
+        hash_grid_pairs(grid, radius, pairs, 1);
+        hash_grid_pairs(grid, radius, threaded, 4);
+
+        std::set<u64> brute;
+        for(u32 i = 0; i < n; ++i)
+            for(u32 j = i + 1; j < n; ++j)
+            {
+                f32 ri = spheres ? radii[i] : 0.0f;
+                f32 rj = spheres ? radii[j] : 0.0f;
+                if(sphere_vs_sphere(points[i], ri + radius, points[j], rj))
+                    brute.insert(((u64)i << 32) | j);
+            }
+
+        std::set<u64> found_pairs;
+        for(auto& p : pairs)
+            if(p.a >= p.b || !found_pairs.insert(((u64)p.a << 32) | p.b).second)
+                ++failures;
+
+        REQUIRE(brute.size() > 100);
+        REQUIRE(found_pairs == brute);
+        REQUIRE(threaded.size() == pairs.size());
+        for(size_t i = 0; i < pairs.size(); ++i)
+            if(threaded[i].a != pairs[i].a || threaded[i].b != pairs[i].b)
+                ++failures;
+        REQUIRE(failures == 0);
+    }
+
+    // the integer hash spreads sequential cells over the table
+    std::vector<u32> buckets(256, 0);
+    for(int z = 0; z < 16; ++z)
+        for(int y = 0; y < 16; ++y)
+            for(int x = 0; x < 16; ++x)
+                ++buckets[hash_combine(hash_combine(hash_u32((u32)x), (u32)y), (u32)z) & 255];
+    REQUIRE(*std::max_element(buckets.begin(), buckets.end()) < 40);
+}
+
+TEST_CASE( "Morton 3D", "[maths]")
+{
+    u64 d;
+    morton_xyz3d(1, 0, 0, &d);
+    REQUIRE(d == 1);
+    morton_xyz3d(0, 1, 0, &d);
+    REQUIRE(d == 2);
+    morton_xyz3d(0, 0, 1, &d);
+    REQUIRE(d == 4);
+    morton_xyz3d(3, 5, 6, &d);
+    REQUIRE(d == 0x1ab); // zyx triplets 110 101 011
+    morton_xyz3d(0x1fffff, 0x1fffff, 0x1fffff, &d);
+    REQUIRE(d == 0x7fffffffffffffff);
+
+    u32 failures = 0;
+    for(u64 i = 0; i < 10000; ++i)
+    {
+        u64 x = (i * 7919) & 0x1fffff, y = (i * 104729) & 0x1fffff, z = (i * 15485863) & 0x1fffff;
+        u64 rx, ry, rz;
+        morton_xyz3d(x, y, z, &d);
+        morton_d2xyz(d, rx, ry, rz);
+        if(rx != x || ry != y || rz != z)
+            ++failures;
+    }
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Morton 3D 10 Bit", "[maths]")
+{
+    u32 d;
+    morton_xyz3d(3u, 5u, 6u, &d);
+    REQUIRE(d == 0x1ab);
+    morton_xyz3d(0x3ffu, 0x3ffu, 0x3ffu, &d);
+    REQUIRE(d == 0x3fffffff);
+    REQUIRE(morton_2(5) == 0x41);
+    REQUIRE(morton_2_10(5) == 0x41);
+    REQUIRE(morton_3(0x41) == 5);
+    REQUIRE(morton_3_10(0x41) == 5);
+
+    u32 failures = 0;
+    for(u32 i = 0; i < 10000; ++i)
+    {
+        u32 x = (i * 7919) & 0x3ff, y = (i * 104729) & 0x3ff, z = (i * 15485863) & 0x3ff;
+        u32 rx, ry, rz;
+        u64 d64;
+        morton_xyz3d(x, y, z, &d);
+        morton_xyz3d((u64)x, (u64)y, (u64)z, &d64);
+        morton_d2xyz(d, rx, ry, rz);
+        if(rx != x || ry != y || rz != z || d != d64)
+            ++failures;
+    }
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Hilbert 3D", "[maths]")
+{
+    // every cell is visited once and consecutive indices are face neighbours
+    const u32 bits = 3;
+    const u64 n = 1 << (3 * bits);
+    std::vector<bool> visited(n, false);
+    u32 failures = 0;
+    u64 px = 0, py = 0, pz = 0;
+    for(u64 d = 0; d < n; ++d)
+    {
+        u64 x, y, z, rd;
+        hilbert_d2xyz(d, x, y, z, bits);
+        hilbert_xyz3d(x, y, z, &rd, bits);
+        if(rd != d || x >= 8 || y >= 8 || z >= 8 || visited[x + y * 8 + z * 64])
+            ++failures;
+        else
+            visited[x + y * 8 + z * 64] = true;
+        
+        if(d > 0)
+        {
+            u64 md = (x > px ? x - px : px - x) + (y > py ? y - py : py - y) + (z > pz ? z - pz : pz - z);
+            if(md != 1)
+                ++failures;
+        }
+        px = x; py = y; pz = z;
+    }
+    REQUIRE(failures == 0);
+
+    u64 ox, oy, oz;
+    hilbert_d2xyz((u64)0, ox, oy, oz);
+    REQUIRE((ox | oy | oz) == 0);
+
+    for(u64 i = 0; i < 10000; ++i)
+    {
+        u64 x = (i * 7919) & 0x1fffff, y = (i * 104729) & 0x1fffff, z = (i * 15485863) & 0x1fffff;
+        u64 d, rx, ry, rz;
+        hilbert_xyz3d(x, y, z, &d);
+        hilbert_d2xyz(d, rx, ry, rz);
+        u32 d32, rx32, ry32, rz32;
+        hilbert_xyz3d((u32)x & 0x3ff, (u32)y & 0x3ff, (u32)z & 0x3ff, &d32);
+        hilbert_d2xyz(d32, rx32, ry32, rz32);
+        if(rx != x || ry != y || rz != z || rx32 != (x & 0x3ff) || ry32 != (y & 0x3ff) || rz32 != (z & 0x3ff))
+            ++failures;
+    }
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Space Filling Curve Batch", "[maths]")
+{
+    // power of 2 extents so quantisation is exact, z is flat and some points are outside the aabb
+    const size_t n = 1000;
+    std::vector<vec3f> points(n);
+    for(size_t i = 0; i < n; ++i)
+        points[i] = vec3f((f32)(i % 19), (f32)(i % 37) + 0.25f, (f32)(i % 7)) - vec3f(1.0f);
+
+    vec3f bmin = vec3f(0.0f, 0.0f, 2.0f);
+    vec3f bmax = vec3f(16.0f, 32.0f, 2.0f);
+    
+    std::vector<u32> m32(n), h32(n);
+    std::vector<u64> m64(n), h64(n);
+    morton_encode(points.data(), n, bmin, bmax, m32.data());
+    morton_encode(points.data(), n, bmin, bmax, m64.data());
+    hilbert_encode(points.data(), n, bmin, bmax, h32.data());
+    hilbert_encode(points.data(), n, bmin, bmax, h64.data());
+
+    u32 failures = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        u32 c10[3];
+        u64 c21[3];
+        for(u32 j = 0; j < 2; ++j)
+        {
+            f32 t = std::min(std::max((points[i][j] - bmin[j]) / (bmax[j] - bmin[j]), 0.0f), 1.0f);
+            c10[j] = std::min((u32)(t * 1024.0f), 1023u);
+            c21[j] = std::min((u64)(t * 2097152.0f), (u64)2097151);
+        }
+        c10[2] = 0;
+        c21[2] = 0;
+        
+        u32 em32, eh32;
+        u64 em64, eh64;
+        morton_xyz3d(c10[0], c10[1], c10[2], &em32);
+        hilbert_xyz3d(c10[0], c10[1], c10[2], &eh32);
+        morton_xyz3d(c21[0], c21[1], c21[2], &em64);
+        hilbert_xyz3d(c21[0], c21[1], c21[2], &eh64);
+        if(em32 != m32[i] || eh32 != h32[i] || em64 != m64[i] || eh64 != h64[i])
+            ++failures;
+    }
+    REQUIRE(failures == 0);
+    
+#ifdef MATHS_BMI2
+    // bmi2 and generic loops agree
+    if(cpu_supports_bmi2())
+    {
+        curve_quantiser q(bmin, bmax, 21);
+        std::vector<u64> g(n);
+        morton_encode_generic(points.data(), n, q, g.data());
+        REQUIRE(g == m64);
+        hilbert_encode_generic(points.data(), n, q, 21, g.data());
+        REQUIRE(g == h64);
+    }
+#endif
+}
+
+TEST_CASE( "Radix Sort", "[maths]")
+{
+    const size_t n = 20000;
+    std::vector<u32> keys(n), values(n);
+    std::vector<std::pair<u32, u32>> expected(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        keys[i] = hash_u32((u32)i) & 0xfffff0ff; // some duplicate keys and a digit which is always 0
+        values[i] = (u32)i;
+        expected[i] = std::make_pair(keys[i], (u32)i);
+    }
+    std::stable_sort(expected.begin(), expected.end(), [](const std::pair<u32, u32>& a, const std::pair<u32, u32>& b) {
+        return a.first < b.first;
+    });
+
+    maths::radix_sort(keys.data(), values.data(), n);
+    
+    u32 failures = 0;
+    for(size_t i = 0; i < n; ++i)
+        if(keys[i] != expected[i].first || values[i] != expected[i].second)
+            ++failures;
+    REQUIRE(failures == 0);
+    
+    // fewer key bits only sorts the low bits
+    for(size_t i = 0; i < n; ++i)
+        keys[i] = (u32)(n - i) & 0x3ff;
+    maths::radix_sort(keys.data(), values.data(), n, 10);
+    REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+}
+
+TEST_CASE( "Spatial Sort", "[maths]")
+{
+    const size_t n = 5000;
+    std::vector<vec3f> points(n);
+    std::vector<u32> attrib(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        points[i] = vec3f((f32)(hash_u32((u32)i * 3) % 1000), (f32)(hash_u32((u32)i * 3 + 1) % 1000), (f32)(hash_u32((u32)i * 3 + 2) % 1000));
+        attrib[i] = (u32)i * 7;
+    }
+    
+    for(u32 c = 0; c < 2; ++c)
+    {
+        std::vector<u32> perm;
+        maths::spatial_sort(points.data(), n, perm, c == 0 ? maths::CURVE_MORTON : maths::CURVE_HILBERT);
+        REQUIRE(perm.size() == n);
+        
+        std::vector<u32> inv(n, 0xffffffff);
+        maths::invert_permutation(perm.data(), n, inv.data());
+        REQUIRE(std::find(inv.begin(), inv.end(), 0xffffffff) == inv.end());
+        
+        std::vector<vec3f> sorted(n);
+        std::vector<u32> sorted_attrib(n);
+        maths::reorder(points.data(), perm.data(), n, sorted.data());
+        maths::reorder(attrib.data(), perm.data(), n, sorted_attrib.data());
+        
+        // keys of the reordered points are in order, and attributes follow their points
+        std::vector<u32> keys(n);
+        if(c == 0)
+            maths::morton_encode(sorted.data(), n, vec3f(0.0f), vec3f(999.0f), keys.data());
+        else
+            maths::hilbert_encode(sorted.data(), n, vec3f(0.0f), vec3f(999.0f), keys.data());
+        REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+        
+        u32 failures = 0;
+        for(size_t i = 0; i < n; ++i)
+            if(sorted_attrib[i] != perm[i] * 7 || sorted[inv[i]] != points[i])
+                ++failures;
+        REQUIRE(failures == 0);
+        
+        // neighbours in the sorted order are much closer than in the original order
+        f32 before = 0.0f, after = 0.0f;
+        for(size_t i = 1; i < n; ++i)
+        {
+            before += dist(points[i], points[i - 1]);
+            after += dist(sorted[i], sorted[i - 1]);
+        }
+        REQUIRE(after < before * 0.25f);
+    }
+    
+    std::vector<u32> perm;
+    maths::spatial_sort(points.data(), 0, perm);
+    REQUIRE(perm.empty());
+}
+
+namespace
+{
+    // checks every object is linked into the node its bounds key to and the node counts match
+    u32 check_octree(const octree& tree)
+    {
+        u32 failures = 0;
+        for(u32 id = 0; id < (u32)tree.objects.size(); ++id)
+        {
+            const octree_object& obj = tree.objects[id];
+            if(obj.node == k_octree_none)
+                continue;
+
+            u32 depth;
+            if(octree_key(tree, obj.aabb_min, obj.aabb_max, depth) != tree.nodes[obj.node].key)
+                ++failures;
+
+            vec3f loose = vec3f(tree.nodes[obj.node].half * 2.0f);
+            const octree_node& node = tree.nodes[obj.node];
+            if(obj.node != 0 && (!point_inside_aabb(node.centre - loose, node.centre + loose, obj.aabb_min) ||
+                                 !point_inside_aabb(node.centre - loose, node.centre + loose, obj.aabb_max)))
+                ++failures;
+        }
+
+        std::vector<u32> stack = {0};
+        u32 num_objects = 0;
+        while(!stack.empty())
+        {
+            const octree_node& node = tree.nodes[stack.back()];
+            stack.pop_back();
+            u32 count = 0;
+            for(u32 id = node.first; id != k_octree_none; id = tree.objects[id].next)
+                ++count;
+            if(count != node.num_objects || (node.num_objects == 0 && node.num_children == 0 && node.depth > 0))
+                ++failures;
+            num_objects += count;
+            for(u32 i = 0; i < 8; ++i)
+                if(node.children[i] != k_octree_none)
+                    stack.push_back(node.children[i]);
+        }
+
+        if(num_objects != tree.objects.size() - tree.free_objects.size())
+            ++failures;
+        return failures;
+    }
+}
+
+TEST_CASE( "Octree", "[maths]")
+{
+    srand(13);
+    octree tree;
+    create_octree(tree, vec3f(10.0f, 0.0f, 0.0f), 100.0f, 6);
+
+    const size_t n = 2000;
+    std::vector<vec3f> pos(n), ext(n), vel(n);
+    std::vector<u32> ids(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        // some objects start outside of the world bounds and some are larger than the leaves
+        pos[i] = vec3f(rand() % 2400 - 1200, rand() % 2400 - 1200, rand() % 2400 - 1200) / 10.0f + vec3f(10.0f, 0.0f, 0.0f);
+        ext[i] = vec3f(rand() % 100 + 1, rand() % 100 + 1, rand() % 100 + 1) / (rand() % 4 ? 50.0f : 5.0f);
+        vel[i] = vec3f(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100) / 50.0f;
+        ids[i] = octree_add(tree, pos[i] - ext[i], pos[i] + ext[i]);
+    }
+    REQUIRE(check_octree(tree) == 0);
+
+    mat4 view = mat::create_translation(vec3f(10.0f, 0.0f, 0.0f)) * mat::create_y_rotation(0.3f);
+    mat4 view_proj = mat::create_perspective_projection(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 100.0f) * mat::inverse4x4(view);
+    vec4f planes[6];
+    get_frustum_planes_from_matrix(view_proj, &planes[0]);
+
+    u32 failures = 0;
+    size_t visible = 0, hits = 0;
+    std::vector<u32> results;
+    std::vector<bool> alive(n, true);
+    for(u32 frame = 0; frame < 20; ++frame)
+    {
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(!alive[i])
+                continue;
+            pos[i] += vel[i];
+            octree_move(tree, ids[i], pos[i] - ext[i], pos[i] + ext[i]);
+        }
+
+        // remove and re-add a few to exercise the pools
+        for(u32 k = 0; k < 10; ++k)
+        {
+            u32 i = rand() % n;
+            if(alive[i])
+                octree_remove(tree, ids[i]);
+            else
+                ids[i] = octree_add(tree, pos[i] - ext[i], pos[i] + ext[i]);
+            alive[i] = !alive[i];
+        }
+
+        failures += check_octree(tree);
+
+        results.clear();
+        octree_vs_frustum(tree, planes, results);
+        std::sort(results.begin(), results.end());
+        std::vector<u32> brute;
+        for(u32 i = 0; i < n; ++i)
+            if(alive[i] && aabb_vs_frustum(pos[i], ext[i], planes))
+                brute.push_back(ids[i]);
+        std::sort(brute.begin(), brute.end());
+        if(results != brute)
+            ++failures;
+        visible += brute.size();
+
+        vec3f r0 = vec3f(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100);
+        vec3f rv = normalised(vec3f(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100) + vec3f(0.5f));
+        results.clear();
+        ray_vs_octree(tree, r0, rv, results, 150.0f);
+        std::sort(results.begin(), results.end());
+        brute.clear();
+        vec3f inv_rv = vec3f::one() / rv;
+        for(u32 i = 0; i < n; ++i)
+        {
+            f32 t;
+            if(alive[i] && ray_vs_aabb(pos[i] - ext[i], pos[i] + ext[i], r0, inv_rv, 150.0f, t))
+                brute.push_back(ids[i]);
+        }
+        std::sort(brute.begin(), brute.end());
+        if(results != brute)
+            ++failures;
+        hits += brute.size();
+    }
+
+    REQUIRE(visible > 100);
+    REQUIRE(hits > 20);
+    REQUIRE(failures == 0);
+
+    // removing everything returns all nodes but the root to the pool
+    for(u32 i = 0; i < n; ++i)
+        if(alive[i])
+            octree_remove(tree, ids[i]);
+    REQUIRE(tree.nodes.size() - tree.free_nodes.size() == 1);
+    REQUIRE(tree.nodes[0].num_children == 0);
+}
+
+TEST_CASE( "Batch Transform", "[maths]")
+{
+    struct vertex
+    {
+        vec3f pos;
+        vec3f normal;
+        vec3f tangent;
+        vec2f uv;
+    };
+
+    mat4 m = mat::create_translation(vec3f(1.0f, -2.0f, 3.0f)) * mat::create_rotation(normalised(vec3f(1.0f, 2.0f, 3.0f)), 0.7f) *
+             mat::create_scale(vec3f(2.0f, 0.5f, 3.0f));
+    
+    const size_t n = 257;
+    std::vector<vertex> verts(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        f32 a = (f32)i * 0.1f;
+        verts[i].pos = vec3f(sin(a) * 10.0f, cos(a * 0.3f) * 5.0f, (f32)i * 0.01f);
+        verts[i].normal = normalised(vec3f(cos(a), 0.5f, sin(a)));
+        verts[i].tangent = normalised(cross(verts[i].normal, vec3f::unit_y()));
+        verts[i].uv = vec2f(a, 1.0f);
+    }
+    
+    u32 failures = 0;
+    for(u32 nt = 0; nt < 2; ++nt)
+    {
+        std::vector<vertex> out = verts;
+        std::vector<vec3f> pos(n);
+        mat::transform_points(m, &verts[0].pos, sizeof(vertex), &pos[0], sizeof(vec3f), n, nt == 1);
+        mat::transform_directions(m, &verts[0].tangent, sizeof(vertex), &out[0].tangent, sizeof(vertex), n, nt == 1);
+        mat::transform_normals(m, &verts[0].normal, sizeof(vertex), &out[0].normal, sizeof(vertex), n, nt == 1);
+        
+        // in place
+        mat::transform_points(m, &out[0].pos, sizeof(vertex), &out[0].pos, sizeof(vertex), n, nt == 1);
+        
+        for(size_t i = 0; i < n; ++i)
+        {
+            vec3f ep = m.transform_vector(verts[i].pos);
+            vec4f et = m.transform_vector(vec4f(verts[i].tangent, 0.0f));
+            if(dist(pos[i], ep) > 1e-4f || dist(out[i].pos, ep) > 1e-4f || dist(out[i].tangent, et.xyz) > 1e-4f)
+                ++failures;
+            
+            // normals stay unit length and perpendicular to transformed tangents
+            if(abs(mag(out[i].normal) - 1.0f) > 1e-4f || abs(dot(out[i].normal, normalised(out[i].tangent))) > 1e-4f)
+                ++failures;
+            
+            // other attributes are untouched
+            if(out[i].uv != verts[i].uv)
+                ++failures;
+        }
+    }
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Affine 3x4", "[maths]")
+{
+    mat4 a4 = mat::create_translation(vec3f(1.0f, -2.0f, 3.0f)) * mat::create_rotation(normalised(vec3f(1.0f, 2.0f, 3.0f)), 0.7f) *
+              mat::create_scale(vec3f(2.0f, 0.5f, 3.0f));
+    mat4 b4 = mat::create_translation(vec3f(-4.0f, 0.5f, 2.0f)) * mat::create_y_rotation(1.3f) * mat::create_scale(vec3f(0.25f));
+    
+    mat34 a = mat::to3x4(a4);
+    mat34 b = mat::to3x4(b4);
+    mat4 a44 = mat::to4x4(a);
+    REQUIRE(memcmp(&a44, &a4, sizeof(mat4)) == 0);
+    
+    // product matches the 4x4 product
+    mat34 ab = a * b;
+    mat4 ab4 = a4 * b4;
+    u32 failures = 0;
+    for(size_t i = 0; i < 12; ++i)
+        if(abs(ab.m[i] - ab4.m[i]) > 1e-4f)
+            ++failures;
+    REQUIRE(failures == 0);
+    
+    // inverse matches the 4x4 inverse and undoes the transform
+    mat34 ia = mat::inverse3x4(a);
+    mat4 ia4 = mat::inverse4x4(a4);
+    for(size_t i = 0; i < 12; ++i)
+        if(abs(ia.m[i] - ia4.m[i]) > 1e-4f)
+            ++failures;
+    REQUIRE(failures == 0);
+    
+    mat34 id = a * ia;
+    mat4 identity = mat4::create_identity();
+    for(size_t i = 0; i < 12; ++i)
+        if(abs(id.m[i] - identity.m[i]) > 1e-4f)
+            ++failures;
+    REQUIRE(failures == 0);
+    
+    // point and direction transforms
+    vec3f p = vec3f(0.3f, -1.2f, 4.0f);
+    REQUIRE(require_func(mat::transform_point(a, p), a4.transform_vector(p)));
+    REQUIRE(require_func(a.transform_vector(p), a4.transform_vector(p)));
+    REQUIRE(require_func(mat::transform_direction(a, p), (vec3f)a4.transform_vector(vec4f(p, 0.0f)).xyz));
+    REQUIRE(require_func(a * vec4f(p, 1.0f), a4 * vec4f(p, 1.0f)));
+    REQUIRE(require_func(a * vec4f(p, 0.0f), a4 * vec4f(p, 0.0f)));
+    REQUIRE(require_func(mat::transform_point(ia, mat::transform_point(a, p)), p));
+    
+    std::vector<vec3f> pts(5, p), out(5);
+    mat::transform_points(a, pts.data(), sizeof(vec3f), out.data(), sizeof(vec3f), pts.size());
+    REQUIRE(require_func(out[4], a4.transform_vector(p)));
+}
+
+TEST_CASE( "Mat4 Multiply", "[maths]")
+{
+    u32 failures = 0;
+    for(u32 i = 0; i < 100; ++i)
+    {
+        mat4 a, b;
+        Mat<4, 4, f64> ad, bd;
+        Vec<4, f32> v;
+        Vec<4, f64> vd;
+        for(u32 j = 0; j < 16; ++j)
+        {
+            a.m[j] = (f32)(hash_u32(i * 64 + j) % 2000) / 100.0f - 10.0f;
+            b.m[j] = (f32)(hash_u32(i * 64 + j + 16) % 2000) / 100.0f - 10.0f;
+            ad.m[j] = a.m[j];
+            bd.m[j] = b.m[j];
+        }
+        for(u32 j = 0; j < 4; ++j)
+        {
+            v[j] = (f32)(hash_u32(i * 64 + j + 32) % 2000) / 100.0f - 10.0f;
+            vd[j] = v[j];
+        }
+        
+        // reference in doubles with the generic loop
+        Mat<4, 4, f64> ref = mat_multiply<4, 4, f64>(ad, bd);
+        Vec<4, f64> refv = mat_multiply<4, 4, f64>(ad, vd);
+        
+        mat4 ab = a * b;
+        Mat<4, 4, f64> abd = ad * bd;
+        Vec<4, f32> av = a * v;
+        Vec<4, f64> avd = ad * vd;
+        vec3f tv = a.transform_vector((vec3f)v.xyz);
+        for(u32 j = 0; j < 16; ++j)
+            if(abs((f64)ab.m[j] - ref.m[j]) > 1e-3 || abs(abd.m[j] - ref.m[j]) > 1e-9)
+                ++failures;
+        for(u32 j = 0; j < 4; ++j)
+            if(abs((f64)av[j] - refv[j]) > 1e-3 || abs(avd[j] - refv[j]) > 1e-9)
+                ++failures;
+        
+        Vec<4, f64> tref = mat_multiply<4, 4, f64>(ad, Vec<4, f64>(vd.x, vd.y, vd.z, 1.0));
+        for(u32 j = 0; j < 3; ++j)
+            if(abs((f64)tv[j] - tref[j]) > 1e-3)
+                ++failures;
+    }
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Batch Inverse", "[maths]")
+{
+    const size_t n = 37;
+    std::vector<mat4> mats(n);
+    soa_mat4f soa(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        f32 a = (f32)i * 0.37f;
+        mats[i] = mat::create_translation(vec3f(sin(a) * 10.0f, (f32)i, cos(a))) * mat::create_rotation(normalised(vec3f(1.0f, a, 2.0f)), a) *
+                  mat::create_scale(vec3f(1.0f + (f32)(i % 3), 0.5f, 2.0f));
+        if(i % 5 == 0)
+            mats[i] = mat::create_perspective_projection(-1.0f, 1.0f, -1.0f, 1.0f, 0.1f, 100.0f + (f32)i) * mats[i]; // non affine
+        soa.set(i, Vec<16, f32>(mats[i].m));
+    }
+    
+    soa_mat4f inv4, inv8, fused_inv;
+    soa_mat3f nm4, fused_nm;
+    maths::inverse4x4<4>(soa, inv4);
+    maths::inverse4x4<8>(soa, inv8);
+    maths::inverse_transpose3x3<4>(soa, nm4);
+    maths::inverse4x4<16>(soa, fused_inv, fused_nm);
+    REQUIRE(inv8.size() == n);
+    
+    u32 failures = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        mat4 ref = mat::inverse4x4(mats[i]);
+        mat4 ref_nm = mat::inverse3x3(mats[i]).transposed();
+        
+        f32 scalar[16];
+        maths::inverse4x4(mats[i].m, scalar);
+        
+        for(size_t j = 0; j < 16; ++j)
+        {
+            f32 e = 1e-3f * std::max(1.0f, abs(ref.m[j]));
+            if(abs(inv4.component(j)[i] - ref.m[j]) > e || abs(inv8.component(j)[i] - ref.m[j]) > e ||
+               abs(fused_inv.component(j)[i] - ref.m[j]) > e || abs(scalar[j] - ref.m[j]) > e)
+                ++failures;
+        }
+        
+        // normal matrix is the inverse transpose of the upper 3x3
+        mat3 upper = mat::to3x3(mats[i]);
+        for(size_t r = 0; r < 3; ++r)
+            for(size_t c = 0; c < 3; ++c)
+            {
+                f32 e = 1e-3f * std::max(1.0f, abs(ref_nm.at(r, c)));
+                if(i % 5 != 0 && (abs(nm4.component(r * 3 + c)[i] - ref_nm.at(r, c)) > e || abs(fused_nm.component(r * 3 + c)[i] - ref_nm.at(r, c)) > e))
+                    ++failures;
+                
+                // (inverse transpose)^T * upper = identity
+                f32 id = 0.0f;
+                for(size_t k = 0; k < 3; ++k)
+                    id += nm4.component(k * 3 + r)[i] * upper.at(k, c);
+                if(abs(id - (r == c ? 1.0f : 0.0f)) > 1e-3f)
+                    ++failures;
+            }
+    }
+    REQUIRE(failures == 0);
+}
+
+TEST_CASE( "Column Major Mat", "[maths]")
+{
+    // element order and accessors
+    mat2_cm m2(1.0f, 2.0f, 3.0f, 4.0f);
+    REQUIRE(m2.at(0, 1) == 2.0f);
+    REQUIRE(m2.m[1] == 3.0f);
+    REQUIRE(m2.get_column(1).y == 4.0f);
+    
+    u32 failures = 0;
+    for(u32 i = 0; i < 100; ++i)
+    {
+        mat4 a, b;
+        Mat<4, 4, f64> ad;
+        Vec<4, f32> v;
+        Vec<4, f64> vd;
+        for(u32 j = 0; j < 16; ++j)
+        {
+            a.m[j] = (f32)(hash_u32(i * 64 + j) % 2000) / 100.0f - 10.0f;
+            b.m[j] = (f32)(hash_u32(i * 64 + j + 16) % 2000) / 100.0f - 10.0f;
+            ad.m[j] = a.m[j];
+        }
+        for(u32 j = 0; j < 4; ++j)
+        {
+            v[j] = (f32)(hash_u32(i * 64 + j + 32) % 2000) / 100.0f - 10.0f;
+            vd[j] = v[j];
+        }
+        
+        mat4_cm ac = a;
+        mat4_cm bc = b;
+        Mat<4, 4, f64, mat_column_major> adc = ad;
+        for(u32 r = 0; r < 4; ++r)
+            for(u32 c = 0; c < 4; ++c)
+                if(ac.m[c * 4 + r] != a.m[r * 4 + c] || ac(r, c) != a(r, c))
+                    ++failures;
+        
+        for(u32 j = 0; j < 4; ++j)
+            if(!(ac.get_row(j) == a.get_row(j)) || !(ac.get_column(j) == a.get_column(j)))
+                ++failures;
+        
+        // products match the row major ones element for element
+        mat4 ab = a * b;
+        mat4_cm abc = ac * bc;
+        Vec<4, f32> av = a * v;
+        Vec<4, f32> avc = ac * v;
+        Vec<4, f64> avd = ad * vd;
+        Vec<4, f64> avdc = adc * vd;
+        vec3f tv = a.transform_vector((vec3f)v.xyz);
+        vec3f tvc = ac.transform_vector((vec3f)v.xyz);
+        for(u32 r = 0; r < 4; ++r)
+        {
+            for(u32 c = 0; c < 4; ++c)
+                if(abs(abc(r, c) - ab(r, c)) > 1e-3f)
+                    ++failures;
+            
+            if(abs(avc[r] - av[r]) > 1e-3f || abs(avdc[r] - avd[r]) > 1e-9)
+                ++failures;
+        }
+        for(u32 j = 0; j < 3; ++j)
+            if(abs(tvc[j] - tv[j]) > 1e-3f)
+                ++failures;
+        
+        // round trip back to row major
+        mat4 back = ac;
+        if(memcmp(back.m, a.m, sizeof(a.m)) != 0)
+            ++failures;
+        
+        // affine
+        mat34 a34 = mat::to3x4(a);
+        mat34 b34 = mat::to3x4(b);
+        mat34_cm a34c = a34;
+        mat34_cm b34c = b34;
+        mat34 ab34 = a34 * b34;
+        mat34_cm ab34c = a34c * b34c;
+        for(u32 r = 0; r < 3; ++r)
+            for(u32 c = 0; c < 4; ++c)
+                if(abs(ab34c(r, c) - ab34(r, c)) > 1e-3f)
+                    ++failures;
+        
+        vec3f t34 = a34.transform_vector((vec3f)v.xyz);
+        vec3f t34c = a34c.transform_vector((vec3f)v.xyz);
+        if(dist(t34, t34c) > 1e-3f || dist(ac.get_translation(), a.get_translation()) > 0.0f)
+            ++failures;
+    }
+    REQUIRE(failures == 0);
+}
+
+// repeatable value in [-1, 1) from a seed, for generating test data
+f32 hash_rnd(u32 seed)
+{
+    return (f32)(hash_u32(seed) % 20000) / 10000.0f - 1.0f;
+}
+
+TEST_CASE( "Batch Slerp", "[maths]")
+{
+    // polynomial approximations
+    f32 acos_err = 0.0f;
+    f32 sin_err = 0.0f;
+    for(u32 i = 0; i <= 1000; ++i)
+    {
+        f32 x = (f32)i / 1000.0f;
+        acos_err = std::max(acos_err, abs(approx_acos(x) - (f32)acos((f64)x)));
+        f32 a = x * (f32)M_PI * 0.5f;
+        sin_err = std::max(sin_err, abs(approx_sin(a) - (f32)sin((f64)a)));
+    }
+    REQUIRE(acos_err < 5e-7f);
+    REQUIRE(sin_err < 5e-7f);
+    
+    // random pairs, with some identical, nearly identical and opposite hemisphere
+    const size_t n = 1003;
+    std::vector<quat> a(n), b(n);
+    std::vector<f32> t(n);
+    soa_quatf sa(n), sb(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        u32 seed = (u32)i * 8;
+        a[i] = quat(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2), hash_rnd(seed + 3));
+        normalise(a[i]);
+        if(i % 7 == 0)
+            b[i] = a[i];
+        else if(i % 7 == 1)
+            b[i] = quat(a[i].x + 1e-3f, a[i].y, a[i].z, a[i].w);
+        else
+            b[i] = quat(hash_rnd(seed + 4), hash_rnd(seed + 5), hash_rnd(seed + 6), hash_rnd(seed + 7));
+        normalise(b[i]);
+        t[i] = (hash_rnd(seed + 8) + 1.0f) * 0.5f;
+        sa.set(i, vec4f(a[i].x, a[i].y, a[i].z, a[i].w));
+        sb.set(i, vec4f(b[i].x, b[i].y, b[i].z, b[i].w));
+    }
+    
+    soa_quatf s4, s8, s16, su, nl, nlu;
+    maths::slerp<4>(sa, sb, t.data(), s4);
+    maths::slerp<8>(sa, sb, t.data(), s8);
+    maths::slerp<16>(sa, sb, t.data(), s16);
+    maths::slerp(sa, sb, 0.25f, su);
+    maths::nlerp(sa, sb, t.data(), nl);
+    maths::nlerp(sa, sb, 0.25f, nlu);
+    REQUIRE(s8.size() == n);
+    
+    f32 slerp_err = 0.0f;
+    f32 nlerp_err = 0.0f;
+    for(size_t i = 0; i < n; ++i)
+    {
+        quat ref = slerp(a[i], b[i], t[i]);
+        quat refu = slerp(a[i], b[i], 0.25f);
+        
+        // nlerp reference along the shorter arc
+        quat bs = dot(a[i], b[i]) < 0.0f ? -b[i] : b[i];
+        quat refn = a[i] * (1.0f - t[i]) + bs * t[i];
+        normalise(refn);
+        quat refnu = a[i] * 0.75f + bs * 0.25f;
+        normalise(refnu);
+        
+        for(size_t j = 0; j < 4; ++j)
+        {
+            slerp_err = std::max(slerp_err, abs(s8.component(j)[i] - ref.v[j]));
+            slerp_err = std::max(slerp_err, abs(su.component(j)[i] - refu.v[j]));
+            nlerp_err = std::max(nlerp_err, abs(nl.component(j)[i] - refn.v[j]));
+            nlerp_err = std::max(nlerp_err, abs(nlu.component(j)[i] - refnu.v[j]));
+            CHECK(abs(s4.component(j)[i] - s8.component(j)[i]) <= 1e-6f);
+            CHECK(abs(s16.component(j)[i] - s8.component(j)[i]) <= 1e-6f);
+        }
+    }
+    REQUIRE(slerp_err < 1e-6f);
+    REQUIRE(nlerp_err < 1e-6f);
+    
+    // pairs 0.005 to 0.1 radians apart, the spacing of typical keyframes, against a double precision slerp
+    soa_quatf sc(n), sd(n), sk;
+    f32 close_err = 0.0f;
+    for(size_t i = 0; i < n; ++i)
+    {
+        u32 seed = (u32)i * 8 + 50000;
+        quat delta;
+        vec3f axis = normalised(vec3f(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2)) + vec3f(0.01f));
+        delta.axis_angle(axis, 0.005f + (hash_rnd(seed + 3) + 1.0f) * 0.0475f);
+        quat c = a[i] * delta;
+        normalise(c);
+        sc.set(i, vec4f(a[i].x, a[i].y, a[i].z, a[i].w));
+        sd.set(i, vec4f(c.x, c.y, c.z, c.w));
+    }
+    maths::slerp(sc, sd, t.data(), sk);
+    for(size_t i = 0; i < n; ++i)
+    {
+        vec4f qa = sc.get(i);
+        vec4f qc = sd.get(i);
+        quatd ref = slerp(quatd(qa.x, qa.y, qa.z, qa.w), quatd(qc.x, qc.y, qc.z, qc.w), (f64)t[i]);
+        for(size_t j = 0; j < 4; ++j)
+            close_err = std::max(close_err, (f32)abs((f64)sk.component(j)[i] - ref.v[j]));
+    }
+    REQUIRE(close_err < 1e-6f);
+}
+
+TEST_CASE( "Anim Sample", "[maths]")
+{
+    // channels with no keys, one key, and keys at irregular times per track
+    const size_t n = 13;
+    std::vector<maths::anim_channel_keys> keys(n);
+    for(size_t c = 1; c < n; ++c)
+    {
+        u32 seed = (u32)c * 1024;
+        u32 nt = (u32)(c % 4) + 1;
+        u32 nr = (u32)(c % 5) * 3 + 1;
+        u32 ns = c % 3 == 0 ? 0 : (u32)c;
+        f32 time = 0.0f;
+        for(u32 k = 0; k < nt; ++k, time += 0.5f + hash_rnd(seed + k) * 0.4f)
+        {
+            u32 sk = seed + k;
+            keys[c].translation_times.push_back(time);
+            keys[c].translations.push_back(vec3f(hash_rnd(sk + 10), hash_rnd(sk + 20), hash_rnd(sk + 30)) * 10.0f);
+        }
+        time = 0.1f;
+        for(u32 k = 0; k < nr; ++k, time += 0.3f + hash_rnd(seed + k + 40) * 0.2f)
+        {
+            u32 sk = seed + k;
+            quat q = quat(hash_rnd(sk + 50), hash_rnd(sk + 60), hash_rnd(sk + 70), hash_rnd(sk + 80));
+            normalise(q);
+            keys[c].rotation_times.push_back(time);
+            keys[c].rotations.push_back(q);
+        }
+        time = 0.0f;
+        for(u32 k = 0; k < ns; ++k, time += 0.25f)
+        {
+            keys[c].scale_times.push_back(time);
+            keys[c].scales.push_back(vec3f(1.0f + hash_rnd(seed + k + 90) * 0.5f));
+        }
+    }
+    
+    maths::anim_clip clip;
+    maths::create_anim_clip(clip, keys.data(), n);
+    REQUIRE(clip.duration > 0.0f);
+    
+    // brute force reference
+    auto find = [](const std::vector<f32>& times, f32 t, size_t& k0, size_t& k1, f32& u) {
+        k0 = 0;
+        while(k0 + 1 < times.size() && times[k0 + 1] <= t)
+            ++k0;
+        k1 = std::min(k0 + 1, times.size() - 1);
+        f32 span = times[k1] - times[k0];
+        u = span > 0.0f ? std::min(std::max((t - times[k0]) / span, 0.0f), 1.0f) : 0.0f;
+    };
+    
+    auto reference = [&](size_t c, f32 t) {
+        maths::transform r;
+        size_t k0, k1;
+        f32 u;
+        const maths::anim_channel_keys& ck = keys[c];
+        if(!ck.translations.empty())
+        {
+            find(ck.translation_times, t, k0, k1, u);
+            r.translation = lerp(ck.translations[k0], ck.translations[k1], u);
+        }
+        if(!ck.rotations.empty())
+        {
+            find(ck.rotation_times, t, k0, k1, u);
+            r.rotation = slerp(ck.rotations[k0], ck.rotations[k1], u);
+        }
+        if(!ck.scales.empty())
+        {
+            find(ck.scale_times, t, k0, k1, u);
+            r.scale = lerp(ck.scales[k0], ck.scales[k1], u);
+        }
+        return r;
+    };
+    
+    // forward playback, a loop back, a seek and back again
+    std::vector<f32> times;
+    for(f32 t = -0.1f; t < clip.duration + 0.2f; t += 0.033f)
+        times.push_back(t);
+    times.push_back(0.2f);
+    times.push_back(clip.duration * 0.7f);
+    times.push_back(clip.duration * 0.3f);
+    
+    maths::anim_cursor cursor;
+    maths::anim_cursor cursor4;
+    maths::anim_cursor cursor_mat;
+    std::vector<maths::transform> pose(n), pose4(n);
+    std::vector<mat34> mats(n);
+    for(f32 t : times)
+    {
+        maths::anim_sample(clip, cursor, t, pose.data());
+        maths::anim_sample<4>(clip, cursor4, t, pose4.data());
+        maths::anim_sample(clip, cursor_mat, t, mats.data());
+        
+        for(size_t c = 0; c < n; ++c)
+        {
+            maths::transform ref = reference(c, t);
+            CHECK(dist(pose[c].translation, ref.translation) <= 1e-4f);
+            CHECK(dist(pose4[c].translation, ref.translation) <= 1e-4f);
+            CHECK(dist(pose[c].scale, ref.scale) <= 1e-5f);
+            
+            for(size_t j = 0; j < 4; ++j)
+            {
+                CHECK(abs(pose[c].rotation.v[j] - ref.rotation.v[j]) <= 1e-5f);
+                CHECK(abs(pose4[c].rotation.v[j] - ref.rotation.v[j]) <= 1e-5f);
+            }
+            
+            mat4 rm;
+            ref.rotation.get_matrix(rm);
+            mat4 trs = mat::create_translation(ref.translation) * rm * mat::create_scale(ref.scale);
+            for(size_t j = 0; j < 12; ++j)
+                CHECK(abs(mats[c].m[j] - trs.m[j]) <= 1e-4f);
+        }
+    }
+    
+    // dense keys 0.005 to 0.1 radians apart, sampled between keys against a double precision slerp
+    {
+        const size_t nd = 9;
+        std::vector<maths::anim_channel_keys> dense(nd);
+        for(size_t c = 0; c < nd; ++c)
+        {
+            u32 seed = (u32)c * 4096 + 7;
+            quat q = quat(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2), hash_rnd(seed + 3));
+            normalise(q);
+            for(u32 k = 0; k < 60; ++k)
+            {
+                dense[c].rotation_times.push_back((f32)k / 30.0f);
+                dense[c].rotations.push_back(q);
+                quat delta;
+                u32 sk = seed + k * 4;
+                vec3f axis = normalised(vec3f(hash_rnd(sk + 4), hash_rnd(sk + 5), hash_rnd(sk + 6)) + vec3f(0.01f));
+                delta.axis_angle(axis, 0.005f + (hash_rnd(sk + 7) + 1.0f) * 0.0475f);
+                q = q * delta;
+                normalise(q);
+            }
+        }
+        
+        maths::anim_clip dense_clip;
+        maths::create_anim_clip(dense_clip, dense.data(), nd);
+        maths::anim_cursor dense_cursor;
+        std::vector<maths::transform> dense_pose(nd);
+        f32 err = 0.0f;
+        for(f32 t = 0.0f; t < dense_clip.duration; t += 0.0123f)
+        {
+            maths::anim_sample(dense_clip, dense_cursor, t, dense_pose.data());
+            for(size_t c = 0; c < nd; ++c)
+            {
+                size_t k0 = std::min((size_t)(t * 30.0f), dense[c].rotations.size() - 2);
+                const quat& q0 = dense[c].rotations[k0];
+                const quat& q1 = dense[c].rotations[k0 + 1];
+                f64 u = ((f64)t - (f64)dense[c].rotation_times[k0]) * 30.0;
+                quatd ref = slerp(quatd(q0.x, q0.y, q0.z, q0.w), quatd(q1.x, q1.y, q1.z, q1.w), u);
+                for(size_t j = 0; j < 4; ++j)
+                    err = std::max(err, (f32)abs((f64)dense_pose[c].rotation.v[j] - ref.v[j]));
+            }
+        }
+        REQUIRE(err < 2e-6f);
+    }
+}
+
+// rotation angle between unit quaternions, from the chord as acos of the dot is too coarse for small angles
+f32 quat_angle(const quat& a, const quat& b)
+{
+    vec4f d = vec4f(a.v) - vec4f(b.v) * (dot(a, b) < 0.0f ? -1.0f : 1.0f);
+    return 4.0f * asin(std::min(mag(d) * 0.5f, 1.0f));
+}
+
+TEST_CASE( "Quat Compression", "[maths]")
+{
+    // random rotations, with the largest component in each position and axis aligned ones
+    const size_t n = 1003;
+    std::vector<quat> q(n);
+    soa_quatf sq(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        u32 seed = (u32)i * 4;
+        if(i < 8)
+            q[i] = quat(i == 0 || i == 4 ? 1.0f : 0.0f, i == 1 || i == 5 ? 1.0f : 0.0f, i == 2 || i == 6 ? 1.0f : 0.0f, i == 3 || i == 7 ? 1.0f : 0.0f) * (i < 4 ? 1.0f : -1.0f);
+        else
+            q[i] = quat(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2), hash_rnd(seed + 3));
+        normalise(q[i]);
+        sq.set(i, vec4f(q[i].x, q[i].y, q[i].z, q[i].w));
+    }
+    
+    // error falls with bits
+    quantise_error e32 = quat_quantise_error(q.data(), n, 10);
+    quantise_error e48 = quat_quantise_error(q.data(), n, 15);
+    quantise_error e62 = quat_quantise_error(q.data(), n, k_quat_max_bits);
+    REQUIRE(e32.max_error < 0.004f);
+    REQUIRE(e48.max_error < 0.00015f);
+    REQUIRE(e62.max_error <= e48.max_error);
+    REQUIRE(e32.mean_error < e32.max_error);
+    
+    std::vector<u32> p32(n), b32(n);
+    std::vector<packed_quat48> p48(n), b48(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        p32[i] = pack_quat32(q[i]);
+        p48[i] = pack_quat48(q[i]);
+    }
+    
+    soa_quatf u32_4, u32_8, u32_16, u48;
+    maths::pack_quat32<4>(sq, b32.data());
+    maths::unpack_quat32<4>(p32.data(), n, u32_4);
+    maths::unpack_quat32<8>(p32.data(), n, u32_8);
+    maths::unpack_quat32<16>(p32.data(), n, u32_16);
+    maths::pack_quat48(sq, b48.data());
+    maths::unpack_quat48(p48.data(), n, u48);
+    REQUIRE(u32_8.size() == n);
+    
+    // batch matches scalar, a component may round the other way on a tie
+    u32 mismatches = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        quat r32 = unpack_quat32(p32[i]);
+        quat r48 = unpack_quat48(p48[i]);
+        CHECK(quat_angle(r32, q[i]) <= 0.004f);
+        CHECK(quat_angle(r48, q[i]) <= 0.00015f);
+        
+        // largest component is positive
+        u32 largest = 0;
+        for(u32 j = 1; j < 4; ++j)
+            if(abs(q[i].v[j]) > abs(q[i].v[largest]))
+                largest = j;
+        CHECK(r32.v[largest] >= 0.0f);
+        
+        vec4f v32 = vec4f(r32.x, r32.y, r32.z, r32.w);
+        vec4f v48 = vec4f(r48.x, r48.y, r48.z, r48.w);
+        CHECK(max(abs(u32_4.get(i) - v32)) <= 1e-6f);
+        CHECK(max(abs(u32_8.get(i) - v32)) <= 1e-6f);
+        CHECK(max(abs(u32_16.get(i) - v32)) <= 1e-6f);
+        CHECK(max(abs(u48.get(i) - v48)) <= 1e-6f);
+        
+        if(b32[i] != p32[i] || memcmp(&b48[i], &p48[i], sizeof(packed_quat48)) != 0)
+            ++mismatches;
+    }
+    REQUIRE(mismatches < 4);
+}
+
+TEST_CASE( "Transform Compression", "[maths]")
+{
+    const size_t n = 500;
+    std::vector<transform> t(n);
+    std::vector<vec3f> translations(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        u32 seed = (u32)i * 10;
+        t[i].translation = vec3f(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2)) * 50.0f;
+        t[i].rotation = quat(hash_rnd(seed + 3), hash_rnd(seed + 4), hash_rnd(seed + 5), hash_rnd(seed + 6));
+        normalise(t[i].rotation);
+        t[i].scale = vec3f(1.0f + hash_rnd(seed + 7) * 0.5f, 1.0f, 2.0f);
+        translations[i] = t[i].translation;
+    }
+    
+    REQUIRE(sizeof(packed_transform) == 18);
+    REQUIRE(sizeof(packed_quat48) == 6);
+    
+    transform_range range = compute_transform_range(t.data(), n);
+    REQUIRE(range.scale_min.z == 2.0f);
+    REQUIRE(range.scale_max.z == 2.0f);
+    
+    // half a step of the range per axis at most
+    f32 step = (range.translation_max.x - range.translation_min.x) / 65535.0f;
+    for(size_t i = 0; i < n; ++i)
+    {
+        transform r = unpack_transform(pack_transform(t[i], range), range);
+        vec3f et = abs(r.translation - t[i].translation);
+        CHECK(max(et) <= step);
+        
+        // zero extent axes decode exactly
+        CHECK(abs(r.scale.x - t[i].scale.x) <= 1e-4f);
+        CHECK(r.scale.y == 1.0f);
+        CHECK(r.scale.z == 2.0f);
+        
+        CHECK(quat_angle(r.rotation, t[i].rotation) <= 0.00015f);
+    }
+    
+    // out of range clamps
+    vec3f c = unpack_vec3(pack_vec3(vec3f(-100.0f, 0.5f, 100.0f), vec3f::zero(), vec3f::one(), 8), vec3f::zero(), vec3f::one(), 8);
+    REQUIRE(c.x == 0.0f);
+    REQUIRE(abs(c.y - 0.5f) < 0.51f / 255.0f);
+    REQUIRE(c.z == 1.0f);
+    
+    quantise_error e8 = vec3_quantise_error(translations.data(), n, range.translation_min, range.translation_max, 8);
+    quantise_error e16 = vec3_quantise_error(translations.data(), n, range.translation_min, range.translation_max, 16);
+    quantise_error e21 = vec3_quantise_error(translations.data(), n, range.translation_min, range.translation_max, k_vec3_max_bits);
+    REQUIRE(e8.max_error < 100.0f / 255.0f);
+    REQUIRE(e16.max_error < e8.max_error);
+    REQUIRE(e21.max_error < e16.max_error);
+}
+
+TEST_CASE( "Compose Affine", "[maths]")
+{
+    const size_t n = 1003;
+    std::vector<transform> t(n);
+    soa3f st(n), ss(n);
+    soa_quatf sr(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        u32 seed = (u32)i * 10;
+        t[i].translation = vec3f(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2)) * 100.0f;
+        t[i].rotation = quat(hash_rnd(seed + 3), hash_rnd(seed + 4), hash_rnd(seed + 5), hash_rnd(seed + 6));
+        normalise(t[i].rotation);
+        t[i].scale = vec3f(hash_rnd(seed + 7), hash_rnd(seed + 8), hash_rnd(seed + 9)) * 2.0f + vec3f(2.5f);
+        st.set(i, t[i].translation);
+        sr.set(i, vec4f(t[i].rotation.v));
+        ss.set(i, t[i].scale);
+    }
+    
+    std::vector<mat4> m4(n), m4_4(n), m4_16(n);
+    std::vector<mat34> m34(n);
+    maths::compose_affine(st, sr, ss, m34.data());
+    maths::compose_affine(st, sr, ss, m4.data());
+    maths::compose_affine<4>(st, sr, ss, m4_4.data());
+    maths::compose_affine<16>(st, sr, ss, m4_16.data());
+    
+    for(size_t i = 0; i < n; ++i)
+    {
+        // translation * rotation * scale
+        mat4 rot;
+        quat q = t[i].rotation;
+        q.get_matrix(rot);
+        mat4 ref = mat::create_translation(t[i].translation) * rot * mat::create_scale(t[i].scale);
+        mat4 single = get_matrix_from_transform(t[i]);
+        
+        for(u32 j = 0; j < 16; ++j)
+        {
+            f32 tol = 1e-5f * std::max(abs(ref.m[j]), 1.0f);
+            CHECK(abs(single.m[j] - ref.m[j]) <= tol);
+            CHECK(abs(m4[i].m[j] - ref.m[j]) <= tol);
+            CHECK(m4_4[i].m[j] == m4[i].m[j]);
+            CHECK(m4_16[i].m[j] == m4[i].m[j]);
+            if(j < 12)
+                CHECK(m34[i].m[j] == m4[i].m[j]);
+        }
+    }
+}
+
+TEST_CASE( "Quat Multiply", "[maths]")
+{
+    // hamilton product, i * j = k, j * k = i, k * i = j
+    quat i = quat(1.0f, 0.0f, 0.0f, 0.0f);
+    quat j = quat(0.0f, 1.0f, 0.0f, 0.0f);
+    quat k = quat(0.0f, 0.0f, 1.0f, 0.0f);
+    REQUIRE(require_func(vec4f((i * j).v), {0.0f, 0.0f, 1.0f, 0.0f}));
+    REQUIRE(require_func(vec4f((j * k).v), {1.0f, 0.0f, 0.0f, 0.0f}));
+    REQUIRE(require_func(vec4f((k * i).v), {0.0f, 1.0f, 0.0f, 0.0f}));
+    REQUIRE(require_func(vec4f((j * i).v), {0.0f, 0.0f, -1.0f, 0.0f}));
+    
+    quat a = quat(1.0f, 2.0f, 3.0f, 4.0f);
+    quat b = quat(5.0f, 6.0f, 7.0f, 8.0f);
+    REQUIRE(require_func(vec4f((a * b).v), {24.0f, 48.0f, 48.0f, -6.0f}));
+    quat c = a;
+    c *= b;
+    REQUIRE(require_func(vec4f(c.v), {24.0f, 48.0f, 48.0f, -6.0f}));
+    
+    // composes as the rotation matrices do
+    normalise(a);
+    normalise(b);
+    mat4 ma, mb, mab;
+    a.get_matrix(ma);
+    b.get_matrix(mb);
+    (a * b).get_matrix(mab);
+    mat4 composed = ma * mb;
+    for(u32 e = 0; e < 16; ++e)
+        REQUIRE(require_func(mab.m[e], composed.m[e]));
+}
+
+TEST_CASE( "Dual Quat", "[maths]")
+{
+    for(u32 i = 0; i < 200; ++i)
+    {
+        u32 seed = i * 16;
+        transform ta, tb;
+        ta.rotation = quat(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2), hash_rnd(seed + 3));
+        normalise(ta.rotation);
+        ta.translation = vec3f(hash_rnd(seed + 4), hash_rnd(seed + 5), hash_rnd(seed + 6)) * 10.0f;
+        tb.rotation = quat(hash_rnd(seed + 7), hash_rnd(seed + 8), hash_rnd(seed + 9), hash_rnd(seed + 10));
+        normalise(tb.rotation);
+        tb.translation = vec3f(hash_rnd(seed + 11), hash_rnd(seed + 12), hash_rnd(seed + 13)) * 10.0f;
+        vec3f p = vec3f(hash_rnd(seed + 14), hash_rnd(seed + 15), hash_rnd(seed + 13)) * 5.0f;
+        
+        mat4 ma = get_matrix_from_transform(ta);
+        mat4 mb = get_matrix_from_transform(tb);
+        dual_quat a = get_dual_quat_from_transform(ta);
+        dual_quat b = get_dual_quat_from_transform(tb);
+        
+        // quaternion product rotates the same as the matrix
+        quat qp = ta.rotation * quat(p.x, p.y, p.z, 0.0f) * quat(-ta.rotation.x, -ta.rotation.y, -ta.rotation.z, ta.rotation.w);
+        CHECK(dist(vec3f(qp.x, qp.y, qp.z), (vec3f)ma.transform_vector(vec4f(p, 0.0f)).xyz) <= 1e-4f);
+        
+        // points, translation and matrix match the transform
+        CHECK(dist(a.transform_point(p), ma.transform_vector(p)) <= 1e-4f);
+        CHECK(dist(a.get_translation(), ta.translation) <= 1e-4f);
+        
+        mat4 m;
+        a.get_matrix(m);
+        dual_quat c;
+        c.from_matrix(m);
+        for(u32 j = 0; j < 16; ++j)
+            CHECK(abs(m.m[j] - ma.m[j]) <= 1e-5f);
+        CHECK(dist(c.transform_point(p), a.transform_point(p)) <= 1e-4f);
+        
+        // composition
+        dual_quat ab = a * b;
+        CHECK(dist(ab.transform_point(p), (ma * mb).transform_vector(p)) <= 1e-3f);
+        
+        // blending the same rotation either sign is that rotation
+        dual_quat same[2] = {a, a * -1.0f};
+        f32 w[2] = {0.3f, 0.7f};
+        dual_quat ba = blend(same, w, 2);
+        CHECK(dist(ba.transform_point(p), a.transform_point(p)) <= 1e-4f);
+    }
+    
+    // twisting 180 degrees about x, halfway between keeps the distance from the axis where a matrix blend collapses
+    quat twist;
+    twist.axis_angle(vec3f::unit_x(), (f32)M_PI);
+    dual_quat bones[2] = {dual_quat(), dual_quat(twist, vec3f::zero())};
+    f32 w[2] = {0.5f, 0.5f};
+    vec3f p = vec3f(0.5f, 1.0f, 0.0f);
+    vec3f sp = blend(bones, w, 2).transform_point(p);
+    REQUIRE(abs(sqrt(sp.y * sp.y + sp.z * sp.z) - 1.0f) < 1e-5f);
+    REQUIRE(abs(sp.x - 0.5f) < 1e-5f);
+    
+    mat4 m0 = mat4::create_identity();
+    mat4 m1;
+    twist.get_matrix(m1);
+    vec3f lp = (m0.transform_vector(p) + m1.transform_vector(p)) * 0.5f;
+    REQUIRE(sqrt(lp.y * lp.y + lp.z * lp.z) < 1e-5f);
+}
+
+TEST_CASE( "Skin Dual Quat", "[maths]")
+{
+    const size_t num_bones = 37;
+    const size_t n = 10007;
+    std::vector<dual_quat> bones(num_bones);
+    for(u32 i = 0; i < num_bones; ++i)
+    {
+        u32 seed = i * 8;
+        quat q = quat(hash_rnd(seed), hash_rnd(seed + 1), hash_rnd(seed + 2), hash_rnd(seed + 3));
+        normalise(q);
+        bones[i] = dual_quat(q, vec3f(hash_rnd(seed + 4), hash_rnd(seed + 5), hash_rnd(seed + 6)) * 10.0f);
+    }
+    
+    // 1 to 4 influences per vertex
+    std::vector<u32> indices(n * 4);
+    soa4f weights(n);
+    soa3f positions(n), normals(n);
+    for(size_t i = 0; i < n; ++i)
+    {
+        u32 seed = (u32)i * 16 + 1000;
+        u32 influences = 1 + (u32)(i % 4);
+        vec4f w = vec4f::zero();
+        for(u32 k = 0; k < 4; ++k)
+        {
+            indices[i * 4 + k] = k < influences ? hash_u32((u32)i * 4 + k) % num_bones : 0;
+            w[k] = k < influences ? hash_rnd(seed + k) + 1.1f : 0.0f;
+        }
+        weights.set(i, w / (w.x + w.y + w.z + w.w));
+        positions.set(i, vec3f(hash_rnd(seed + 4), hash_rnd(seed + 5), hash_rnd(seed + 6)) * 20.0f);
+        normals.set(i, normalised(vec3f(hash_rnd(seed + 7), hash_rnd(seed + 8), hash_rnd(seed + 9)) + vec3f(0.01f)));
+    }
+    
+    soa3f op, on, op4, op16, opt, ont;
+    maths::skin_dual_quat(bones.data(), indices.data(), weights, positions, normals, op, on, 1);
+    maths::skin_dual_quat<4>(bones.data(), indices.data(), weights, positions, op4, 1);
+    maths::skin_dual_quat<16>(bones.data(), indices.data(), weights, positions, op16, 1);
+    maths::skin_dual_quat(bones.data(), indices.data(), weights, positions, normals, opt, ont, 3);
+    REQUIRE(op.size() == n);
+    REQUIRE(on.size() == n);
+    
+    for(size_t i = 0; i < n; ++i)
+    {
+        dual_quat dqs[4];
+        f32 w[4];
+        for(u32 k = 0; k < 4; ++k)
+        {
+            dqs[k] = bones[indices[i * 4 + k]];
+            w[k] = weights.get(i)[k];
+        }
+        dual_quat b = blend(dqs, w, 4);
+        vec3f p = b.transform_point(positions.get(i));
+        vec3f nn = b.transform_vector(normals.get(i));
+        
+        CHECK(dist(op.get(i), p) <= 1e-3f);
+        CHECK(dist(on.get(i), nn) <= 1e-5f);
+        CHECK(abs(mag(on.get(i)) - 1.0f) <= 1e-5f);
+        CHECK(dist(op4.get(i), op.get(i)) <= 1e-4f);
+        CHECK(dist(op16.get(i), op.get(i)) <= 1e-4f);
+        
+        // threads split on whole batches
+        CHECK(opt.get(i) == op.get(i));
+        CHECK(ont.get(i) == on.get(i));
+    }
+    
+    // lanes past the last vertex ignore whatever is in the padding of weights
+    vec4f last = weights.get(n - 1);
+    weights.store(n - 1, Vec<4, Wide<8>>(Wide<8>(NAN)));
+    weights.set(n - 1, last);
+    soa3f opp;
+    maths::skin_dual_quat(bones.data(), indices.data(), weights, positions, opp, 1);
+    for(size_t i = 0; i < 8; ++i)
+        REQUIRE(!std::isnan(opp.component(0)[n - 1 + i]));
+}
+
 TEST_CASE( "Point Inside Cone", "[maths]")
 {
     {
@@ -1,2 +1,10 @@
 #!/usr/bin/env bash
-c++ --std=c++11 -Wno-braced-scalar-init -fprofile-arcs -ftest-coverage -fPIC -fno-inline -fno-inline-small-functions -fno-default-inline --coverage .test/test.cpp -o .test/test && ./".test/test"
\ No newline at end of file
+set -e
+c++ --std=c++11 -Wno-braced-scalar-init -fprofile-arcs -ftest-coverage -fPIC -fno-inline -fno-inline-small-functions -fno-default-inline --coverage -pthread .test/test.cpp -o .test/test && ./".test/test"
+
+# opt-in simd paths
+c++ --std=c++11 -Wno-braced-scalar-init -DMATHS_SIMD -mavx2 -mfma -pthread .test/test.cpp -o .test/test_simd && ./".test/test_simd"
+c++ --std=c++11 -Wno-braced-scalar-init -DMATHS_SIMD -mavx2 -pthread .test/test.cpp -o .test/test_avx2 && ./".test/test_avx2"
+
+# benchmarks are built to keep them compiling, run them locally to compare timings
+c++ --std=c++11 -O2 -pthread .test/bench.cpp -o .test/bench
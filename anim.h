@@ -0,0 +1,261 @@
+// anim.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <vector>
+
+// keyframed animation clips for skeletons and other transform hierarchies. each channel, such as a joint, has a
+// translation, rotation and scale track with its own key times. the keys of every channel are stored in one soa array
+// per property and a track is a range of them. a cursor per playing instance keeps the key each track was last
+// sampled at, so sequential playback finds the next key pair in O(1) and only a seek or a loop back binary searches.
+// sampling gathers the key pairs of W channels into lanes which are interpolated with lerp and the batch slerp.
+//
+// maths::anim_clip clip;
+// maths::create_anim_clip(clip, channel_keys.data(), channel_keys.size());
+//
+// maths::anim_cursor cursor;
+// maths::anim_sample(clip, cursor, fmod(time, clip.duration), pose.data());
+
+namespace maths
+{
+    enum e_anim_track
+    {
+        ANIM_TRANSLATION = 0,
+        ANIM_ROTATION    = 1,
+        ANIM_SCALE       = 2,
+        ANIM_NUM_TRACKS
+    };
+
+    // source keys of one channel with times ascending, an empty track holds the identity
+    struct anim_channel_keys
+    {
+        std::vector<f32>   translation_times;
+        std::vector<vec3f> translations;
+        std::vector<f32>   rotation_times;
+        std::vector<quat>  rotations;
+        std::vector<f32>   scale_times;
+        std::vector<vec3f> scales;
+    };
+
+    struct anim_track
+    {
+        u32 first; // index of the first key in the clip arrays
+        u32 count; // at least 1
+    };
+
+    struct anim_channel
+    {
+        anim_track tracks[ANIM_NUM_TRACKS];
+    };
+
+    struct anim_clip
+    {
+        f32                       duration; // time of the last key
+        std::vector<anim_channel> channels;
+        std::vector<f32>          times[ANIM_NUM_TRACKS];
+        soa3f                     translations;
+        soa_quatf                 rotations;
+        soa3f                     scales;
+    };
+
+    // playback state of an instance, a default constructed cursor starts from the first keys
+    struct anim_cursor
+    {
+        std::vector<u32> keys; // ANIM_NUM_TRACKS per channel, relative to the track
+    };
+
+    void create_anim_clip(anim_clip& clip, const anim_channel_keys* channels, size_t num_channels);
+    template <size_t W = 8>
+    void anim_sample(const anim_clip& clip, anim_cursor& cursor, f32 time, transform* out);
+    template <size_t W = 8>
+    void anim_sample(const anim_clip& clip, anim_cursor& cursor, f32 time, mat34* out);
+
+    //
+    // Implementation
+    //
+
+    inline void anim_add_track(anim_clip& clip, anim_track& track, u32 type, const std::vector<f32>& times)
+    {
+        track.first = (u32)clip.times[type].size();
+        track.count = (u32)std::max(times.size(), (size_t)1);
+        if (times.empty())
+            clip.times[type].push_back(0.0f);
+        else
+            clip.times[type].insert(clip.times[type].end(), times.begin(), times.end());
+
+        clip.duration = std::max(clip.duration, clip.times[type].back());
+    }
+
+    // copies the keys of channels into the soa arrays of clip, times and keys of each track must be the same length
+    inline void create_anim_clip(anim_clip& clip, const anim_channel_keys* channels, size_t num_channels)
+    {
+        clip.duration = 0.0f;
+        clip.channels.resize(num_channels);
+        for (u32 i = 0; i < ANIM_NUM_TRACKS; ++i)
+            clip.times[i].clear();
+
+        for (size_t c = 0; c < num_channels; ++c)
+        {
+            anim_track* tracks = clip.channels[c].tracks;
+            anim_add_track(clip, tracks[ANIM_TRANSLATION], ANIM_TRANSLATION, channels[c].translation_times);
+            anim_add_track(clip, tracks[ANIM_ROTATION], ANIM_ROTATION, channels[c].rotation_times);
+            anim_add_track(clip, tracks[ANIM_SCALE], ANIM_SCALE, channels[c].scale_times);
+        }
+
+        clip.translations.resize(clip.times[ANIM_TRANSLATION].size());
+        clip.rotations.resize(clip.times[ANIM_ROTATION].size());
+        clip.scales.resize(clip.times[ANIM_SCALE].size());
+        for (size_t c = 0; c < num_channels; ++c)
+        {
+            const anim_channel_keys& keys = channels[c];
+            const anim_track*        tracks = clip.channels[c].tracks;
+            for (u32 k = 0; k < tracks[ANIM_TRANSLATION].count; ++k)
+                clip.translations.set(tracks[ANIM_TRANSLATION].first + k,
+                                      keys.translations.empty() ? vec3f::zero() : keys.translations[k]);
+
+            for (u32 k = 0; k < tracks[ANIM_ROTATION].count; ++k)
+            {
+                quat q = keys.rotations.empty() ? quat() : keys.rotations[k];
+                clip.rotations.set(tracks[ANIM_ROTATION].first + k, vec4f(q.x, q.y, q.z, q.w));
+            }
+
+            for (u32 k = 0; k < tracks[ANIM_SCALE].count; ++k)
+                clip.scales.set(tracks[ANIM_SCALE].first + k, keys.scales.empty() ? vec3f::one() : keys.scales[k]);
+        }
+    }
+
+    // index of the last key at or before time, or 0 when time is before the first key. starts from the key found by
+    // the previous sample, sequential playback moves forward by a key or two at most which is stepped with selects
+    // rather than branches as whether it moves is unpredictable. anything else is a seek and binary searches.
+    inline u32 anim_find_key(const f32* times, u32 count, u32 key, f32 time)
+    {
+        u32 last = count - 1;
+        if (key <= last && times[key] <= time)
+        {
+            u32 next = std::min(key + 1, last);
+            key = times[next] <= time ? next : key;
+            next = std::min(key + 1, last);
+            key = times[next] <= time ? next : key;
+            next = std::min(key + 1, last);
+            if (next == key || times[next] > time)
+                return key;
+        }
+
+        u32 n = (u32)(std::upper_bound(times, times + count, time) - times);
+        return n > 0 ? n - 1 : 0;
+    }
+
+    // gathers the keys either side of time from one track of the W channels starting at c into k0 and k1, with the
+    // fraction between them in u. lanes past the last channel repeat it.
+    template <size_t W, size_t N>
+    inline void anim_gather(const anim_clip& clip, u32* cursor, size_t c, u32 type, const Soa<N>& keys, f32 time,
+                            Vec<N, Wide<W>>& k0, Vec<N, Wide<W>>& k1, Wide<W>& u)
+    {
+        const f32* times = clip.times[type].data();
+        f32        a[N][W];
+        f32        b[N][W];
+        f32        ta[W];
+        f32        tb[W];
+        for (size_t j = 0; j < W; ++j)
+        {
+            size_t            ch = std::min(c + j, clip.channels.size() - 1);
+            const anim_track& track = clip.channels[ch].tracks[type];
+            u32&              key = cursor[ch * ANIM_NUM_TRACKS + type];
+
+            key = anim_find_key(times + track.first, track.count, key, time);
+            u32 k = track.first + key;
+            u32 next = key + 1 < track.count ? k + 1 : k;
+            ta[j] = times[k];
+            tb[j] = times[next];
+            for (size_t i = 0; i < N; ++i)
+            {
+                a[i][j] = keys.component(i)[k];
+                b[i][j] = keys.component(i)[next];
+            }
+        }
+
+        for (size_t i = 0; i < N; ++i)
+        {
+            k0[i] = Wide<W>::load(a[i]);
+            k1[i] = Wide<W>::load(b[i]);
+        }
+
+        // fraction between the keys, 0 on the last key
+        Wide<W> t0 = Wide<W>::load(ta);
+        Wide<W> span = Wide<W>::load(tb) - t0;
+        Wide<W> f = min(max((Wide<W>(time) - t0) / span, Wide<W>(0.0f)), Wide<W>(1.0f));
+        u = select(span > Wide<W>(0.0f), f, Wide<W>(0.0f));
+    }
+
+    // samples W channels starting at c into lanes, translation and scale are lerped and rotation is slerped
+    template <size_t W>
+    inline void anim_sample_lanes(const anim_clip& clip, u32* cursor, size_t c, f32 time, Vec<3, Wide<W>>& t,
+                                  Vec<4, Wide<W>>& r, Vec<3, Wide<W>>& s)
+    {
+        Vec<3, Wide<W>> t0, t1, s0, s1;
+        Vec<4, Wide<W>> r0, r1;
+        Wide<W>         tu, ru, su;
+        anim_gather<W>(clip, cursor, c, ANIM_TRANSLATION, clip.translations, time, t0, t1, tu);
+        anim_gather<W>(clip, cursor, c, ANIM_ROTATION, clip.rotations, time, r0, r1, ru);
+        anim_gather<W>(clip, cursor, c, ANIM_SCALE, clip.scales, time, s0, s1, su);
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            t[i] = fmadd(t1[i] - t0[i], tu, t0[i]);
+            s[i] = fmadd(s1[i] - s0[i], su, s0[i]);
+        }
+        r = slerp(r0, r1, ru);
+    }
+
+    inline u32* anim_cursor_keys(const anim_clip& clip, anim_cursor& cursor)
+    {
+        cursor.keys.resize(clip.channels.size() * ANIM_NUM_TRACKS, 0);
+        return cursor.keys.data();
+    }
+
+    // samples every channel of clip at time into out, one transform per channel. time is clamped to the keys, wrap
+    // it for looping playback.
+    template <size_t W>
+    inline void anim_sample(const anim_clip& clip, anim_cursor& cursor, f32 time, transform* out)
+    {
+        u32*   keys = anim_cursor_keys(clip, cursor);
+        size_t n = clip.channels.size();
+        for (size_t c = 0; c < n; c += W)
+        {
+            Vec<3, Wide<W>> t, s;
+            Vec<4, Wide<W>> r;
+            anim_sample_lanes<W>(clip, keys, c, time, t, r, s);
+
+            for (size_t j = 0; j < W && c + j < n; ++j)
+            {
+                out[c + j].translation = vec3f(t.x[j], t.y[j], t.z[j]);
+                out[c + j].rotation = quat(r.x[j], r.y[j], r.z[j], r.w[j]);
+                out[c + j].scale = vec3f(s.x[j], s.y[j], s.z[j]);
+            }
+        }
+    }
+
+    // samples every channel of clip at time into out, one affine T * R * S matrix per channel
+    template <size_t W>
+    inline void anim_sample(const anim_clip& clip, anim_cursor& cursor, f32 time, mat34* out)
+    {
+        u32*   keys = anim_cursor_keys(clip, cursor);
+        size_t n = clip.channels.size();
+        for (size_t c = 0; c < n; c += W)
+        {
+            Vec<3, Wide<W>> t, s;
+            Vec<4, Wide<W>> r;
+            anim_sample_lanes<W>(clip, keys, c, time, t, r, s);
+
+            Wide<W> m[12];
+            compose_affine(t, r, s, m);
+            for (size_t j = 0; j < W && c + j < n; ++j)
+                for (size_t i = 0; i < 12; ++i)
+                    out[c + j].m[i] = m[i][j];
+        }
+    }
+}
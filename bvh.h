@@ -0,0 +1,618 @@
+// bvh.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <vector>
+
+// bounding volume hierarchy over a triangle mesh for ray and closest point queries which scale logarithmically with
+// the number of triangles. the tree is built top down with a binned surface area heuristic and stored flat, children
+// of a node are adjacent and leaf triangles are copied into leaf order so traversal walks memory mostly forwards.
+//
+// maths::bvh tree;
+// maths::build_bvh(tree, vertices.data(), indices.data(), indices.size() / 3);
+// maths::bvh_hit hit;
+// if (maths::ray_vs_bvh(tree, r0, rv, hit))
+//     pick(hit.triangle, hit.p);
+
+namespace maths
+{
+    static const u32 k_bvh_bins = 16;
+    static const u32 k_bvh_max_depth = 64;
+    static const f32 k_bvh_traversal_cost = 1.0f; // cost of visiting a node relative to testing a triangle
+
+    struct bvh_node
+    {
+        vec3f aabb_min;
+        u32   left_first; // index of the left child (the right is left_first + 1) or the first triangle of a leaf
+        vec3f aabb_max;
+        u32   count;      // number of triangles in a leaf, 0 for internal nodes
+    };
+
+    struct bvh
+    {
+        std::vector<bvh_node> nodes;
+        std::vector<vec3f>    vertices;  // 3 per triangle in leaf order
+        std::vector<u32>      triangles; // source triangle index for each triangle in leaf order
+    };
+
+    struct bvh_hit
+    {
+        f32   t;        // distance along the ray direction, or distance to the closest point
+        u32   triangle; // index of the triangle in the source mesh
+        vec3f p;        // intersection or closest point
+    };
+
+    void build_bvh(bvh& tree, const vec3f* vertices, const u32* indices, size_t num_triangles, u32 max_leaf_triangles = 4);
+    void build_bvh(bvh& tree, const std::vector<vec3f>& vertices, const std::vector<u32>& indices, u32 max_leaf_triangles = 4);
+    bool ray_vs_bvh(const bvh& tree, const vec3f& r0, const vec3f& rv, bvh_hit& hit, f32 t_max = FLT_MAX);
+    bool ray_vs_bvh_any(const bvh& tree, const vec3f& r0, const vec3f& rv, f32 t_max = FLT_MAX);
+    bool closest_point_on_bvh(const bvh& tree, const vec3f& p, bvh_hit& hit, f32 max_distance = FLT_MAX);
+
+    // ray packets
+    template<size_t W>
+    Wide<W> ray_vs_bvh(const bvh& tree, const Vec<3, Wide<W>>& r0, const Vec<3, Wide<W>>& rv, Wide<W>& t, u32* triangles);
+    template<size_t W = 8>
+    void ray_vs_bvh(const bvh& tree, const vec3f* r0, const vec3f* rv, size_t count, bvh_hit* hits, u32* hit_mask,
+                    f32 t_max = FLT_MAX);
+
+    //
+    // Implementation
+    //
+
+    // per triangle build data, partitioned in place so each node's triangles are contiguous
+    struct bvh_build_triangle
+    {
+        vec3f aabb_min;
+        u32   index;
+        vec3f aabb_max;
+        vec3f centroid;
+    };
+
+    // grows the aabb emin-emax to contain pmin-pmax, per component so the build loops keep bounds in registers
+    maths_inline void bvh_grow(vec3f& emin, vec3f& emax, const vec3f& pmin, const vec3f& pmax)
+    {
+        for (u32 k = 0; k < 3; ++k)
+        {
+            emin[k] = std::min(emin[k], pmin[k]);
+            emax[k] = std::max(emax[k], pmax[k]);
+        }
+    }
+
+    // half the surface area of the aabb, only ratios are used
+    maths_inline f32 bvh_area(const vec3f& aabb_min, const vec3f& aabb_max)
+    {
+        vec3f e = aabb_max - aabb_min;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    // closest point on triangle a-b-c to p by voronoi regions, unlike closest_point_on_triangle points which project
+    // inside the triangle return the projection
+    inline vec3f bvh_closest_point_on_triangle(const vec3f& p, const vec3f& a, const vec3f& b, const vec3f& c)
+    {
+        vec3f ab = b - a;
+        vec3f ac = c - a;
+        vec3f ap = p - a;
+
+        f32 d1 = dot(ab, ap);
+        f32 d2 = dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return a;
+
+        vec3f bp = p - b;
+        f32   d3 = dot(ab, bp);
+        f32   d4 = dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return b;
+
+        f32 vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return a + ab * (d1 / (d1 - d3));
+
+        vec3f cp = p - c;
+        f32   d5 = dot(ab, cp);
+        f32   d6 = dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return c;
+
+        f32 vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return a + ac * (d2 / (d2 - d6));
+
+        f32 va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+        f32 denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    // builds tree from num_triangles triangles, indices holds 3 vertex indices per triangle or can be nullptr when
+    // vertices are 3 per triangle. nodes are split at the cheapest of k_bvh_bins candidate planes per axis and
+    // become leaves when splitting is no cheaper and they have max_leaf_triangles or fewer.
+    inline void build_bvh(bvh& tree, const vec3f* vertices, const u32* indices, size_t num_triangles, u32 max_leaf_triangles)
+    {
+        tree.nodes.clear();
+        tree.vertices.clear();
+        tree.triangles.resize(num_triangles);
+
+        if (num_triangles == 0)
+            return;
+
+        // per triangle bounds and centroids
+        std::vector<bvh_build_triangle> build(num_triangles);
+        for (size_t i = 0; i < num_triangles; ++i)
+        {
+            const vec3f& v0 = vertices[indices ? indices[i * 3 + 0] : i * 3 + 0];
+            const vec3f& v1 = vertices[indices ? indices[i * 3 + 1] : i * 3 + 1];
+            const vec3f& v2 = vertices[indices ? indices[i * 3 + 2] : i * 3 + 2];
+            build[i].aabb_min = min_union(min_union(v0, v1), v2);
+            build[i].aabb_max = max_union(max_union(v0, v1), v2);
+            build[i].centroid = (v0 + v1 + v2) / 3.0f;
+            build[i].index = (u32)i;
+        }
+
+        bvh_node root;
+        root.left_first = 0;
+        root.count = (u32)num_triangles;
+        tree.nodes.reserve(num_triangles * 2);
+        tree.nodes.push_back(root);
+
+        // pairs of node index, depth
+        std::vector<u32>    stack = {0, 0};
+        bvh_build_triangle* tris = build.data();
+
+        while (!stack.empty())
+        {
+            u32 depth = stack.back();
+            stack.pop_back();
+            u32 ni = stack.back();
+            stack.pop_back();
+
+            u32 first = tree.nodes[ni].left_first;
+            u32 count = tree.nodes[ni].count;
+
+            vec3f nmin = tris[first].aabb_min, nmax = tris[first].aabb_max;
+            vec3f cmin = tris[first].centroid, cmax = cmin;
+            for (u32 i = first + 1; i < first + count; ++i)
+            {
+                bvh_grow(nmin, nmax, tris[i].aabb_min, tris[i].aabb_max);
+                bvh_grow(cmin, cmax, tris[i].centroid, tris[i].centroid);
+            }
+
+            tree.nodes[ni].aabb_min = nmin;
+            tree.nodes[ni].aabb_max = nmax;
+
+            if (count == 1 || depth >= k_bvh_max_depth)
+                continue;
+
+            // bin centroids on all three axes in one pass, small nodes use fewer bins
+            u32   bins = std::min(k_bvh_bins, count);
+            vec3f scale;
+            for (u32 a = 0; a < 3; ++a)
+                scale[a] = cmax[a] > cmin[a] ? (f32)bins / (cmax[a] - cmin[a]) : 0.0f;
+
+            u32   bin_count[3][k_bvh_bins];
+            vec3f bin_min[3][k_bvh_bins], bin_max[3][k_bvh_bins];
+            for (u32 a = 0; a < 3; ++a)
+                for (u32 b = 0; b < bins; ++b)
+                {
+                    bin_count[a][b] = 0;
+                    bin_min[a][b] = vec3f::flt_max();
+                    bin_max[a][b] = -vec3f::flt_max();
+                }
+
+            for (u32 i = first; i < first + count; ++i)
+            {
+                const bvh_build_triangle& t = tris[i];
+                for (u32 a = 0; a < 3; ++a)
+                {
+                    u32 b = std::min((u32)((t.centroid[a] - cmin[a]) * scale[a]), bins - 1);
+                    bvh_grow(bin_min[a][b], bin_max[a][b], t.aabb_min, t.aabb_max);
+                    bin_count[a][b]++;
+                }
+            }
+
+            // evaluate the sah at each bin boundary on each axis
+            f32 best_cost = FLT_MAX;
+            u32 best_axis = 0;
+            u32 best_split = 0;
+            for (u32 a = 0; a < 3; ++a)
+            {
+                if (scale[a] == 0.0f)
+                    continue;
+
+                // sweep from the right storing area * count of everything right of each boundary
+                f32   right_cost[k_bvh_bins];
+                u32   right_count = 0;
+                vec3f rmin = vec3f::flt_max(), rmax = -vec3f::flt_max();
+                for (u32 b = bins - 1; b > 0; --b)
+                {
+                    bvh_grow(rmin, rmax, bin_min[a][b], bin_max[a][b]);
+                    right_count += bin_count[a][b];
+                    right_cost[b] = right_count ? bvh_area(rmin, rmax) * (f32)right_count : -1.0f;
+                }
+
+                // then from the left, splitting before bin b
+                u32   left_count = 0;
+                vec3f lmin = vec3f::flt_max(), lmax = -vec3f::flt_max();
+                for (u32 b = 1; b < bins; ++b)
+                {
+                    bvh_grow(lmin, lmax, bin_min[a][b - 1], bin_max[a][b - 1]);
+                    left_count += bin_count[a][b - 1];
+
+                    if (left_count == 0 || right_cost[b] < 0.0f)
+                        continue;
+
+                    f32 cost = bvh_area(lmin, lmax) * (f32)left_count + right_cost[b];
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        best_axis = a;
+                        best_split = b;
+                    }
+                }
+            }
+
+            // all centroids coincide
+            if (best_cost == FLT_MAX)
+                continue;
+
+            f32 area = bvh_area(nmin, nmax);
+            if (count <= max_leaf_triangles && best_cost + k_bvh_traversal_cost * area >= (f32)count * area)
+                continue;
+
+            // partition triangles either side of the split, using the same binning as above
+            u32 i = first;
+            u32 j = first + count;
+            while (i < j)
+            {
+                u32 b = std::min((u32)((tris[i].centroid[best_axis] - cmin[best_axis]) * scale[best_axis]), bins - 1);
+                if (b < best_split)
+                    ++i;
+                else
+                    std::swap(tris[i], tris[--j]);
+            }
+
+            u32 left = (u32)tree.nodes.size();
+            bvh_node child;
+            child.left_first = first;
+            child.count = i - first;
+            tree.nodes.push_back(child);
+            child.left_first = i;
+            child.count = count - (i - first);
+            tree.nodes.push_back(child);
+
+            tree.nodes[ni].left_first = left;
+            tree.nodes[ni].count = 0;
+
+            stack.push_back(left + 1);
+            stack.push_back(depth + 1);
+            stack.push_back(left);
+            stack.push_back(depth + 1);
+        }
+
+        // copy triangles into leaf order
+        tree.vertices.resize(num_triangles * 3);
+        for (size_t i = 0; i < num_triangles; ++i)
+        {
+            tree.triangles[i] = build[i].index;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                size_t vi = build[i].index * 3 + k;
+                tree.vertices[i * 3 + k] = vertices[indices ? indices[vi] : vi];
+            }
+        }
+    }
+
+    // builds tree from an indexed triangle list, or an unindexed list when indices is empty
+    inline void build_bvh(bvh& tree, const std::vector<vec3f>& vertices, const std::vector<u32>& indices, u32 max_leaf_triangles)
+    {
+        if (indices.empty())
+            build_bvh(tree, vertices.data(), nullptr, vertices.size() / 3, max_leaf_triangles);
+        else
+            build_bvh(tree, vertices.data(), indices.data(), indices.size() / 3, max_leaf_triangles);
+    }
+
+    // finds the nearest intersection of the ray with origin r0 and direction rv with any triangle in tree, closer than
+    // t_max along rv. triangles are double sided, children are visited nearest first and nodes further than the
+    // closest hit so far are skipped.
+    inline bool ray_vs_bvh(const bvh& tree, const vec3f& r0, const vec3f& rv, bvh_hit& hit, f32 t_max)
+    {
+        if (tree.nodes.empty())
+            return false;
+
+        const bvh_node* nodes = tree.nodes.data();
+        vec3f           inv_rv = vec3f(1.0f) / rv;
+
+        f32 t;
+        if (!ray_vs_aabb(nodes[0].aabb_min, nodes[0].aabb_max, r0, inv_rv, t_max, t))
+            return false;
+
+        u32  stack[k_bvh_max_depth];
+        f32  stack_t[k_bvh_max_depth];
+        u32  sp = 0;
+        u32  ni = 0;
+        bool found = false;
+
+        for (;;)
+        {
+            const bvh_node& node = nodes[ni];
+            if (node.count > 0)
+            {
+                for (u32 i = node.left_first; i < node.left_first + node.count; ++i)
+                {
+                    const vec3f* v = &tree.vertices[i * 3];
+                    if (ray_vs_triangle(r0, rv, v[0], v[1], v[2], t) && t < t_max)
+                    {
+                        t_max = t;
+                        hit.triangle = tree.triangles[i];
+                        found = true;
+                    }
+                }
+            }
+            else
+            {
+                u32  c0 = node.left_first;
+                u32  c1 = c0 + 1;
+                f32  t0, t1;
+                bool h0 = ray_vs_aabb(nodes[c0].aabb_min, nodes[c0].aabb_max, r0, inv_rv, t_max, t0);
+                bool h1 = ray_vs_aabb(nodes[c1].aabb_min, nodes[c1].aabb_max, r0, inv_rv, t_max, t1);
+                if (h0 && h1)
+                {
+                    if (t1 < t0)
+                    {
+                        std::swap(c0, c1);
+                        std::swap(t0, t1);
+                    }
+                    stack[sp] = c1;
+                    stack_t[sp++] = t1;
+                    ni = c0;
+                    continue;
+                }
+                else if (h0 || h1)
+                {
+                    ni = h0 ? c0 : c1;
+                    continue;
+                }
+            }
+
+            // pop the next node which is still closer than the nearest hit
+            while (sp > 0 && stack_t[sp - 1] >= t_max)
+                --sp;
+            if (sp == 0)
+                break;
+            ni = stack[--sp];
+        }
+
+        if (found)
+        {
+            hit.t = t_max;
+            hit.p = r0 + rv * t_max;
+        }
+        return found;
+    }
+
+    // returns true if the ray with origin r0 and direction rv hits any triangle in tree closer than t_max along rv,
+    // traversal stops at the first hit so this is cheaper than ray_vs_bvh for occlusion and shadow rays
+    inline bool ray_vs_bvh_any(const bvh& tree, const vec3f& r0, const vec3f& rv, f32 t_max)
+    {
+        if (tree.nodes.empty())
+            return false;
+
+        const bvh_node* nodes = tree.nodes.data();
+        vec3f           inv_rv = vec3f(1.0f) / rv;
+
+        u32 stack[k_bvh_max_depth + 1];
+        u32 sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0)
+        {
+            const bvh_node& node = nodes[stack[--sp]];
+
+            f32 t;
+            if (!ray_vs_aabb(node.aabb_min, node.aabb_max, r0, inv_rv, t_max, t))
+                continue;
+
+            if (node.count > 0)
+            {
+                for (u32 i = node.left_first; i < node.left_first + node.count; ++i)
+                {
+                    const vec3f* v = &tree.vertices[i * 3];
+                    if (ray_vs_triangle(r0, rv, v[0], v[1], v[2], t) && t < t_max)
+                        return true;
+                }
+            }
+            else
+            {
+                stack[sp++] = node.left_first + 1;
+                stack[sp++] = node.left_first;
+            }
+        }
+
+        return false;
+    }
+
+    // packet traversal finding the nearest hit for W rays at once, r0 and rv hold a ray per lane. nodes are tested
+    // against the whole packet and visited while any lane still hits them, which is faster than single rays when the
+    // rays are coherent, ie. camera rays or rays from a light. t holds the max distance of each lane on input (lanes with
+    // t <= 0 are inactive) and the nearest hit on output, triangles[lane] is written for lanes which hit. returns a
+    // mask of the lanes which hit.
+    template<size_t W>
+    inline Wide<W> ray_vs_bvh(const bvh& tree, const Vec<3, Wide<W>>& r0, const Vec<3, Wide<W>>& rv, Wide<W>& t, u32* triangles)
+    {
+        Wide<W> hit = 0.0f;
+        if (tree.nodes.empty())
+            return hit;
+
+        const bvh_node* nodes = tree.nodes.data();
+        Vec<3, Wide<W>> inv_rv;
+        for (size_t i = 0; i < 3; ++i)
+            inv_rv.v[i] = Wide<W>(1.0f) / rv.v[i];
+
+        // children are ordered front to back along the mean direction of the packet
+        vec3f mean_rv = vec3f::zero();
+        for (size_t l = 0; l < W; ++l)
+            mean_rv += lane(rv, l);
+
+        u32 stack[k_bvh_max_depth + 1];
+        u32 sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0)
+        {
+            const bvh_node& node = nodes[stack[--sp]];
+
+            Wide<W> te;
+            if (!any(ray_vs_aabb(node.aabb_min, node.aabb_max, r0, inv_rv, t, te)))
+                continue;
+
+            if (node.count > 0)
+            {
+                for (u32 i = node.left_first; i < node.left_first + node.count; ++i)
+                {
+                    const vec3f* v = &tree.vertices[i * 3];
+
+                    Wide<W> tt;
+                    Wide<W> mask = ray_vs_triangle(r0, rv, v[0], v[1], v[2], tt);
+                    mask = mask & (tt < t);
+
+                    u32 bits = movemask(mask);
+                    if (bits == 0)
+                        continue;
+
+                    t = select(mask, tt, t);
+                    hit = hit | mask;
+                    for (u32 l = 0; l < W; ++l)
+                        if (bits & (1u << l))
+                            triangles[l] = tree.triangles[i];
+                }
+            }
+            else
+            {
+                u32   c0 = node.left_first;
+                u32   c1 = c0 + 1;
+                vec3f d = (nodes[c1].aabb_min + nodes[c1].aabb_max) - (nodes[c0].aabb_min + nodes[c0].aabb_max);
+                if (dot(mean_rv, d) < 0.0f)
+                    std::swap(c0, c1);
+
+                stack[sp++] = c1;
+                stack[sp++] = c0;
+            }
+        }
+
+        return hit;
+    }
+
+    // nearest hits for count rays with origins r0 and directions rv, processed in packets of W consecutive rays so
+    // neighbouring rays should be coherent. hits[i] is written and bit (i % 32) of hit_mask[i / 32] is set for rays
+    // which hit, hit_mask must have space for (count + 31) / 32 elements.
+    template<size_t W>
+    inline void ray_vs_bvh(const bvh& tree, const vec3f* r0, const vec3f* rv, size_t count, bvh_hit* hits, u32* hit_mask,
+                           f32 t_max)
+    {
+        static_assert(32 % W == 0, "error: packet width must be a power of 2 and <= 32");
+
+        for (size_t i = 0; i < count; i += W)
+        {
+            size_t          lanes = std::min(count - i, W);
+            Vec<3, Wide<W>> pr0 = gather<W>(r0 + i, lanes);
+            Vec<3, Wide<W>> prv = gather<W>(rv + i, lanes);
+
+            Wide<W> t = t_max;
+            for (size_t l = lanes; l < W; ++l)
+                t[l] = 0.0f;
+
+            u32 triangles[W];
+            u32 bits = movemask(ray_vs_bvh(tree, pr0, prv, t, triangles));
+
+            for (size_t l = 0; l < lanes; ++l)
+                if (bits & (1u << l))
+                {
+                    hits[i + l].t = t[l];
+                    hits[i + l].triangle = triangles[l];
+                    hits[i + l].p = r0[i + l] + rv[i + l] * t[l];
+                }
+
+            if (i % 32 == 0)
+                hit_mask[i / 32] = 0;
+            hit_mask[i / 32] |= bits << (i % 32);
+        }
+    }
+
+    // finds the closest point to p on any triangle in tree within max_distance, nodes are pruned with
+    // point_aabb_distance against the closest distance found so far
+    inline bool closest_point_on_bvh(const bvh& tree, const vec3f& p, bvh_hit& hit, f32 max_distance)
+    {
+        if (tree.nodes.empty())
+            return false;
+
+        const bvh_node* nodes = tree.nodes.data();
+        if (point_aabb_distance(p, nodes[0].aabb_min, nodes[0].aabb_max) > max_distance)
+            return false;
+
+        u32  stack[k_bvh_max_depth];
+        f32  stack_d[k_bvh_max_depth];
+        u32  sp = 0;
+        u32  ni = 0;
+        bool found = false;
+
+        for (;;)
+        {
+            const bvh_node& node = nodes[ni];
+            if (node.count > 0)
+            {
+                for (u32 i = node.left_first; i < node.left_first + node.count; ++i)
+                {
+                    const vec3f* v = &tree.vertices[i * 3];
+                    vec3f        cp = bvh_closest_point_on_triangle(p, v[0], v[1], v[2]);
+                    f32          d = dist(p, cp);
+                    if (d <= max_distance)
+                    {
+                        max_distance = d;
+                        hit.triangle = tree.triangles[i];
+                        hit.p = cp;
+                        found = true;
+                    }
+                }
+            }
+            else
+            {
+                u32 c0 = node.left_first;
+                u32 c1 = c0 + 1;
+                f32 d0 = point_aabb_distance(p, nodes[c0].aabb_min, nodes[c0].aabb_max);
+                f32 d1 = point_aabb_distance(p, nodes[c1].aabb_min, nodes[c1].aabb_max);
+                if (d1 < d0)
+                {
+                    std::swap(c0, c1);
+                    std::swap(d0, d1);
+                }
+
+                if (d0 <= max_distance)
+                {
+                    if (d1 <= max_distance)
+                    {
+                        stack[sp] = c1;
+                        stack_d[sp++] = d1;
+                    }
+                    ni = c0;
+                    continue;
+                }
+            }
+
+            while (sp > 0 && stack_d[sp - 1] > max_distance)
+                --sp;
+            if (sp == 0)
+                break;
+            ni = stack[--sp];
+        }
+
+        if (found)
+            hit.t = max_distance;
+        return found;
+    }
+}
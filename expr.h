@@ -0,0 +1,210 @@
+// expr.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "vec.h"
+
+// opt-in lazy evaluation for component wise vec arithmetic. wrap an operand with lazy() and the expression is built
+// as a tree of small nodes which is evaluated in a single pass when it is assigned to a vec, instead of creating a
+// temporary vec for each operator. vec, swizzle and scalar operands can be mixed:
+//
+// vec3f r = lazy(a) * (1.0f - f) + b * f;
+// vec3f s = lazy(v.zyx) * 2.0f - v.xxx;
+//
+// nodes reference their vec and swizzle operands, so an expression must be evaluated within the statement that
+// creates it, do not store them with auto. call eval() to pass an expression to a function taking a vec.
+
+// leaves
+template <size_t N, typename T>
+struct ExprVec
+{
+    const Vec<N, T>* p;
+
+    maths_inline T eval(size_t i) const
+    {
+        return p->v[i];
+    }
+};
+
+template <typename T, size_t W, size_t... SW>
+struct ExprSwizzle
+{
+    const Swizzle<T, W, SW...>* p;
+
+    maths_inline T eval(size_t i) const
+    {
+        static const size_t ii[] = {SW...};
+        return p->v[ii[i]];
+    }
+};
+
+template <typename T>
+struct ExprScalar
+{
+    T s;
+
+    maths_inline T eval(size_t) const
+    {
+        return s;
+    }
+};
+
+// nodes
+#define EXPR_NODE(NAME, OP)                 \
+template <typename T, typename L, typename R> \
+struct NAME                                 \
+{                                           \
+    L l;                                    \
+    R r;                                    \
+                                            \
+    maths_inline T eval(size_t i) const     \
+    {                                       \
+        return l.eval(i) OP r.eval(i);      \
+    }                                       \
+};
+
+EXPR_NODE(ExprAdd, +)
+EXPR_NODE(ExprSub, -)
+EXPR_NODE(ExprMul, *)
+EXPR_NODE(ExprDiv, /)
+#undef EXPR_NODE
+
+template <typename T, typename E>
+struct ExprNegate
+{
+    E e;
+
+    maths_inline T eval(size_t i) const
+    {
+        return -e.eval(i);
+    }
+};
+
+// evaluates components with compile time indices so the per component loop is always unrolled
+template <size_t I, size_t N>
+struct ExprUnroll
+{
+    template <typename T, typename E>
+    static maths_inline void eval(T* r, const E& e)
+    {
+        r[I] = e.eval(I);
+        ExprUnroll<I + 1, N>::eval(r, e);
+    }
+};
+
+template <size_t N>
+struct ExprUnroll<N, N>
+{
+    template <typename T, typename E>
+    static maths_inline void eval(T*, const E&)
+    {
+    }
+};
+
+// an N component expression of T
+template <size_t N, typename T, typename E>
+struct VecExpr
+{
+    typedef T scalar_type;
+    E e;
+
+    maths_inline T operator[](size_t i) const
+    {
+        return e.eval(i);
+    }
+
+    maths_inline Vec<N, T> eval() const
+    {
+        Vec<N, T> r;
+        ExprUnroll<0, N>::eval(r.v, e);
+        return r;
+    }
+
+    maths_inline operator Vec<N, T>() const
+    {
+        return eval();
+    }
+};
+
+template <size_t N, typename T>
+maths_inline VecExpr<N, T, ExprVec<N, T>> lazy(const Vec<N, T>& v)
+{
+    return {{&v}};
+}
+
+template <typename T, size_t W, size_t... SW>
+maths_inline VecExpr<W, T, ExprSwizzle<T, W, SW...>> lazy(const Swizzle<T, W, SW...>& s)
+{
+    return {{&s}};
+}
+
+template <size_t N, typename T, typename E>
+maths_inline VecExpr<N, T, ExprNegate<T, E>> operator-(const VecExpr<N, T, E>& e)
+{
+    return {{e.e}};
+}
+
+// expr op expr, expr op vec, expr op swizzle, expr op scalar and the reverse. at least one operand must be an
+// expression, plain vec and swizzle arithmetic keeps using the eager operators.
+#define EXPR_OP(OP, NODE)                                                                                   \
+template <size_t N, typename T, typename E1, typename E2>                                                   \
+maths_inline VecExpr<N, T, NODE<T, E1, E2>> operator OP(const VecExpr<N, T, E1>& l, const VecExpr<N, T, E2>& r) \
+{                                                                                                           \
+    return {{l.e, r.e}};                                                                                    \
+}                                                                                                           \
+template <size_t N, typename T, typename E>                                                                 \
+maths_inline VecExpr<N, T, NODE<T, E, ExprVec<N, T>>> operator OP(const VecExpr<N, T, E>& l, const Vec<N, T>& r) \
+{                                                                                                           \
+    return {{l.e, {&r}}};                                                                                   \
+}                                                                                                           \
+template <size_t N, typename T, typename E>                                                                 \
+maths_inline VecExpr<N, T, NODE<T, ExprVec<N, T>, E>> operator OP(const Vec<N, T>& l, const VecExpr<N, T, E>& r) \
+{                                                                                                           \
+    return {{{&l}, r.e}};                                                                                   \
+}                                                                                                           \
+template <size_t N, typename T, typename E, size_t... SW>                                                   \
+maths_inline VecExpr<N, T, NODE<T, E, ExprSwizzle<T, N, SW...>>> operator OP(const VecExpr<N, T, E>& l,     \
+                                                                             const Swizzle<T, N, SW...>& r) \
+{                                                                                                           \
+    return {{l.e, {&r}}};                                                                                   \
+}                                                                                                           \
+template <size_t N, typename T, typename E, size_t... SW>                                                   \
+maths_inline VecExpr<N, T, NODE<T, ExprSwizzle<T, N, SW...>, E>> operator OP(const Swizzle<T, N, SW...>& l, \
+                                                                             const VecExpr<N, T, E>& r)     \
+{                                                                                                           \
+    return {{{&l}, r.e}};                                                                                   \
+}                                                                                                           \
+template <size_t N, typename T, typename E>                                                                 \
+maths_inline VecExpr<N, T, NODE<T, E, ExprScalar<T>>> operator OP(const VecExpr<N, T, E>& l,                \
+                                                                  typename VecExpr<N, T, E>::scalar_type r) \
+{                                                                                                           \
+    return {{l.e, {r}}};                                                                                    \
+}                                                                                                           \
+template <size_t N, typename T, typename E>                                                                 \
+maths_inline VecExpr<N, T, NODE<T, ExprScalar<T>, E>> operator OP(typename VecExpr<N, T, E>::scalar_type l, \
+                                                                  const VecExpr<N, T, E>& r)                \
+{                                                                                                           \
+    return {{{l}, r.e}};                                                                                    \
+}
+
+EXPR_OP(+, ExprAdd)
+EXPR_OP(-, ExprSub)
+EXPR_OP(*, ExprMul)
+EXPR_OP(/, ExprDiv)
+#undef EXPR_OP
+
+// compound ops evaluate the expression first so operands may alias the destination, ie. v += lazy(v.zyx) * 2.0f
+#define EXPR_COMPOUND_OP(OP)                                                                 \
+template <size_t N, typename T, typename E>                                                  \
+maths_inline Vec<N, T>& operator OP(Vec<N, T>& l, const VecExpr<N, T, E>& r)                 \
+{                                                                                            \
+    return l OP r.eval();                                                                    \
+}
+
+EXPR_COMPOUND_OP(+=)
+EXPR_COMPOUND_OP(-=)
+EXPR_COMPOUND_OP(*=)
+EXPR_COMPOUND_OP(/=)
+#undef EXPR_COMPOUND_OP
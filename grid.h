@@ -0,0 +1,169 @@
+// grid.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+#include "parallel.h"
+
+#include <vector>
+
+// hashed uniform grid for proximity queries between points and spheres. positions are quantised to vec3i cells which
+// are hashed into a power of 2 table, items are counting sorted by bucket so each bucket is a contiguous range and a
+// query walks the few buckets around it. the whole grid is rebuilt each time the items move, which is a couple of
+// linear passes and cheaper than updating a tree when everything moves, as in a crowd.
+//
+// maths::hash_grid grid;
+// maths::build_hash_grid(grid, positions.data(), nullptr, positions.size(), neighbour_radius * 2.0f);
+// maths::hash_grid_query(grid, p, neighbour_radius, neighbours);
+// maths::hash_grid_pairs(grid, neighbour_radius, pairs);
+
+namespace maths
+{
+    struct hash_grid_item
+    {
+        vec3f p;
+        f32   radius;
+        vec3i cell;
+        u32   index; // index of the item in the source arrays
+    };
+
+    struct hash_grid_pair
+    {
+        u32 a; // a < b
+        u32 b;
+    };
+
+    struct hash_grid
+    {
+        f32                         cell_size;
+        f32                         inv_cell_size;
+        f32                         max_radius;
+        u32                         mask;       // table size - 1
+        std::vector<u32>            cell_start; // first item of each bucket, table size + 1 entries
+        std::vector<hash_grid_item> items;      // items sorted by bucket
+    };
+
+    void build_hash_grid(hash_grid& grid, const vec3f* positions, const f32* radii, size_t count, f32 cell_size,
+                         u32 max_threads = 0);
+    void hash_grid_query(const hash_grid& grid, const vec3f& p, f32 radius, std::vector<u32>& results);
+    void hash_grid_pairs(const hash_grid& grid, f32 radius, std::vector<hash_grid_pair>& pairs, u32 max_threads = 0);
+
+    //
+    // Implementation
+    //
+
+    maths_inline vec3i hash_grid_cell(const hash_grid& grid, const vec3f& p)
+    {
+        return vec3i((int)std::floor(p.x * grid.inv_cell_size), (int)std::floor(p.y * grid.inv_cell_size),
+                     (int)std::floor(p.z * grid.inv_cell_size));
+    }
+
+    maths_inline u32 hash_grid_bucket(const hash_grid& grid, const vec3i& c)
+    {
+        return hash_combine(hash_combine(hash_u32((u32)c.x), (u32)c.y), (u32)c.z) & grid.mask;
+    }
+
+    // calls f for every item in the cells overlapped by the cube p +/- reach, cells which share a bucket are
+    // skipped by comparing the cell so each item is visited once
+    template <typename F>
+    maths_inline void hash_grid_visit(const hash_grid& grid, const vec3f& p, f32 reach, F f)
+    {
+        vec3i cmin = hash_grid_cell(grid, p - vec3f(reach));
+        vec3i cmax = hash_grid_cell(grid, p + vec3f(reach));
+        for (int z = cmin.z; z <= cmax.z; ++z)
+            for (int y = cmin.y; y <= cmax.y; ++y)
+                for (int x = cmin.x; x <= cmax.x; ++x)
+                {
+                    u32 b = hash_grid_bucket(grid, vec3i(x, y, z));
+                    for (u32 i = grid.cell_start[b]; i < grid.cell_start[b + 1]; ++i)
+                    {
+                        const hash_grid_item& item = grid.items[i];
+                        if (item.cell.x != x || item.cell.y != y || item.cell.z != z)
+                            continue;
+                        f(i, item);
+                    }
+                }
+    }
+
+    // builds the grid from count positions and optional radii (nullptr for points). a cell_size of twice the typical
+    // query reach (radius + max item radius) keeps queries to 8 cells. bucket and cell computation is split across
+    // threads for large inputs, max_threads 0 uses std::thread::hardware_concurrency, 1 runs on the calling thread.
+    inline void build_hash_grid(hash_grid& grid, const vec3f* positions, const f32* radii, size_t count, f32 cell_size,
+                                u32 max_threads)
+    {
+        u32 table_size = round_up_to_power_of_two((u32)std::max(count * 2, (size_t)2));
+        grid.cell_size = cell_size;
+        grid.inv_cell_size = 1.0f / cell_size;
+        grid.mask = table_size - 1;
+        grid.cell_start.assign(table_size + 1, 0);
+        grid.items.resize(count);
+
+        std::vector<hash_grid_item> unsorted(count);
+        std::vector<u32>            buckets(count);
+        f32                         max_radius[k_max_parallel_ranges] = {};
+        parallel_for(count, 1 << 14, [&](u32 r, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                hash_grid_item& item = unsorted[i];
+                item.p = positions[i];
+                item.radius = radii ? radii[i] : 0.0f;
+                item.cell = hash_grid_cell(grid, item.p);
+                item.index = (u32)i;
+                buckets[i] = hash_grid_bucket(grid, item.cell);
+                max_radius[r] = std::max(max_radius[r], item.radius);
+            }
+        }, max_threads);
+
+        grid.max_radius = 0.0f;
+        for (u32 r = 0; r < k_max_parallel_ranges; ++r)
+            grid.max_radius = std::max(grid.max_radius, max_radius[r]);
+
+        // counting sort by bucket
+        for (size_t i = 0; i < count; ++i)
+            ++grid.cell_start[buckets[i] + 1];
+
+        for (u32 b = 0; b < table_size; ++b)
+            grid.cell_start[b + 1] += grid.cell_start[b];
+
+        std::vector<u32> cursor(grid.cell_start.begin(), grid.cell_start.end() - 1);
+        for (size_t i = 0; i < count; ++i)
+            grid.items[cursor[buckets[i]]++] = unsorted[i];
+    }
+
+    // appends the index of every item whose sphere overlaps the sphere p, radius, or which lies inside it for points
+    inline void hash_grid_query(const hash_grid& grid, const vec3f& p, f32 radius, std::vector<u32>& results)
+    {
+        hash_grid_visit(grid, p, radius + grid.max_radius, [&](u32, const hash_grid_item& item) {
+            if (dist2(p, item.p) < sqr(radius + item.radius))
+                results.push_back(item.index);
+        });
+    }
+
+    // finds every pair of items closer than the sum of their radii plus radius, pass the neighbour distance as radius
+    // for points. items are split into ranges across threads, each range collects its own pairs which are appended
+    // in order so the output does not depend on the thread count.
+    inline void hash_grid_pairs(const hash_grid& grid, f32 radius, std::vector<hash_grid_pair>& pairs, u32 max_threads)
+    {
+        std::vector<hash_grid_pair> range_pairs[k_max_parallel_ranges];
+        parallel_for(grid.items.size(), 1 << 12, [&](u32 r, size_t begin, size_t end) {
+            std::vector<hash_grid_pair>& out = range_pairs[r];
+            for (size_t i = begin; i < end; ++i)
+            {
+                const hash_grid_item& a = grid.items[i];
+                f32 reach = a.radius + radius;
+                hash_grid_visit(grid, a.p, reach + grid.max_radius, [&](u32 j, const hash_grid_item& b) {
+                    // each pair is found from both sides, keep the one from the lower sorted position
+                    if (j <= i || dist2(a.p, b.p) >= sqr(reach + b.radius))
+                        return;
+                    out.push_back({std::min(a.index, b.index), std::max(a.index, b.index)});
+                });
+            }
+        }, max_threads);
+
+        pairs.clear();
+        for (u32 r = 0; r < k_max_parallel_ranges; ++r)
+            pairs.insert(pairs.end(), range_pairs[r].begin(), range_pairs[r].end());
+    }
+}
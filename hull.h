@@ -0,0 +1,352 @@
+// hull.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+#include "parallel.h"
+
+#include <unordered_map>
+
+namespace maths
+{
+    // 3d convex hull, faces are triangles wound so get_normal(v[0], v[1], v[2]) points outwards and planes are in the
+    // same form as frustum planes (xyz = normal, w = plane constant / distance), so a point p is outside the hull if
+    // dot(p, plane.xyz) + plane.w > 0 for any plane.
+    struct convex_hull
+    {
+        std::vector<vec3f>  vertices;
+        std::vector<vec3ui> faces;
+        std::vector<vec4f>  planes;
+    };
+
+    bool convex_hull_from_points(convex_hull& hull, const vec3f* points, size_t count, u32 max_vertices = 0, u32 max_threads = 0);
+    bool convex_hull_from_points(convex_hull& hull, const std::vector<vec3f>& points, u32 max_vertices = 0, u32 max_threads = 0);
+
+    //
+    // Implementation
+    //
+
+    struct quickhull_face
+    {
+        u32              v[3];
+        u32              adj[3]; // neighbour across edge v[i] -> v[(i + 1) % 3]
+        vec3f            n;
+        std::vector<u32> outside; // conflict list of points in front of the face
+        u32              furthest;
+        f32              furthest_dist;
+        u32              visible;
+        bool             dead;
+    };
+
+    static const u32 k_quickhull_none = 0xffffffff;
+
+    // assigns each point in indices to the first face in [face_begin, face_end) it is in front of, points in front of no
+    // face are interior and are dropped. the distance tests are split across threads for large inputs.
+    inline void quickhull_assign(std::vector<quickhull_face>& faces, size_t face_begin, size_t face_end,
+                                 const vec3f* points, const u32* indices, size_t count, f32 eps, u32* scratch, u32 max_threads)
+    {
+        parallel_for(count, 1 << 14, [&](u32, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const vec3f& p = points[indices[i]];
+                scratch[i] = k_quickhull_none;
+                for (size_t f = face_begin; f < face_end; ++f)
+                {
+                    const quickhull_face& face = faces[f];
+                    if (point_plane_distance(p, points[face.v[0]], face.n) > eps)
+                    {
+                        scratch[i] = (u32)f;
+                        break;
+                    }
+                }
+            }
+        }, max_threads);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (scratch[i] == k_quickhull_none)
+                continue;
+
+            quickhull_face& face = faces[scratch[i]];
+            f32 d = point_plane_distance(points[indices[i]], points[face.v[0]], face.n);
+            if (face.outside.empty() || d > face.furthest_dist)
+            {
+                face.furthest = indices[i];
+                face.furthest_dist = d;
+            }
+            face.outside.push_back(indices[i]);
+        }
+    }
+
+    inline u32 quickhull_add_face(std::vector<quickhull_face>& faces, const vec3f* points, u32 a, u32 b, u32 c)
+    {
+        quickhull_face f;
+        f.v[0] = a;
+        f.v[1] = b;
+        f.v[2] = c;
+        f.adj[0] = f.adj[1] = f.adj[2] = k_quickhull_none;
+        f.n = get_normal(points[a], points[b], points[c]);
+        f.furthest = k_quickhull_none;
+        f.furthest_dist = 0.0f;
+        f.visible = k_quickhull_none;
+        f.dead = false;
+        faces.push_back(std::move(f));
+        return (u32)faces.size() - 1;
+    }
+
+    // computes the 3d convex hull of count points with quickhull, returns false if the points are coplanar or
+    // degenerate. faces are expanded in order of their furthest point so max_vertices > 0, which stops adding points
+    // once the hull has that many vertices, gives a simplified hull made of the most extreme points. partitioning
+    // points onto faces is split across threads for large inputs, max_threads 0 uses
+    // std::thread::hardware_concurrency, 1 runs on the calling thread.
+    inline bool convex_hull_from_points(convex_hull& hull, const vec3f* points, size_t count, u32 max_vertices, u32 max_threads)
+    {
+        hull.vertices.clear();
+        hull.faces.clear();
+        hull.planes.clear();
+
+        if (count < 4)
+            return false;
+
+        // extreme points along each axis
+        u32   ext[6] = {0, 0, 0, 0, 0, 0};
+        vec3f vmin = points[0];
+        vec3f vmax = points[0];
+        for (size_t i = 1; i < count; ++i)
+        {
+            for (size_t a = 0; a < 3; ++a)
+            {
+                if (points[i][a] < points[ext[a * 2]][a])
+                    ext[a * 2] = (u32)i;
+                if (points[i][a] > points[ext[a * 2 + 1]][a])
+                    ext[a * 2 + 1] = (u32)i;
+            }
+            vmin = min_union(vmin, points[i]);
+            vmax = max_union(vmax, points[i]);
+        }
+
+        vec3f extent = max_union(abs(vmin), abs(vmax));
+        f32   eps = 3.0f * FLT_EPSILON * (extent.x + extent.y + extent.z);
+
+        // initial tetrahedron, the most distant extremes then the furthest points from the line and the plane
+        u32 s[4] = {ext[0], ext[1], 0, 0};
+        f32 best = 0.0f;
+        for (size_t i = 0; i < 6; ++i)
+            for (size_t j = i + 1; j < 6; ++j)
+            {
+                f32 d = dist2(points[ext[i]], points[ext[j]]);
+                if (d > best)
+                {
+                    best = d;
+                    s[0] = ext[i];
+                    s[1] = ext[j];
+                }
+            }
+
+        best = 0.0f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            f32 d = point_segment_distance(points[i], points[s[0]], points[s[1]]);
+            if (d > best)
+            {
+                best = d;
+                s[2] = (u32)i;
+            }
+        }
+
+        if (best <= eps)
+            return false;
+
+        best = 0.0f;
+        vec3f n = get_normal(points[s[0]], points[s[1]], points[s[2]]);
+        for (size_t i = 0; i < count; ++i)
+        {
+            f32 d = fabs(point_plane_distance(points[i], points[s[0]], n));
+            if (d > best)
+            {
+                best = d;
+                s[3] = (u32)i;
+            }
+        }
+
+        if (best <= eps)
+            return false;
+
+        std::vector<quickhull_face> faces;
+        const u32 tri[4][4] = {{0, 1, 2, 3}, {0, 1, 3, 2}, {1, 2, 3, 0}, {2, 0, 3, 1}};
+        for (size_t i = 0; i < 4; ++i)
+        {
+            u32 a = s[tri[i][0]], b = s[tri[i][1]], c = s[tri[i][2]];
+            if (point_plane_distance(points[s[tri[i][3]]], points[a], get_normal(points[a], points[b], points[c])) > 0.0f)
+                std::swap(a, b);
+            quickhull_add_face(faces, points, a, b, c);
+        }
+
+        for (size_t f = 0; f < 4; ++f)
+            for (size_t e = 0; e < 3; ++e)
+                for (size_t g = 0; g < 4; ++g)
+                    for (size_t h = 0; h < 3; ++h)
+                        if (faces[f].v[e] == faces[g].v[(h + 1) % 3] && faces[f].v[(e + 1) % 3] == faces[g].v[h])
+                            faces[f].adj[e] = (u32)g;
+
+        // partition all points onto the initial faces
+        std::vector<u32> indices(count);
+        std::vector<u32> scratch(count);
+        for (size_t i = 0; i < count; ++i)
+            indices[i] = (u32)i;
+        quickhull_assign(faces, 0, 4, points, indices.data(), count, eps, scratch.data(), max_threads);
+
+        // max heap of faces with points outside by furthest_dist
+        auto further = [&faces](u32 a, u32 b) { return faces[a].furthest_dist < faces[b].furthest_dist; };
+        std::vector<u32> pending = {0, 1, 2, 3};
+        std::make_heap(pending.begin(), pending.end(), further);
+        std::vector<u32> visible;
+        std::vector<u32> horizon; // pairs of visible face, edge index
+        std::vector<u32> conflicts;
+        std::unordered_map<u32, u32> edge_start, edge_end;
+        u32 iteration = 0;
+
+        // live faces using each point, vertices buried by an expansion drop out of num_vertices
+        std::vector<u32> vertex_faces(count, 0);
+        u32              num_vertices = 4;
+        for (size_t f = 0; f < 4; ++f)
+            for (u32 i = 0; i < 3; ++i)
+                ++vertex_faces[faces[f].v[i]];
+
+        while (!pending.empty())
+        {
+            if (max_vertices > 0 && num_vertices >= max_vertices)
+                break;
+
+            std::pop_heap(pending.begin(), pending.end(), further);
+            u32 fi = pending.back();
+            pending.pop_back();
+            if (faces[fi].dead || faces[fi].outside.empty())
+                continue;
+
+            u32          eye = faces[fi].furthest;
+            const vec3f& ep = points[eye];
+
+            // flood visible faces from fi, edges to faces which can't see the eye form the horizon
+            visible.clear();
+            horizon.clear();
+            visible.push_back(fi);
+            faces[fi].visible = iteration;
+            for (size_t i = 0; i < visible.size(); ++i)
+            {
+                const quickhull_face& vf = faces[visible[i]];
+                for (u32 e = 0; e < 3; ++e)
+                {
+                    quickhull_face& nf = faces[vf.adj[e]];
+                    if (nf.visible == iteration)
+                        continue;
+
+                    if (point_plane_distance(ep, points[nf.v[0]], nf.n) > eps)
+                    {
+                        nf.visible = iteration;
+                        visible.push_back(vf.adj[e]);
+                    }
+                    else
+                    {
+                        horizon.push_back(visible[i]);
+                        horizon.push_back(e);
+                    }
+                }
+            }
+
+            // cone of new faces from the horizon to the eye
+            size_t first_new = faces.size();
+            edge_start.clear();
+            edge_end.clear();
+            for (size_t h = 0; h < horizon.size(); h += 2)
+            {
+                u32 vfi = horizon[h];
+                u32 e = horizon[h + 1];
+                u32 a = faces[vfi].v[e];
+                u32 b = faces[vfi].v[(e + 1) % 3];
+                u32 nbi = faces[vfi].adj[e];
+
+                u32 nfi = quickhull_add_face(faces, points, a, b, eye);
+                faces[nfi].adj[0] = nbi;
+
+                quickhull_face& nb = faces[nbi];
+                for (u32 j = 0; j < 3; ++j)
+                    if (nb.adj[j] == vfi && nb.v[j] == b)
+                        nb.adj[j] = nfi;
+
+                edge_start[a] = nfi;
+                edge_end[b] = nfi;
+            }
+
+            for (size_t f = first_new; f < faces.size(); ++f)
+            {
+                faces[f].adj[1] = edge_start[faces[f].v[1]];
+                faces[f].adj[2] = edge_end[faces[f].v[0]];
+            }
+
+            for (size_t f = first_new; f < faces.size(); ++f)
+                for (u32 i = 0; i < 3; ++i)
+                    if (vertex_faces[faces[f].v[i]]++ == 0)
+                        ++num_vertices;
+
+            // move conflict points from the visible faces onto the new ones
+            conflicts.clear();
+            for (u32 vfi : visible)
+            {
+                quickhull_face& vf = faces[vfi];
+                for (u32 p : vf.outside)
+                    if (p != eye)
+                        conflicts.push_back(p);
+                vf.dead = true;
+                std::vector<u32>().swap(vf.outside);
+                for (u32 i = 0; i < 3; ++i)
+                    if (--vertex_faces[vf.v[i]] == 0)
+                        --num_vertices;
+            }
+
+            quickhull_assign(faces, first_new, faces.size(), points, conflicts.data(), conflicts.size(), eps, scratch.data(),
+                             max_threads);
+
+            for (size_t f = first_new; f < faces.size(); ++f)
+                if (!faces[f].outside.empty())
+                {
+                    pending.push_back((u32)f);
+                    std::push_heap(pending.begin(), pending.end(), further);
+                }
+
+            ++iteration;
+        }
+
+        // compact the vertices used by the remaining faces
+        std::unordered_map<u32, u32> remap;
+        for (auto& f : faces)
+        {
+            if (f.dead)
+                continue;
+
+            vec3ui tri_out;
+            for (u32 i = 0; i < 3; ++i)
+            {
+                auto it = remap.find(f.v[i]);
+                if (it == remap.end())
+                {
+                    it = remap.insert(std::make_pair(f.v[i], (u32)hull.vertices.size())).first;
+                    hull.vertices.push_back(points[f.v[i]]);
+                }
+                tri_out[i] = it->second;
+            }
+
+            hull.faces.push_back(tri_out);
+            hull.planes.push_back(vec4f(f.n, plane_distance(points[f.v[0]], f.n)));
+        }
+
+        return true;
+    }
+
+    inline bool convex_hull_from_points(convex_hull& hull, const std::vector<vec3f>& points, u32 max_vertices, u32 max_threads)
+    {
+        return convex_hull_from_points(hull, points.data(), points.size(), max_vertices, max_threads);
+    }
+}
@@ -7,7 +7,28 @@
 #include "vec.h"
 #include <string.h> // memcpy linux
 
-template <size_t R, size_t C, typename T>
+// storage layouts for Mat, a policy maps row r and column c to an index into m. row major is the default and what
+// the mat:: functions expect. column major stores each column contiguously which is the layout glsl, vulkan and
+// opengl expect, so matrices can be built and uploaded without a transpose.
+struct mat_row_major
+{
+    static const bool k_row_major = true;
+    static maths_inline size_t index(size_t r, size_t c, size_t, size_t C)
+    {
+        return r * C + c;
+    }
+};
+
+struct mat_column_major
+{
+    static const bool k_row_major = false;
+    static maths_inline size_t index(size_t r, size_t c, size_t R, size_t)
+    {
+        return c * R + r;
+    }
+};
+
+template <size_t R, size_t C, typename T, typename L = mat_row_major>
 struct Mat
 {
     T m[R * C];
@@ -15,82 +36,84 @@ struct Mat
     // Constructors
     Mat(){};
 
+    // copies R * C elements in storage order
     Mat(T* data)
     {
         for (size_t i = 0; i < R * C; ++i)
             m[i] = data[i];
     }
 
-    template <size_t R2, size_t C2>
-    Mat(const Mat<R2, C2, T>& other)
+    // converts from another size or layout, elements outside of other are taken from the identity
+    template <size_t R2, size_t C2, typename L2>
+    Mat(const Mat<R2, C2, T, L2>& other)
     {
         for (size_t r = 0; r < R; ++r)
         {
             for (size_t c = 0; c < C; ++c)
             {
-                m.at(r, c) = other.at(r, c);
+                at(r, c) = r < R2 && c < C2 ? other.at(r, c) : (T)(r == c ? 1 : 0);
             }
         }
     }
     
-    // common ctrs for initializer lists
+    // common ctrs for initializer lists, elements are in row order for either layout
     template < size_t R2 = R, size_t C2 = C, typename = typename std::enable_if< R2 == 2 && C2 == 2 >::type >
-    Mat<R, C, T>(T v00, T v01,
-                 T v10, T v11)
+    Mat(T v00, T v01,
+        T v10, T v11)
     {
-        m[0] = v00;
-        m[1] = v01;
-        m[2] = v10;
-        m[3] = v11;
+        at(0, 0) = v00;
+        at(0, 1) = v01;
+        at(1, 0) = v10;
+        at(1, 1) = v11;
     }
     
     template < size_t R2 = R, size_t C2 = C, typename = typename std::enable_if< R2 == 3 && C2 == 3 >::type >
-    Mat<R, C, T>(T v00, T v01, T v02,
-                 T v10, T v11, T v12,
-                 T v20, T v21, T v22)
-    {
-        m[0] = v00;
-        m[1] = v01;
-        m[2] = v02;
-        m[3] = v10;
-        m[4] = v11;
-        m[5] = v12;
-        m[6] = v20;
-        m[7] = v21;
-        m[8] = v22;
+    Mat(T v00, T v01, T v02,
+        T v10, T v11, T v12,
+        T v20, T v21, T v22)
+    {
+        at(0, 0) = v00;
+        at(0, 1) = v01;
+        at(0, 2) = v02;
+        at(1, 0) = v10;
+        at(1, 1) = v11;
+        at(1, 2) = v12;
+        at(2, 0) = v20;
+        at(2, 1) = v21;
+        at(2, 2) = v22;
     }
     
     template < size_t R2 = R, size_t C2 = C, typename = typename std::enable_if< R2 == 4 && C2 == 4 >::type >
-    Mat<R, C, T>(T v00, T v01, T v02, T v03,
-                 T v10, T v11, T v12, T v13,
-                 T v20, T v21, T v22, T v23,
-                 T v30, T v31, T v32, T v33)
-    {
-        m[0] = v00;
-        m[1] = v01;
-        m[2] = v02;
-        m[3] = v03;
-        m[4] = v10;
-        m[5] = v11;
-        m[6] = v12;
-        m[7] = v13;
-        m[8] = v20;
-        m[9] = v21;
-        m[10] = v22;
-        m[11] = v23;
-        m[12] = v30;
-        m[13] = v31;
-        m[14] = v32;
-        m[15] = v33;
-    }
-
-    static Mat<R, C, T> create_identity();
+    Mat(T v00, T v01, T v02, T v03,
+        T v10, T v11, T v12, T v13,
+        T v20, T v21, T v22, T v23,
+        T v30, T v31, T v32, T v33)
+    {
+        at(0, 0) = v00;
+        at(0, 1) = v01;
+        at(0, 2) = v02;
+        at(0, 3) = v03;
+        at(1, 0) = v10;
+        at(1, 1) = v11;
+        at(1, 2) = v12;
+        at(1, 3) = v13;
+        at(2, 0) = v20;
+        at(2, 1) = v21;
+        at(2, 2) = v22;
+        at(2, 3) = v23;
+        at(3, 0) = v30;
+        at(3, 1) = v31;
+        at(3, 2) = v32;
+        at(3, 3) = v33;
+    }
+
+    static Mat<R, C, T, L> create_identity();
 
     // Operators
-    Mat<R, C, T>  operator*(T rhs) const;
-    Mat<R, C, T>& operator*=(T rhs);
-    Mat<R, C, T>  operator*(const Mat<R, C, T>& rhs) const;
-    Mat<R, C, T>& operator*=(const Mat<R, C, T>& rhs);
+    Mat<R, C, T, L>  operator*(T rhs) const;
+    Mat<R, C, T, L>& operator*=(T rhs);
+    Mat<R, C, T, L>  operator*(const Mat<R, C, T, L>& rhs) const;
+    Mat<R, C, T, L>& operator*=(const Mat<R, C, T, L>& rhs);
     Vec<C, T>     operator*(const Vec<C, T>& rhs) const;
     T&            operator()(size_t r, size_t c);
     const T&      operator()(size_t r, size_t c) const;
@@ -98,84 +121,106 @@ struct Mat
     // Accessors
     T&        at(size_t r, size_t c);
     const T&  at(size_t r, size_t c) const;
-    Vec<R, T> get_row(size_t index) const;
-    Vec<C, T> get_column(size_t index) const;
+    Vec<C, T> get_row(size_t index) const;
+    Vec<R, T> get_column(size_t index) const;
     Vec<3, T> get_translation() const;
-    void      set_row(size_t index, const Vec<R, T>& row);
-    void      set_column(size_t index, const Vec<C, T>& col);
+    void      set_row(size_t index, const Vec<C, T>& row);
+    void      set_column(size_t index, const Vec<R, T>& col);
     void      set_translation(const Vec<3, T>& t);
     void      set_vectors(const Vec<3, T>& right, const Vec<3, T>& up, const Vec<3, T>& at, const Vec<3, T>& pos);
 
     // Computation
-    Mat<R, C, T> multiply(T scalar) const;
-    Mat<R, C, T> multiply(const Mat<R, C, T>& rhs) const;
+    Mat<R, C, T, L> multiply(T scalar) const;
+    Mat<R, C, T, L> multiply(const Mat<R, C, T, L>& rhs) const;
     Vec<C, T>    multiply(const Vec<C, T>& rhs) const;
     Vec<4, T>    transform_vector(const Vec<4, T>& v) const;
     Vec<3, T>    transform_vector(const Vec<3, T>& v, T& w) const;
     Vec<3, T>    transform_vector(const Vec<3, T>& v) const;
-    Mat<R, C, T> transposed();
+    Mat<R, C, T, L> transposed();
     void         transpose();
 };
 
 // Accessor Functions
-template <size_t R, size_t C, typename T>
-maths_inline T& Mat<R, C, T>::at(size_t r, size_t c)
+template <size_t R, size_t C, typename T, typename L>
+maths_inline T& Mat<R, C, T, L>::at(size_t r, size_t c)
 {
-    return m[r * C + c];
+    return m[L::index(r, c, R, C)];
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline const T& Mat<R, C, T>::at(size_t r, size_t c) const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline const T& Mat<R, C, T, L>::at(size_t r, size_t c) const
 {
-    return m[r * C + c];
+    return m[L::index(r, c, R, C)];
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Vec<R, T> Mat<R, C, T>::get_row(size_t index) const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<C, T> Mat<R, C, T, L>::get_row(size_t index) const
 {
-    return Vec<R, T>(&m[index * C]);
+    if (L::k_row_major)
+        return Vec<C, T>(&m[index * C]);
+
+    Vec<C, T> row;
+    for (size_t i = 0; i < C; ++i)
+        row[i] = at(index, i);
+
+    return row;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Vec<C, T> Mat<R, C, T>::get_column(size_t index) const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<R, T> Mat<R, C, T, L>::get_column(size_t index) const
 {
-    Vec<C, T> col;
+    if (!L::k_row_major)
+        return Vec<R, T>(&m[index * R]);
+
+    Vec<R, T> col;
     for (size_t i = 0; i < R; ++i)
         col[i] = at(i, index);
 
     return col;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Vec<3, T> Mat<R, C, T>::get_translation() const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<3, T> Mat<R, C, T, L>::get_translation() const
 {
-    return Vec<3, T>(m[3], m[7], m[11]);
+    return Vec<3, T>(at(0, 3), at(1, 3), at(2, 3));
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline void Mat<R, C, T>::set_row(size_t index, const Vec<R, T>& row)
+template <size_t R, size_t C, typename T, typename L>
+maths_inline void Mat<R, C, T, L>::set_row(size_t index, const Vec<C, T>& row)
 {
-    size_t i = index * C;
-    memcpy(&m[i], &row.v, sizeof(T) * C);
+    if (L::k_row_major)
+    {
+        memcpy(&m[index * C], &row.v, sizeof(T) * C);
+        return;
+    }
+
+    for (size_t c = 0; c < C; ++c)
+        at(index, c) = row[c];
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline void Mat<R, C, T>::set_column(size_t index, const Vec<C, T>& col)
+template <size_t R, size_t C, typename T, typename L>
+maths_inline void Mat<R, C, T, L>::set_column(size_t index, const Vec<R, T>& col)
 {
+    if (!L::k_row_major)
+    {
+        memcpy(&m[index * R], &col.v, sizeof(T) * R);
+        return;
+    }
+
     for (size_t r = 0; r < R; ++r)
         at(r, index) = col[r];
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline void Mat<R, C, T>::set_translation(const Vec<3, T>& t)
+template <size_t R, size_t C, typename T, typename L>
+maths_inline void Mat<R, C, T, L>::set_translation(const Vec<3, T>& t)
 {
-    m[3]  = t.x;
-    m[7]  = t.y;
-    m[11] = t.z;
+    at(0, 3) = t.x;
+    at(1, 3) = t.y;
+    at(2, 3) = t.z;
 }
 
-template <size_t R, size_t C, typename T>
-void Mat<R, C, T>::set_vectors(const Vec<3, T>& right, const Vec<3, T>& up, const Vec<3, T>& at, const Vec<3, T>& pos)
+template <size_t R, size_t C, typename T, typename L>
+void Mat<R, C, T, L>::set_vectors(const Vec<3, T>& right, const Vec<3, T>& up, const Vec<3, T>& at, const Vec<3, T>& pos)
 {
     set_row(0, Vec<4, T>(right, pos.x));
     set_row(1, Vec<4, T>(up, pos.y));
@@ -184,55 +229,57 @@ void Mat<R, C, T>::set_vectors(const Vec<3, T>& right, const Vec<3, T>& up, cons
 }
 
 // Operators
-template <size_t R, size_t C, typename T>
-maths_inline Vec<C, T> Mat<R, C, T>::operator*(const Vec<C, T>& rhs) const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<C, T> Mat<R, C, T, L>::operator*(const Vec<C, T>& rhs) const
 {
     return multiply(rhs);
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Mat<R, C, T> Mat<R, C, T>::operator*(const Mat<R, C, T>& rhs) const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Mat<R, C, T, L> Mat<R, C, T, L>::operator*(const Mat<R, C, T, L>& rhs) const
 {
     return multiply(rhs);
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Mat<R, C, T>& Mat<R, C, T>::operator*=(const Mat<R, C, T>& rhs)
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Mat<R, C, T, L>& Mat<R, C, T, L>::operator*=(const Mat<R, C, T, L>& rhs)
 {
     *this = multiply(rhs);
     return *this;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Mat<R, C, T> Mat<R, C, T>::operator*(T rhs) const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Mat<R, C, T, L> Mat<R, C, T, L>::operator*(T rhs) const
 {
     return multiply(rhs);
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Mat<R, C, T>& Mat<R, C, T>::operator*=(T rhs)
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Mat<R, C, T, L>& Mat<R, C, T, L>::operator*=(T rhs)
 {
     *this = multiply(rhs);
     return *this;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline T& Mat<R, C, T>::operator()(size_t r, size_t c)
+template <size_t R, size_t C, typename T, typename L>
+maths_inline T& Mat<R, C, T, L>::operator()(size_t r, size_t c)
 {
     return at(r, c);
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline const T& Mat<R, C, T>::operator()(size_t r, size_t c) const
+template <size_t R, size_t C, typename T, typename L>
+maths_inline const T& Mat<R, C, T, L>::operator()(size_t r, size_t c) const
 {
     return at(r, c);
 }
 
 // Computation functions
-template <size_t R, size_t C, typename T>
-inline Mat<R, C, T> Mat<R, C, T>::multiply(const Mat<R, C, T>& rhs) const
+
+// matrix products go through mat_multiply so shapes with a faster path can overload it
+template <size_t R, size_t C, typename T, typename L>
+inline Mat<R, C, T, L> mat_multiply(const Mat<R, C, T, L>& lhs, const Mat<R, C, T, L>& rhs)
 {
-    Mat<R, C, T> result;
+    Mat<R, C, T, L> result;
 
     for (size_t r = 0; r < R; ++r)
     {
@@ -240,7 +287,7 @@ inline Mat<R, C, T> Mat<R, C, T>::multiply(const Mat<R, C, T>& rhs) const
         {
             T& element = result.at(r, c);
 
-            Vec<R, T> vr = get_row(r);
+            Vec<R, T> vr = lhs.get_row(r);
             Vec<R, T> vc = rhs.get_column(c);
 
             element = dot(vr, vc);
@@ -250,80 +297,316 @@ inline Mat<R, C, T> Mat<R, C, T>::multiply(const Mat<R, C, T>& rhs) const
     return result;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Mat<R, C, T> Mat<R, C, T>::multiply(T scalar) const
+// 3x4 matrices are affine transforms with an implied bottom row of 0, 0, 0, 1. the product skips the implied row,
+// 36 multiplies instead of the 64 of a 4x4
+template <typename T>
+inline Mat<3, 4, T> mat_multiply(const Mat<3, 4, T>& lhs, const Mat<3, 4, T>& rhs)
 {
-    Mat<R, C, T> result;
-    for (size_t i = 0; i < R * C; ++i)
+    Mat<3, 4, T> result;
+    const T*     b = rhs.m;
+    for (size_t r = 0; r < 3; ++r)
     {
-        result.m[i] = m[i] * scalar;
+        const T* a = &lhs.m[r * 4];
+        T*       o = &result.m[r * 4];
+        o[0] = a[0] * b[0] + a[1] * b[4] + a[2] * b[8];
+        o[1] = a[0] * b[1] + a[1] * b[5] + a[2] * b[9];
+        o[2] = a[0] * b[2] + a[1] * b[6] + a[2] * b[10];
+        o[3] = a[0] * b[3] + a[1] * b[7] + a[2] * b[11] + a[3];
     }
 
     return result;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Vec<C, T> Mat<R, C, T>::multiply(const Vec<C, T>& v) const
+// 4x4 products unrolled, row r of the result is the rows of rhs scaled by the elements of row r of lhs
+template <typename T>
+inline Mat<4, 4, T> mat_multiply(const Mat<4, 4, T>& lhs, const Mat<4, 4, T>& rhs)
 {
-    Vec<C, T> result;
-    for (size_t r = 0; r < R; ++r)
+    Mat<4, 4, T> result;
+    const T*     b = rhs.m;
+    for (size_t r = 0; r < 4; ++r)
     {
-        result[r] = dot(v, get_row(r));
+        const T* a = &lhs.m[r * 4];
+        T*       o = &result.m[r * 4];
+        for (size_t c = 0; c < 4; ++c)
+            o[c] = a[0] * b[c] + a[1] * b[4 + c] + a[2] * b[8 + c] + a[3] * b[12 + c];
     }
-    
+
     return result;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Vec<4, T> Mat<R, C, T>::transform_vector(const Vec<4, T>& v) const
+#ifdef MATHS_SSE
+maths_inline __m128 mat_madd(__m128 a, __m128 b, __m128 c)
 {
-    Vec<4, T> result;
-    for (size_t r = 0; r < R; ++r)
+#ifdef MATHS_FMA
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+#ifdef MATHS_AVX
+maths_inline __m256 mat_madd(__m256 a, __m256 b, __m256 c)
+{
+#ifdef MATHS_FMA
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+maths_inline __m256d mat_madd(__m256d a, __m256d b, __m256d c)
+{
+#ifdef MATHS_FMA
+    return _mm256_fmadd_pd(a, b, c);
+#else
+    return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+#endif
+
+// the same with each element of lhs broadcast across a register and multiplied into a whole row of rhs, avx does 2
+// rows per register with the rows of rhs in both halves. on raw row major elements so both layouts can share it
+inline void mat_multiply_4x4(const f32* lhs, const f32* rhs, f32* result)
+{
+#ifdef MATHS_AVX
+    __m256 b0 = _mm256_broadcast_ps((const __m128*)&rhs[0]);
+    __m256 b1 = _mm256_broadcast_ps((const __m128*)&rhs[4]);
+    __m256 b2 = _mm256_broadcast_ps((const __m128*)&rhs[8]);
+    __m256 b3 = _mm256_broadcast_ps((const __m128*)&rhs[12]);
+    for (size_t r = 0; r < 4; r += 2)
     {
-        result[r] = dot(v, get_row(r));
+        __m256 a = _mm256_loadu_ps(&lhs[r * 4]);
+        __m256 o = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), b0);
+        o = mat_madd(_mm256_shuffle_ps(a, a, 0x55), b1, o);
+        o = mat_madd(_mm256_shuffle_ps(a, a, 0xaa), b2, o);
+        o = mat_madd(_mm256_shuffle_ps(a, a, 0xff), b3, o);
+        _mm256_storeu_ps(&result[r * 4], o);
     }
+#else
+    __m128 b0 = _mm_loadu_ps(&rhs[0]);
+    __m128 b1 = _mm_loadu_ps(&rhs[4]);
+    __m128 b2 = _mm_loadu_ps(&rhs[8]);
+    __m128 b3 = _mm_loadu_ps(&rhs[12]);
+    for (size_t r = 0; r < 4; ++r)
+    {
+        __m128 a = _mm_loadu_ps(&lhs[r * 4]);
+        __m128 o = _mm_mul_ps(_mm_shuffle_ps(a, a, 0x00), b0);
+        o = mat_madd(_mm_shuffle_ps(a, a, 0x55), b1, o);
+        o = mat_madd(_mm_shuffle_ps(a, a, 0xaa), b2, o);
+        o = mat_madd(_mm_shuffle_ps(a, a, 0xff), b3, o);
+        _mm_storeu_ps(&result[r * 4], o);
+    }
+#endif
+}
 
+inline Mat<4, 4, f32> mat_multiply(const Mat<4, 4, f32>& lhs, const Mat<4, 4, f32>& rhs)
+{
+    Mat<4, 4, f32> result;
+    mat_multiply_4x4(lhs.m, rhs.m, result.m);
     return result;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Vec<3, T> Mat<R, C, T>::transform_vector(const Vec<3, T>& v, T& w) const
+// m * v as a dot product of each row with v, the 4 products are summed with 2 horizontal adds
+inline Vec<4, f32> mat_multiply(const Mat<4, 4, f32>& lhs, const Vec<4, f32>& v)
 {
-    Vec<4, T> result = Vec<4, T>(v, w);
-    Vec<4, T> v4     = Vec<4, T>(v, w);
-    for (size_t r = 0; r < R; ++r)
+    __m128 x = _mm_loadu_ps(v.v);
+    __m128 r0 = _mm_mul_ps(_mm_loadu_ps(&lhs.m[0]), x);
+    __m128 r1 = _mm_mul_ps(_mm_loadu_ps(&lhs.m[4]), x);
+    __m128 r2 = _mm_mul_ps(_mm_loadu_ps(&lhs.m[8]), x);
+    __m128 r3 = _mm_mul_ps(_mm_loadu_ps(&lhs.m[12]), x);
+    Vec<4, f32> result;
+    result.simd = _mm_hadd_ps(_mm_hadd_ps(r0, r1), _mm_hadd_ps(r2, r3));
+    return result;
+}
+#endif
+
+#ifdef MATHS_AVX
+inline Mat<4, 4, f64> mat_multiply(const Mat<4, 4, f64>& lhs, const Mat<4, 4, f64>& rhs)
+{
+    Mat<4, 4, f64> result;
+    __m256d b0 = _mm256_loadu_pd(&rhs.m[0]);
+    __m256d b1 = _mm256_loadu_pd(&rhs.m[4]);
+    __m256d b2 = _mm256_loadu_pd(&rhs.m[8]);
+    __m256d b3 = _mm256_loadu_pd(&rhs.m[12]);
+    for (size_t r = 0; r < 4; ++r)
     {
-        result[r] = dot(v4, get_row(r));
+        const f64* a = &lhs.m[r * 4];
+        __m256d o = _mm256_mul_pd(_mm256_broadcast_sd(&a[0]), b0);
+        o = mat_madd(_mm256_broadcast_sd(&a[1]), b1, o);
+        o = mat_madd(_mm256_broadcast_sd(&a[2]), b2, o);
+        o = mat_madd(_mm256_broadcast_sd(&a[3]), b3, o);
+        _mm256_storeu_pd(&result.m[r * 4], o);
     }
+    return result;
+}
 
-    w = result.w;
-    return result.xyz;
+// m * v as the columns of m scaled by the elements of v, there is no cheap horizontal add for 4 doubles
+inline Vec<4, f64> mat_multiply(const Mat<4, 4, f64>& lhs, const Vec<4, f64>& v)
+{
+    __m256d r0 = _mm256_loadu_pd(&lhs.m[0]);
+    __m256d r1 = _mm256_loadu_pd(&lhs.m[4]);
+    __m256d r2 = _mm256_loadu_pd(&lhs.m[8]);
+    __m256d r3 = _mm256_loadu_pd(&lhs.m[12]);
+
+    // transpose rows to columns
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+    __m256d c0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+    __m256d c1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+    __m256d c2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+    __m256d c3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+
+    __m256d o = _mm256_mul_pd(c0, _mm256_broadcast_sd(&v.v[0]));
+    o = mat_madd(c1, _mm256_broadcast_sd(&v.v[1]), o);
+    o = mat_madd(c2, _mm256_broadcast_sd(&v.v[2]), o);
+    o = mat_madd(c3, _mm256_broadcast_sd(&v.v[3]), o);
+
+    Vec<4, f64> result;
+    _mm256_storeu_pd(result.v, o);
+    return result;
 }
+#endif
 
-template <size_t R, size_t C, typename T>
-maths_inline Vec<3, T> Mat<R, C, T>::transform_vector(const Vec<3, T>& v) const
+// matrix * vector, rows past R keep v, which for a 3x4 affine matrix is the implied 0, 0, 0, 1 row
+template <size_t R, size_t C, typename T, typename L>
+inline Vec<C, T> mat_multiply(const Mat<R, C, T, L>& lhs, const Vec<C, T>& v)
 {
-    Vec<4, T> result = Vec<4, T>(v, 1.0);
-    Vec<4, T> v4     = Vec<4, T>(v, 1.0);
+    Vec<C, T> result = v;
     for (size_t r = 0; r < R; ++r)
     {
-        result[r] = dot(v4, get_row(r));
+        result[r] = dot(v, lhs.get_row(r));
+    }
+
+    return result;
+}
+
+// column major storage of a matrix is the row major storage of its transpose and (ab)^T = b^T a^T, so square column
+// major products reuse the row major paths with the operands swapped
+template <size_t N, typename T>
+inline Mat<N, N, T, mat_column_major> mat_multiply(const Mat<N, N, T, mat_column_major>& lhs,
+                                                   const Mat<N, N, T, mat_column_major>& rhs)
+{
+    Mat<N, N, T> lt, rt;
+    memcpy(lt.m, lhs.m, sizeof(lt.m));
+    memcpy(rt.m, rhs.m, sizeof(rt.m));
+    Mat<N, N, T> pt = mat_multiply(rt, lt);
+
+    Mat<N, N, T, mat_column_major> result;
+    memcpy(result.m, pt.m, sizeof(result.m));
+    return result;
+}
+
+// column c of an affine product is the 3x3 of lhs times column c of rhs, plus the translation of lhs for column 3
+template <typename T>
+inline Mat<3, 4, T, mat_column_major> mat_multiply(const Mat<3, 4, T, mat_column_major>& lhs,
+                                                   const Mat<3, 4, T, mat_column_major>& rhs)
+{
+    Mat<3, 4, T, mat_column_major> result;
+    const T* a = lhs.m;
+    for (size_t c = 0; c < 4; ++c)
+    {
+        const T* b = &rhs.m[c * 3];
+        T*       o = &result.m[c * 3];
+        for (size_t r = 0; r < 3; ++r)
+            o[r] = a[r] * b[0] + a[3 + r] * b[1] + a[6 + r] * b[2] + (c == 3 ? a[9 + r] : (T)0);
     }
 
+    return result;
+}
+
+#ifdef MATHS_SSE
+inline Mat<4, 4, f32, mat_column_major> mat_multiply(const Mat<4, 4, f32, mat_column_major>& lhs,
+                                                     const Mat<4, 4, f32, mat_column_major>& rhs)
+{
+    Mat<4, 4, f32, mat_column_major> result;
+    mat_multiply_4x4(rhs.m, lhs.m, result.m);
+    return result;
+}
+
+// column major m * v is the columns of m scaled by the elements of v, no transpose or horizontal add
+inline Vec<4, f32> mat_multiply(const Mat<4, 4, f32, mat_column_major>& lhs, const Vec<4, f32>& v)
+{
+    __m128 o = _mm_mul_ps(_mm_loadu_ps(&lhs.m[0]), _mm_set1_ps(v.v[0]));
+    o = mat_madd(_mm_loadu_ps(&lhs.m[4]), _mm_set1_ps(v.v[1]), o);
+    o = mat_madd(_mm_loadu_ps(&lhs.m[8]), _mm_set1_ps(v.v[2]), o);
+    o = mat_madd(_mm_loadu_ps(&lhs.m[12]), _mm_set1_ps(v.v[3]), o);
+    Vec<4, f32> result;
+    result.simd = o;
+    return result;
+}
+#endif
+
+#ifdef MATHS_AVX
+inline Vec<4, f64> mat_multiply(const Mat<4, 4, f64, mat_column_major>& lhs, const Vec<4, f64>& v)
+{
+    __m256d o = _mm256_mul_pd(_mm256_loadu_pd(&lhs.m[0]), _mm256_broadcast_sd(&v.v[0]));
+    o = mat_madd(_mm256_loadu_pd(&lhs.m[4]), _mm256_broadcast_sd(&v.v[1]), o);
+    o = mat_madd(_mm256_loadu_pd(&lhs.m[8]), _mm256_broadcast_sd(&v.v[2]), o);
+    o = mat_madd(_mm256_loadu_pd(&lhs.m[12]), _mm256_broadcast_sd(&v.v[3]), o);
+    Vec<4, f64> result;
+    _mm256_storeu_pd(result.v, o);
+    return result;
+}
+#endif
+
+template <size_t R, size_t C, typename T, typename L>
+inline Mat<R, C, T, L> Mat<R, C, T, L>::multiply(const Mat<R, C, T, L>& rhs) const
+{
+    return mat_multiply(*this, rhs);
+}
+
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Mat<R, C, T, L> Mat<R, C, T, L>::multiply(T scalar) const
+{
+    Mat<R, C, T, L> result;
+    for (size_t i = 0; i < R * C; ++i)
+    {
+        result.m[i] = m[i] * scalar;
+    }
+
+    return result;
+}
+
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<C, T> Mat<R, C, T, L>::multiply(const Vec<C, T>& v) const
+{
+    return mat_multiply(*this, v);
+}
+
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<4, T> Mat<R, C, T, L>::transform_vector(const Vec<4, T>& v) const
+{
+    return mat_multiply(*this, v);
+}
+
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<3, T> Mat<R, C, T, L>::transform_vector(const Vec<3, T>& v, T& w) const
+{
+    Vec<4, T> result = mat_multiply(*this, Vec<4, T>(v, w));
+    w = result.w;
+    return result.xyz;
+}
+
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Vec<3, T> Mat<R, C, T, L>::transform_vector(const Vec<3, T>& v) const
+{
+    Vec<4, T> result = mat_multiply(*this, Vec<4, T>(v, (T)1));
     return result.xyz;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline void Mat<R, C, T>::transpose()
+template <size_t R, size_t C, typename T, typename L>
+maths_inline void Mat<R, C, T, L>::transpose()
 {
-    Mat<R, C, T> t = this->transposed();
+    Mat<R, C, T, L> t = this->transposed();
     *this          = t;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Mat<R, C, T> Mat<R, C, T>::transposed()
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Mat<R, C, T, L> Mat<R, C, T, L>::transposed()
 {
-    Mat<R, C, T> t;
+    Mat<R, C, T, L> t;
 
     for (size_t r = 0; r < R; ++r)
         for (size_t c = 0; c < C; ++c)
@@ -332,11 +615,11 @@ maths_inline Mat<R, C, T> Mat<R, C, T>::transposed()
     return t;
 }
 
-template <size_t R, size_t C, typename T>
-maths_inline Mat<R, C, T> Mat<R, C, T>::create_identity()
+template <size_t R, size_t C, typename T, typename L>
+maths_inline Mat<R, C, T, L> Mat<R, C, T, L>::create_identity()
 {
-    Mat<R, C, T> identity;
-    memset(&identity, 0x0, sizeof(Mat<R, C, T>));
+    Mat<R, C, T, L> identity;
+    memset(&identity, 0x0, sizeof(Mat<R, C, T, L>));
 
     for (size_t r = 0; r < R; ++r)
         for (size_t c = 0; c < C; ++c)
@@ -346,8 +629,8 @@ maths_inline Mat<R, C, T> Mat<R, C, T>::create_identity()
     return identity;
 }
 
-template <size_t R, size_t C, typename T>
-std::ostream& operator<<(std::ostream& out, const Mat<R, C, T>& m)
+template <size_t R, size_t C, typename T, typename L>
+std::ostream& operator<<(std::ostream& out, const Mat<R, C, T, L>& m)
 {
     out << m.m[0];
     for (size_t i = 1; i < R * C; ++i)
@@ -355,8 +638,8 @@ std::ostream& operator<<(std::ostream& out, const Mat<R, C, T>& m)
     return out;
 }
 
-template <size_t R, size_t C>
-std::ostream& operator<<(std::ostream& out, const Mat<R, C, float>& m)
+template <size_t R, size_t C, typename L>
+std::ostream& operator<<(std::ostream& out, const Mat<R, C, float, L>& m)
 {
     out << "(f32)" << m.m[0];
     for (size_t i = 1; i < R * C; ++i)
@@ -473,6 +756,38 @@ namespace mat
         return inverse;
     }
 
+    // inverse of an affine 3x4 matrix, the 3x3 part by its adjugate and the translation by -inverse * t
+    template <typename T>
+    Mat<3, 4, T> inverse3x4(const Mat<3, 4, T>& mat)
+    {
+        const T* m = &mat.m[0];
+
+        T det = (m[0] * (m[5] * m[10] - m[9] * m[6])) - (m[4] * (m[1] * m[10] - m[9] * m[2])) +
+                (m[8] * (m[1] * m[6] - m[5] * m[2]));
+
+        T one_over_det = (T)1 / det;
+
+        Mat<3, 4, T> inverse;
+        inverse.m[0] = (m[5] * m[10] - m[6] * m[9]) * one_over_det;
+        inverse.m[1] = -(m[1] * m[10] - m[2] * m[9]) * one_over_det;
+        inverse.m[2] = (m[1] * m[6] - m[2] * m[5]) * one_over_det;
+
+        inverse.m[4] = -(m[4] * m[10] - m[6] * m[8]) * one_over_det;
+        inverse.m[5] = (m[0] * m[10] - m[2] * m[8]) * one_over_det;
+        inverse.m[6] = -(m[0] * m[6] - m[2] * m[4]) * one_over_det;
+
+        inverse.m[8]  = (m[4] * m[9] - m[5] * m[8]) * one_over_det;
+        inverse.m[9]  = -(m[0] * m[9] - m[1] * m[8]) * one_over_det;
+        inverse.m[10] = (m[0] * m[5] - m[1] * m[4]) * one_over_det;
+
+        Vec<3, T> t(-m[3], -m[7], -m[11]);
+        inverse.m[3]  = t.x * inverse.m[0] + t.y * inverse.m[1] + t.z * inverse.m[2];
+        inverse.m[7]  = t.x * inverse.m[4] + t.y * inverse.m[5] + t.z * inverse.m[6];
+        inverse.m[11] = t.x * inverse.m[8] + t.y * inverse.m[9] + t.z * inverse.m[10];
+
+        return inverse;
+    }
+
     template <typename T>
     Mat<4, 4, T> inverse4x4(const Mat<4, 4, T>& mat)
     {
@@ -891,6 +1206,177 @@ namespace mat
         }
         return mm;
     }
+
+    // expands an affine 3x4 matrix to 4x4 with a bottom row of 0, 0, 0, 1
+    template <typename T>
+    Mat<4, 4, T> to4x4(const Mat<3, 4, T>& rhs)
+    {
+        Mat<4, 4, T> mm;
+        memcpy(&mm.m[0], &rhs.m[0], sizeof(T) * 12);
+        mm.m[12] = mm.m[13] = mm.m[14] = (T)0;
+        mm.m[15] = (T)1;
+        return mm;
+    }
+
+    // drops the bottom row of a 4x4 matrix, which is only lossless for affine transforms
+    template <typename T>
+    Mat<3, 4, T> to3x4(const Mat<4, 4, T>& rhs)
+    {
+        Mat<3, 4, T> mm;
+        memcpy(&mm.m[0], &rhs.m[0], sizeof(T) * 12);
+        return mm;
+    }
+
+    // transforms point p by an affine 3x4 matrix
+    template <typename T>
+    maths_inline Vec<3, T> transform_point(const Mat<3, 4, T>& mat, const Vec<3, T>& p)
+    {
+        const T* m = &mat.m[0];
+        return Vec<3, T>(m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3],
+                         m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+                         m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11]);
+    }
+
+    // transforms direction d by an affine 3x4 matrix, ignoring the translation
+    template <typename T>
+    maths_inline Vec<3, T> transform_direction(const Mat<3, 4, T>& mat, const Vec<3, T>& d)
+    {
+        const T* m = &mat.m[0];
+        return Vec<3, T>(m[0] * d.x + m[1] * d.y + m[2] * d.z,
+                         m[4] * d.x + m[5] * d.y + m[6] * d.z,
+                         m[8] * d.x + m[9] * d.y + m[10] * d.z);
+    }
+
+    // batch transforms for vec3f's which are count elements of stride bytes apart, such as positions inside
+    // interleaved vertices. src and dst may be the same. non_temporal writes dst with streaming stores which bypass the
+    // cache, for large packed output (dst_stride of 12) which is not read again soon, such as vertices for the gpu.
+    void transform_points(const Mat<4, 4, f32>& m, const void* src, size_t src_stride, void* dst, size_t dst_stride,
+                          size_t count, bool non_temporal = false);
+    void transform_directions(const Mat<4, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                              size_t dst_stride, size_t count, bool non_temporal = false);
+    void transform_normals(const Mat<4, 4, f32>& m, const void* src, size_t src_stride, void* dst, size_t dst_stride,
+                           size_t count, bool non_temporal = false);
+    void transform_points(const Mat<3, 4, f32>& m, const void* src, size_t src_stride, void* dst, size_t dst_stride,
+                          size_t count, bool non_temporal = false);
+    void transform_directions(const Mat<3, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                              size_t dst_stride, size_t count, bool non_temporal = false);
+    void transform_normals(const Mat<3, 4, f32>& m, const void* src, size_t src_stride, void* dst, size_t dst_stride,
+                           size_t count, bool non_temporal = false);
+
+    // transforms v by the columns of a 4x4 matrix, w is 1 for points and 0 for directions. with sse each vec3 is
+    // broadcast and multiplied by the matrix columns in registers, which keeps the loop memory bound.
+    template <bool W, bool Normalise>
+    inline void transform_strided(const Mat<4, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                                  size_t dst_stride, size_t count, bool non_temporal)
+    {
+        const unsigned char* s = (const unsigned char*)src;
+        unsigned char*       d = (unsigned char*)dst;
+#ifdef MATHS_SSE
+        // streaming stores only pay off when whole cache lines are written, with gaps between the vec3s the partially
+        // written lines are flushed to memory one at a time which is much slower than going through the cache
+        non_temporal = non_temporal && dst_stride == sizeof(f32) * 3;
+
+        __m128 c0 = _mm_setr_ps(m.m[0], m.m[4], m.m[8], m.m[12]);
+        __m128 c1 = _mm_setr_ps(m.m[1], m.m[5], m.m[9], m.m[13]);
+        __m128 c2 = _mm_setr_ps(m.m[2], m.m[6], m.m[10], m.m[14]);
+        __m128 c3 = _mm_setr_ps(m.m[3], m.m[7], m.m[11], m.m[15]);
+        for (size_t i = 0; i < count; ++i, s += src_stride, d += dst_stride)
+        {
+            const f32* v = (const f32*)s;
+#ifdef MATHS_FMA
+            __m128 r = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+            r = _mm_fmadd_ps(c1, _mm_set1_ps(v[1]), r);
+            r = _mm_fmadd_ps(c2, _mm_set1_ps(v[2]), r);
+#else
+            __m128 r = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+            r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+            r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+#endif
+            if (W)
+                r = _mm_add_ps(r, c3);
+
+            if (Normalise)
+                r = _mm_div_ps(r, _mm_sqrt_ps(_mm_dp_ps(r, r, 0x7f)));
+
+            f32* o = (f32*)d;
+            if (non_temporal)
+            {
+                _mm_stream_si32((int*)o, _mm_extract_ps(r, 0));
+                _mm_stream_si32((int*)o + 1, _mm_extract_ps(r, 1));
+                _mm_stream_si32((int*)o + 2, _mm_extract_ps(r, 2));
+            }
+            else
+            {
+                _mm_storel_pi((__m64*)o, r);
+                _mm_store_ss(o + 2, _mm_movehl_ps(r, r));
+            }
+        }
+
+        if (non_temporal)
+            _mm_sfence();
+#else
+        (void)non_temporal;
+        for (size_t i = 0; i < count; ++i, s += src_stride, d += dst_stride)
+        {
+            const f32* v = (const f32*)s;
+            f32 r[3];
+            for (size_t j = 0; j < 3; ++j)
+                r[j] = m.m[j * 4] * v[0] + m.m[j * 4 + 1] * v[1] + m.m[j * 4 + 2] * v[2] + (W ? m.m[j * 4 + 3] : 0.0f);
+
+            if (Normalise)
+            {
+                f32 inv = 1.0f / sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+                for (size_t j = 0; j < 3; ++j)
+                    r[j] *= inv;
+            }
+
+            f32* o = (f32*)d;
+            for (size_t j = 0; j < 3; ++j)
+                o[j] = r[j];
+        }
+#endif
+    }
+
+    // o = m * vec4(v, 1), perspective is not divided out, matching Mat::transform_vector
+    inline void transform_points(const Mat<4, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                                 size_t dst_stride, size_t count, bool non_temporal)
+    {
+        transform_strided<true, false>(m, src, src_stride, dst, dst_stride, count, non_temporal);
+    }
+
+    // o = m * vec4(v, 0), ignores the translation
+    inline void transform_directions(const Mat<4, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                                     size_t dst_stride, size_t count, bool non_temporal)
+    {
+        transform_strided<false, false>(m, src, src_stride, dst, dst_stride, count, non_temporal);
+    }
+
+    // transforms normals by the inverse transpose of the 3x3 part of m so they stay perpendicular to surfaces under
+    // non uniform scale, and renormalises them
+    inline void transform_normals(const Mat<4, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                                  size_t dst_stride, size_t count, bool non_temporal)
+    {
+        Mat<4, 4, f32> it = inverse3x3(m).transposed();
+        transform_strided<false, true>(it, src, src_stride, dst, dst_stride, count, non_temporal);
+    }
+
+    inline void transform_points(const Mat<3, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                                 size_t dst_stride, size_t count, bool non_temporal)
+    {
+        transform_points(to4x4(m), src, src_stride, dst, dst_stride, count, non_temporal);
+    }
+
+    inline void transform_directions(const Mat<3, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                                     size_t dst_stride, size_t count, bool non_temporal)
+    {
+        transform_directions(to4x4(m), src, src_stride, dst, dst_stride, count, non_temporal);
+    }
+
+    inline void transform_normals(const Mat<3, 4, f32>& m, const void* src, size_t src_stride, void* dst,
+                                  size_t dst_stride, size_t count, bool non_temporal)
+    {
+        transform_normals(to4x4(m), src, src_stride, dst, dst_stride, count, non_temporal);
+    }
 } // namespace mat
 
 typedef Mat<3, 3, f32> Mat3f;
@@ -899,11 +1385,17 @@ typedef Mat<3, 4, f32> Mat34f;
 typedef Mat<3, 3, f32> mat3;
 typedef Mat<4, 4, f32> mat4;
 typedef Mat<2, 2, f32> mat2;
+typedef Mat<3, 4, f32> mat34;
 typedef Mat<3, 3, f32> mat3f;
 typedef Mat<4, 4, f32> mat4f;
 typedef Mat<2, 2, f32> mat2f;
+typedef Mat<3, 4, f32> mat34f;
 typedef Mat<4, 4, f32> float4x4;
 typedef Mat<3, 4, f32> float3x4;
 typedef Mat<4, 3, f32> float4x3;
 typedef Mat<3, 3, f32> float3x3;
 typedef Mat<2, 2, f32> float2x2;
+typedef Mat<2, 2, f32, mat_column_major> mat2_cm;
+typedef Mat<3, 3, f32, mat_column_major> mat3_cm;
+typedef Mat<4, 4, f32, mat_column_major> mat4_cm;
+typedef Mat<3, 4, f32, mat_column_major> mat34_cm;
@@ -5,7 +5,9 @@
 #pragma once
 
 #include "mat.h"
+#include "parallel.h"
 #include "quat.h"
+#include "soa.h"
 #include "util.h"
 #include "vec.h"
 
@@ -33,6 +35,54 @@ namespace maths
         vec3f scale = vec3f::one();
     };
 
+    // view projection with its inverse precomputed, to unproject many points with the same matrix
+    struct prepared_view_projection
+    {
+        mat4 view_projection;
+        mat4 inverse;
+    };
+
+    // obb defined by mat, which transforms an aabb centred at 0 with extents -1 to 1, with its inverse precomputed
+    // to perform many queries against the same obb
+    struct prepared_obb
+    {
+        mat4 mat;
+        mat4 inverse;
+    };
+
+    // obbs in structure of arrays form for batch tests, each obb is a centre, 3 unit axes and the half extents along
+    // them. set converts from the mat4 convention where mat transforms an aabb centred at 0 with extents -1 to 1
+    struct soa_obb
+    {
+        soa3f centre;
+        soa3f axis[3];
+        soa3f extent;
+        
+        soa_obb()
+        {
+        }
+        
+        soa_obb(size_t n)
+        {
+            resize(n);
+        }
+        
+        void resize(size_t n)
+        {
+            centre.resize(n);
+            extent.resize(n);
+            for (size_t i = 0; i < 3; ++i)
+                axis[i].resize(n);
+        }
+        
+        size_t size() const
+        {
+            return centre.size();
+        }
+        
+        void set(size_t i, const mat4& mat);
+    };
+
     // a collection of tests and useful maths functions
     // see inline implementation below file for explanation of args and return values.
     // .. consider moving large functions into a cpp instead of keeping them inline, just leaving them inline here for
@@ -45,6 +95,8 @@ namespace maths
     void        get_frustum_planes_from_matrix(const mat4f& view_projection, vec4f* planes_out);
     void        get_frustum_corners_from_matrix(const mat4f& view_projection, vec3f* corners);
     transform   get_transform_from_matrix(const mat4& mat);
+    mat4        get_matrix_from_transform(const transform& t);
+    dual_quat   get_dual_quat_from_transform(const transform& t);
 
     // Angles
     f32   deg_to_rad(f32 degree_angle);
@@ -63,6 +115,11 @@ namespace maths
     vec3f project_to_sc(const vec3f& p, const mat4& view_projection, const vec2i& viewport);
     vec3f unproject_ndc(const vec3f& p, const mat4& view_projection);
     vec3f unproject_sc(const vec3f& p, const mat4& view_projection, const vec2i& viewport);
+    prepared_view_projection prepare_view_projection(const mat4& view_projection);
+    vec3f unproject_ndc(const vec3f& p, const prepared_view_projection& vp);
+    vec3f unproject_sc(const vec3f& p, const prepared_view_projection& vp, const vec2i& viewport);
+    void  unproject_ndc(const vec3f* p, vec3f* out, size_t count, const prepared_view_projection& vp);
+    void  unproject_sc(const vec3f* p, vec3f* out, size_t count, const prepared_view_projection& vp, const vec2i& viewport);
 
     // Overlaps
     u32  aabb_vs_plane(const vec3f& aabb_min, const vec3f& aabb_max, const vec3f& x0, const vec3f& xN);
@@ -72,13 +129,47 @@ namespace maths
     bool aabb_vs_aabb(const vec3f& min0, const vec3f& max0, const vec3f& min1, const vec3f& max1);
     bool aabb_vs_frustum(const vec3f& aabb_pos, const vec3f& aabb_extent, vec4f* planes);
     bool sphere_vs_frustum(const vec3f& pos, f32 radius, vec4f* planes);
-    // todo: obb vs obb
+    bool obb_vs_obb(const mat4& obb0, const mat4& obb1);
+
+    // Batch Overlaps
+    template<size_t W = 8>
+    void aabb_vs_frustum(const soa3f& aabb_pos, const soa3f& aabb_extent, const vec4f* planes, u32* visible);
+    template<size_t W = 8>
+    void sphere_vs_frustum(const soa4f& spheres, const vec4f* planes, u32* visible);
+    template<size_t W = 8>
+    void obb_vs_obb(const mat4& obb, const soa_obb& obbs, u32* overlap);
+
+    // Batch Matrix, W matrices per iteration
+    template<size_t W = 8>
+    void inverse4x4(const soa_mat4f& mats, soa_mat4f& inverses);
+    template<size_t W = 8>
+    void inverse_transpose3x3(const soa_mat4f& mats, soa_mat3f& normal_matrices);
+    template<size_t W = 8>
+    void inverse4x4(const soa_mat4f& mats, soa_mat4f& inverses, soa_mat3f& normal_matrices);
+
+    // Batch Quaternion, W quaternions per iteration, t per quaternion or one t for all
+    template<size_t W = 8>
+    void slerp(const soa_quatf& q0, const soa_quatf& q1, const f32* t, soa_quatf& out);
+    template<size_t W = 8>
+    void slerp(const soa_quatf& q0, const soa_quatf& q1, f32 t, soa_quatf& out);
+    template<size_t W = 8>
+    void nlerp(const soa_quatf& q0, const soa_quatf& q1, const f32* t, soa_quatf& out);
+    template<size_t W = 8>
+    void nlerp(const soa_quatf& q0, const soa_quatf& q1, f32 t, soa_quatf& out);
+
+    // Batch Transform, W translation, rotation and scale triples per iteration
+    template<size_t W = 8>
+    void compose_affine(const soa3f& translations, const soa_quatf& rotations, const soa3f& scales, mat34* out);
+    template<size_t W = 8>
+    void compose_affine(const soa3f& translations, const soa_quatf& rotations, const soa3f& scales, mat4* out);
 
     // Point Test
     template<size_t N, typename T>
     bool point_inside_aabb(const Vec<N, T>& min, const Vec<N, T>& max, const Vec<N, T>& p0);
     bool point_inside_sphere(const vec3f& s0, f32 r0, const vec3f& p0);
     bool point_inside_obb(const mat4& mat, const vec3f& p);
+    bool point_inside_obb(const prepared_obb& obb, const vec3f& p);
+    void point_inside_obb(const prepared_obb& obb, const vec3f* p, size_t count, u32* inside);
     bool point_inside_triangle(const vec3f& p, const vec3f& v1, const vec3f& v2, const vec3f& v3);
     bool point_inside_cone(const vec3f& p, const vec3f& cp, const vec3f& cv, f32 h, f32 r);
     bool point_inside_convex_hull(const vec2f& p, const std::vector<vec2f>& hull);
@@ -90,6 +181,8 @@ namespace maths
     template<size_t N, typename T>
     Vec<N, T> closest_point_on_line(const Vec<N, T>& l1, const Vec<N, T>& l2, const Vec<N, T>& p);
     vec3f     closest_point_on_obb(const mat4& mat, const vec3f& p);
+    vec3f     closest_point_on_obb(const prepared_obb& obb, const vec3f& p);
+    void      closest_point_on_obb(const prepared_obb& obb, const vec3f* p, vec3f* out, size_t count);
     vec3f     closest_point_on_sphere(const vec3f& s0, f32 r0, const vec3f& p0);
     vec3f     closest_point_on_ray(const vec3f& r0, const vec3f& rV, const vec3f& p);
     vec3f     closest_point_on_triangle(const vec3f& p, const vec3f& v1, const vec3f& v2, const vec3f& v3, f32& side);
@@ -108,15 +201,37 @@ namespace maths
     // Ray / Line
     vec3f ray_plane_intersect(const vec3f& r0, const vec3f& rV, const vec3f& x0, const vec3f& xN);
     bool  ray_triangle_intersect(const vec3f& r0, const vec3f& rv, const vec3f& t0, const vec3f& t1, const vec3f& t2, vec3f& ip);
+    bool  ray_vs_triangle(const vec3f& r0, const vec3f& rv, const vec3f& t0, const vec3f& t1, const vec3f& t2, f32& t);
     bool  line_vs_ray(const vec3f& l1, const vec3f& l2, const vec3f& r0, const vec3f& rV, vec3f& ip);
     bool  line_vs_line(const vec3f& l1, const vec3f& l2, const vec3f& s1, const vec3f& s2, vec3f& ip);
     bool  line_vs_poly(const vec2f& l1, const vec2f& l2, const std::vector<vec2f>& poly, std::vector<vec2f>& ips);
     bool  ray_vs_aabb(const vec3f& min, const vec3f& max, const vec3f& r1, const vec3f& rv, vec3f& ip);
+    bool  ray_vs_aabb(const vec3f& min, const vec3f& max, const vec3f& r1, const vec3f& inv_rv, f32 t_max, f32& t);
     bool  ray_vs_obb(const mat4& mat, const vec3f& r1, const vec3f& rv, vec3f& ip);
+    bool  ray_vs_obb(const prepared_obb& obb, const vec3f& r1, const vec3f& rv, vec3f& ip);
+    void  ray_vs_obb(const prepared_obb& obb, const vec3f* r1, const vec3f* rv, vec3f* ip, size_t count, u32* hit);
+
+    // Ray Packets, W rays per call returning a mask of the lanes which hit
+    template<size_t W>
+    Wide<W> ray_vs_aabb(const vec3f& min, const vec3f& max, const Vec<3, Wide<W>>& r1, const Vec<3, Wide<W>>& inv_rv,
+                        const Wide<W>& t_max, Wide<W>& t);
+    template<size_t W>
+    Wide<W> ray_vs_triangle(const Vec<3, Wide<W>>& r0, const Vec<3, Wide<W>>& rv, const vec3f& t0, const vec3f& t1,
+                            const vec3f& t2, Wide<W>& t);
+
+    // Prepared
+    prepared_obb prepare_obb(const mat4& mat);
     
     // Convex Hull
     void  convex_hull_from_points(std::vector<vec2f>& hull, const std::vector<vec2f>& p);
+    size_t convex_hull_from_points(vec2f* hull, const vec2f* points, size_t count, vec2f* scratch, u32 max_threads = 0);
     vec2f get_convex_hull_centre(const std::vector<vec2f>& hull);
+
+    // Space Filling Curves, points quantised against an aabb, 10 bits per axis for u32 codes and 21 for u64
+    void morton_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max, u32* codes);
+    void morton_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max, u64* codes);
+    void hilbert_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max, u32* codes);
+    void hilbert_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max, u64* codes);
     
     //
     // Implementation
@@ -278,20 +393,57 @@ namespace maths
     // unproject normalised device coordinate p wih viewport using inverse view_projection
     inline vec3f unproject_ndc(const vec3f& p, const mat4& view_projection)
     {
-        mat4 inv = mat::inverse4x4(view_projection);
-        
-        vec4f ppc = inv.transform_vector(vec4f(p, 1.0f));
-        
-        return ppc.xyz / ppc.w;
+        return unproject_ndc(p, prepare_view_projection(view_projection));
     }
     
     // unproject screen coordinate p wih viewport using inverse view_projection
     inline vec3f unproject_sc(const vec3f& p, const mat4& view_projection, const vec2i& viewport)
+    {
+        return unproject_sc(p, prepare_view_projection(view_projection), viewport);
+    }
+
+    // computes the inverse of view_projection once so it can be reused by unproject_ndc / unproject_sc
+    inline prepared_view_projection prepare_view_projection(const mat4& view_projection)
+    {
+        prepared_view_projection vp;
+        vp.view_projection = view_projection;
+        vp.inverse = mat::inverse4x4(view_projection);
+        return vp;
+    }
+
+    // unproject normalised device coordinate p using the precomputed inverse view projection
+    inline vec3f unproject_ndc(const vec3f& p, const prepared_view_projection& vp)
+    {
+        vec4f ppc = vp.inverse.transform_vector(vec4f(p, 1.0f));
+        
+        return ppc.xyz / ppc.w;
+    }
+
+    // unproject screen coordinate p wih viewport using the precomputed inverse view projection
+    inline vec3f unproject_sc(const vec3f& p, const prepared_view_projection& vp, const vec2i& viewport)
     {
         vec2f ndc_xy = (p.xy / (vec2f)viewport) * vec2f(2.0) - vec2f(1.0);
         vec3f ndc    = vec3f(ndc_xy, p.z);
         
-        return unproject_ndc(ndc, view_projection);
+        return unproject_ndc(ndc, vp);
+    }
+
+    // unproject count normalised device coordinates from p into out
+    inline void unproject_ndc(const vec3f* p, vec3f* out, size_t count, const prepared_view_projection& vp)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = unproject_ndc(p[i], vp);
+    }
+
+    // unproject count screen coordinates from p into out
+    inline void unproject_sc(const vec3f* p, vec3f* out, size_t count, const prepared_view_projection& vp, const vec2i& viewport)
+    {
+        vec2f inv_viewport = vec2f(2.0f) / (vec2f)viewport;
+        for (size_t i = 0; i < count; ++i)
+        {
+            vec2f ndc_xy = p[i].xy * inv_viewport - vec2f(1.0);
+            out[i] = unproject_ndc(vec3f(ndc_xy, p[i].z), vp);
+        }
     }
     
     // convert azimuth / altitude to vec3f xyz
@@ -346,6 +498,34 @@ namespace maths
             ip = p;
         return hit;
     }
+
+    // returns true if the ray (origin r0, direction rv) intersects the triangle (t0,t1,t2) from either side using the
+    // moller-trumbore test, t is set to the distance along rv so the intersection point is r0 + rv * t
+    inline bool ray_vs_triangle(const vec3f& r0, const vec3f& rv, const vec3f& t0, const vec3f& t1, const vec3f& t2, f32& t)
+    {
+        vec3f e1 = t1 - t0;
+        vec3f e2 = t2 - t0;
+        vec3f pv = cross(rv, e2);
+        f32   det = dot(e1, pv);
+        
+        // ray is parallel to the triangle
+        if (det == 0.0f)
+            return false;
+        
+        f32   inv_det = 1.0f / det;
+        vec3f tv = r0 - t0;
+        f32   u = dot(tv, pv) * inv_det;
+        if (u < 0.0f || u > 1.0f)
+            return false;
+        
+        vec3f qv = cross(tv, e1);
+        f32   v = dot(rv, qv) * inv_det;
+        if (v < 0.0f || u + v > 1.0f)
+            return false;
+        
+        t = dot(e2, qv) * inv_det;
+        return t >= 0.0f;
+    }
     
     // returns the classification of an aabb vs a plane aabb defined by min and max
     // plane defined by point on plane x0 and normal of plane xN
@@ -436,7 +616,7 @@ namespace maths
     // returns true if an aabb defined by aabb_pos (centre) and aabb_extent (half extent) is inside or intersecting the frustum
     // defined by 6 planes (xyz = plane normal, w = plane constant / distance from origin)
     // implemented via info detailed in this insightful blog post: https://fgiesen.wordpress.com/2010/10/17/view-frustum-culling
-    // sse/avx simd optimised variations can be found here: https://github.com/polymonster/pmtech/blob/master/core/put/source/ecs/ecs_cull.cpp
+    // to cull many aabbs at once use the batch aabb_vs_frustum overload taking soa3f arrays, which tests W per iteration
     inline bool aabb_vs_frustum(const vec3f& aabb_pos, const vec3f&  aabb_extent, vec4f* planes)
     {
         bool inside = true;
@@ -456,7 +636,7 @@ namespace maths
     
     // returns true if the sphere defined by pos and radius is inside or intersecting frustum
     // definined by 6 planes (xyz = plane normal, w = plane constant / distance)
-    // sse/avx simd optimised variations can be found here: https://github.com/polymonster/pmtech/blob/master/core/put/source/ecs/ecs_cull.cpp
+    // to cull many spheres at once use the batch sphere_vs_frustum overload taking a soa4f array, which tests W per iteration
     inline bool sphere_vs_frustum(const vec3f& pos, f32 radius, vec4f* planes)
     {
         for (size_t p = 0; p < 6; ++p)
@@ -470,6 +650,540 @@ namespace maths
         return true;
     }
 
+    // batch version of aabb_vs_frustum, aabb_pos (centre) and aabb_extent (half extent) are soa arrays and W aabbs are
+    // tested per iteration. writes a packed bitmask where bit (i % 32) of visible[i / 32] is set if aabb i is inside
+    // or intersecting the frustum, visible must have space for (size + 31) / 32 elements.
+    template<size_t W>
+    inline void aabb_vs_frustum(const soa3f& aabb_pos, const soa3f& aabb_extent, const vec4f* planes, u32* visible)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+        
+        // plane normals, abs normals and constants splatted once for all batches
+        Vec<3, Wide<W>> n[6], an[6];
+        Wide<W>         w[6];
+        for (size_t p = 0; p < 6; ++p)
+        {
+            vec3f pn = planes[p].xyz;
+            n[p] = splat<W>(pn);
+            an[p] = splat<W>(vec3f(std::fabs(pn.x), std::fabs(pn.y), std::fabs(pn.z)));
+            w[p] = planes[p].w;
+        }
+        
+        size_t count = aabb_pos.size();
+        for (size_t i = 0; i < count; i += W)
+        {
+            Vec<3, Wide<W>> pos = aabb_pos.load<W>(i);
+            Vec<3, Wide<W>> ext = aabb_extent.load<W>(i);
+            
+            Wide<W> outside = 0.0f;
+            for (size_t p = 0; p < 6; ++p)
+                outside = outside | (dot(pos, n[p]) + w[p] > dot(ext, an[p]));
+            
+            size_t lanes = std::min(count - i, W);
+            u32    bits = ~movemask(outside) & (u32)((1ull << lanes) - 1);
+            
+            if (i % 32 == 0)
+                visible[i / 32] = 0;
+            visible[i / 32] |= bits << (i % 32);
+        }
+    }
+
+    // batch version of sphere_vs_frustum, spheres xyz = centre, w = radius. writes a packed bitmask where bit (i % 32)
+    // of visible[i / 32] is set if sphere i is inside or intersecting the frustum, see aabb_vs_frustum.
+    template<size_t W>
+    inline void sphere_vs_frustum(const soa4f& spheres, const vec4f* planes, u32* visible)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+        
+        Vec<3, Wide<W>> n[6];
+        Wide<W>         w[6];
+        for (size_t p = 0; p < 6; ++p)
+        {
+            n[p] = splat<W>(vec3f(planes[p].xyz));
+            w[p] = planes[p].w;
+        }
+        
+        size_t count = spheres.size();
+        for (size_t i = 0; i < count; i += W)
+        {
+            Vec<4, Wide<W>> s = spheres.load<W>(i);
+            
+            Wide<W> outside = 0.0f;
+            for (size_t p = 0; p < 6; ++p)
+                outside = outside | (fmadd(s.x, n[p].x, fmadd(s.y, n[p].y, fmadd(s.z, n[p].z, w[p]))) > s.w);
+            
+            size_t lanes = std::min(count - i, W);
+            u32    bits = ~movemask(outside) & (u32)((1ull << lanes) - 1);
+            
+            if (i % 32 == 0)
+                visible[i / 32] = 0;
+            visible[i / 32] |= bits << (i % 32);
+        }
+    }
+
+    // splits obb mat into its centre, unit axes and half extents along the axes
+    inline void get_obb_axes(const mat4& mat, vec3f& centre, vec3f* axis, vec3f& extent)
+    {
+        centre = mat.get_translation();
+        for (size_t i = 0; i < 3; ++i)
+        {
+            axis[i] = mat.get_column(i).xyz;
+            extent[i] = mag(axis[i]);
+            axis[i] /= extent[i];
+        }
+    }
+    
+    inline void soa_obb::set(size_t i, const mat4& mat)
+    {
+        vec3f c, a[3], e;
+        get_obb_axes(mat, c, a, e);
+        centre.set(i, c);
+        extent.set(i, e);
+        for (size_t j = 0; j < 3; ++j)
+            axis[j].set(i, a[j]);
+    }
+    
+    // separating axis test between obbs a and b with half extents ea and eb, r[i][j] = dot(a.axis[i], b.axis[j]) and
+    // t is the vector from a's centre to b's centre in a's frame. tests the 3 face normals of each obb and the 9 cross
+    // products of their edges, T is f32 or Wide<W> so returns true or a mask of lanes where the obbs are separated.
+    // see: real-time collision detection, christer ericson 4.4.1
+    template<typename T>
+    inline auto obb_separated(const T* ea, const T* eb, const T (&r)[3][3], const T* t) -> decltype(T() > T())
+    {
+        // epsilon guards against cross products of near parallel edges being used as an axis
+        T ar[3][3];
+        for (size_t i = 0; i < 3; ++i)
+            for (size_t j = 0; j < 3; ++j)
+                ar[i][j] = fabs(r[i][j]) + T(1e-6f);
+        
+        decltype(T() > T()) sep = T(0.0f) > T(0.0f);
+        
+        // axes of a
+        for (size_t i = 0; i < 3; ++i)
+            sep = sep | (fabs(t[i]) > ea[i] + eb[0] * ar[i][0] + eb[1] * ar[i][1] + eb[2] * ar[i][2]);
+        
+        // axes of b
+        for (size_t j = 0; j < 3; ++j)
+        {
+            T ra = ea[0] * ar[0][j] + ea[1] * ar[1][j] + ea[2] * ar[2][j];
+            sep = sep | (fabs(t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j]) > ra + eb[j]);
+        }
+        
+        // a.axis[i] x b.axis[j]
+        for (size_t i = 0; i < 3; ++i)
+        {
+            size_t i1 = (i + 1) % 3;
+            size_t i2 = (i + 2) % 3;
+            for (size_t j = 0; j < 3; ++j)
+            {
+                size_t j1 = (j + 1) % 3;
+                size_t j2 = (j + 2) % 3;
+                T      ra = ea[i1] * ar[i2][j] + ea[i2] * ar[i1][j];
+                T      rb = eb[j1] * ar[i][j2] + eb[j2] * ar[i][j1];
+                sep = sep | (fabs(t[i2] * r[i1][j] - t[i1] * r[i2][j]) > ra + rb);
+            }
+        }
+        
+        return sep;
+    }
+    
+    // returns true if the obbs overlap, each mat transforms an aabb centred at 0 with extents -1 to 1 into an obb and
+    // should only contain rotation, scale and translation
+    inline bool obb_vs_obb(const mat4& obb0, const mat4& obb1)
+    {
+        vec3f ca, a[3], ea;
+        vec3f cb, b[3], eb;
+        get_obb_axes(obb0, ca, a, ea);
+        get_obb_axes(obb1, cb, b, eb);
+        
+        f32 r[3][3];
+        f32 t[3];
+        vec3f tw = cb - ca;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            t[i] = dot(tw, a[i]);
+            for (size_t j = 0; j < 3; ++j)
+                r[i][j] = dot(a[i], b[j]);
+        }
+        
+        return !obb_separated(ea.v, eb.v, r, t);
+    }
+    
+    // batch version of obb_vs_obb testing obb against W obbs per iteration. writes a packed bitmask where bit (i % 32)
+    // of overlap[i / 32] is set if obbs[i] overlaps obb, overlap must have space for (obbs.size() + 31) / 32 elements.
+    template<size_t W>
+    inline void obb_vs_obb(const mat4& obb, const soa_obb& obbs, u32* overlap)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+        
+        vec3f ca, a[3], ea;
+        get_obb_axes(obb, ca, a, ea);
+        
+        Wide<W> wea[3];
+        for (size_t i = 0; i < 3; ++i)
+            wea[i] = ea[i];
+        
+        size_t count = obbs.size();
+        for (size_t i = 0; i < count; i += W)
+        {
+            Vec<3, Wide<W>> tw = obbs.centre.load<W>(i) - splat<W>(ca);
+            Vec<3, Wide<W>> eb = obbs.extent.load<W>(i);
+            
+            Wide<W> r[3][3];
+            Wide<W> t[3];
+            for (size_t j = 0; j < 3; ++j)
+            {
+                Vec<3, Wide<W>> b = obbs.axis[j].load<W>(i);
+                for (size_t k = 0; k < 3; ++k)
+                    r[k][j] = fmadd(b.x, a[k].x, fmadd(b.y, a[k].y, b.z * a[k].z));
+            }
+            
+            for (size_t k = 0; k < 3; ++k)
+                t[k] = fmadd(tw.x, a[k].x, fmadd(tw.y, a[k].y, tw.z * a[k].z));
+            
+            Wide<W> separated = obb_separated(wea, eb.v, r, t);
+            
+            size_t lanes = std::min(count - i, W);
+            u32    bits = ~movemask(separated) & (u32)((1ull << lanes) - 1);
+            
+            if (i % 32 == 0)
+                overlap[i / 32] = 0;
+            overlap[i / 32] |= bits << (i % 32);
+        }
+    }
+
+    // inverse of the 4x4 matrix m, 16 elements row major, by 2x2 sub determinants. T is f32 or Wide<W> so this
+    // inverts one matrix or one per lane. singular matrices produce inf or nan.
+    template <typename T>
+    maths_inline void inverse4x4(const T* m, T* inv)
+    {
+        T s0 = m[0] * m[5] - m[4] * m[1];
+        T s1 = m[0] * m[6] - m[4] * m[2];
+        T s2 = m[0] * m[7] - m[4] * m[3];
+        T s3 = m[1] * m[6] - m[5] * m[2];
+        T s4 = m[1] * m[7] - m[5] * m[3];
+        T s5 = m[2] * m[7] - m[6] * m[3];
+
+        T c5 = m[10] * m[15] - m[14] * m[11];
+        T c4 = m[9] * m[15] - m[13] * m[11];
+        T c3 = m[9] * m[14] - m[13] * m[10];
+        T c2 = m[8] * m[15] - m[12] * m[11];
+        T c1 = m[8] * m[14] - m[12] * m[10];
+        T c0 = m[8] * m[13] - m[12] * m[9];
+
+        T inv_det = T(1.0f) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+        inv[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * inv_det;
+        inv[1] = (m[2] * c4 - m[1] * c5 - m[3] * c3) * inv_det;
+        inv[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * inv_det;
+        inv[3] = (m[10] * s4 - m[9] * s5 - m[11] * s3) * inv_det;
+
+        inv[4] = (m[6] * c2 - m[4] * c5 - m[7] * c1) * inv_det;
+        inv[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * inv_det;
+        inv[6] = (m[14] * s2 - m[12] * s5 - m[15] * s1) * inv_det;
+        inv[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * inv_det;
+
+        inv[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * inv_det;
+        inv[9] = (m[1] * c2 - m[0] * c4 - m[3] * c0) * inv_det;
+        inv[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * inv_det;
+        inv[11] = (m[9] * s2 - m[8] * s4 - m[11] * s0) * inv_det;
+
+        inv[12] = (m[5] * c1 - m[4] * c3 - m[6] * c0) * inv_det;
+        inv[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * inv_det;
+        inv[14] = (m[13] * s1 - m[12] * s3 - m[14] * s0) * inv_det;
+        inv[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * inv_det;
+    }
+
+    // inverse transpose of the upper 3x3 of the 4x4 matrix m, for transforming normals. that is the cofactor matrix
+    // over the determinant, the rows of which are cross products of the rows of m.
+    template <typename T>
+    maths_inline void inverse_transpose3x3(const T* m, T* it)
+    {
+        Vec<3, T> r0(m[0], m[1], m[2]);
+        Vec<3, T> r1(m[4], m[5], m[6]);
+        Vec<3, T> r2(m[8], m[9], m[10]);
+
+        Vec<3, T> c0 = cross(r1, r2);
+        Vec<3, T> c1 = cross(r2, r0);
+        Vec<3, T> c2 = cross(r0, r1);
+        T inv_det = T(1.0f) / dot(r0, c0);
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            it[i] = c0[i] * inv_det;
+            it[3 + i] = c1[i] * inv_det;
+            it[6 + i] = c2[i] * inv_det;
+        }
+    }
+
+    // loads W matrices per iteration from soa components, calls f(in, out) with the lanes and stores N out components
+    template <size_t W, size_t N, typename F>
+    inline void soa_matrix_batch(const soa_mat4f& mats, Soa<N>& out, F f)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+
+        out.resize(mats.size());
+        for (size_t i = 0; i < mats.size(); i += W)
+        {
+            Wide<W> m[16];
+            Wide<W> o[N];
+            for (size_t j = 0; j < 16; ++j)
+                m[j] = Wide<W>::load(mats.component(j) + i);
+
+            f(m, o);
+
+            for (size_t j = 0; j < N; ++j)
+                o[j].store(out.component(j) + i);
+        }
+    }
+
+    // batch version of mat::inverse4x4, inverts W matrices per iteration with one matrix in each lane
+    template <size_t W>
+    inline void inverse4x4(const soa_mat4f& mats, soa_mat4f& inverses)
+    {
+        soa_matrix_batch<W>(mats, inverses, [](const Wide<W>* m, Wide<W>* o) {
+            inverse4x4(m, o);
+        });
+    }
+
+    // writes the 3x3 normal matrix of each matrix in mats, the inverse transpose of its upper 3x3
+    template <size_t W>
+    inline void inverse_transpose3x3(const soa_mat4f& mats, soa_mat3f& normal_matrices)
+    {
+        soa_matrix_batch<W>(mats, normal_matrices, [](const Wide<W>* m, Wide<W>* o) {
+            inverse_transpose3x3(m, o);
+        });
+    }
+
+    // fused inverse and normal matrix, both from a single read of mats
+    template <size_t W>
+    inline void inverse4x4(const soa_mat4f& mats, soa_mat4f& inverses, soa_mat3f& normal_matrices)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+
+        inverses.resize(mats.size());
+        normal_matrices.resize(mats.size());
+        for (size_t i = 0; i < mats.size(); i += W)
+        {
+            Wide<W> m[16];
+            Wide<W> inv[16];
+            Wide<W> it[9];
+            for (size_t j = 0; j < 16; ++j)
+                m[j] = Wide<W>::load(mats.component(j) + i);
+
+            inverse4x4(m, inv);
+            inverse_transpose3x3(m, it);
+
+            for (size_t j = 0; j < 16; ++j)
+                inv[j].store(inverses.component(j) + i);
+            for (size_t j = 0; j < 9; ++j)
+                it[j].store(normal_matrices.component(j) + i);
+        }
+    }
+
+    // acos for x in [0, 1] by abramowitz and stegun 4.4.46, sqrt(1 - x) times a degree 7 polynomial with an error
+    // below 2e-8. T is f32 or Wide<W>.
+    template <typename T>
+    maths_inline T approx_acos(const T& x)
+    {
+        T p = fmadd(x, T(-0.0012624911f), T(0.0066700901f));
+        p = fmadd(p, x, T(-0.0170881256f));
+        p = fmadd(p, x, T(0.0308918810f));
+        p = fmadd(p, x, T(-0.0501743046f));
+        p = fmadd(p, x, T(0.0889789874f));
+        p = fmadd(p, x, T(-0.2145988016f));
+        p = fmadd(p, x, T(1.5707963050f));
+        return p * sqrt(T(1.0f) - x);
+    }
+
+    // sin for x in [-pi / 2, pi / 2], taylor series to x^11 with an error below 6e-8
+    template <typename T>
+    maths_inline T approx_sin(const T& x)
+    {
+        T x2 = x * x;
+        T p = fmadd(x2, T(-1.0f / 39916800.0f), T(1.0f / 362880.0f));
+        p = fmadd(p, x2, T(-1.0f / 5040.0f));
+        p = fmadd(p, x2, T(1.0f / 120.0f));
+        p = fmadd(p, x2, T(-1.0f / 6.0f));
+        p = fmadd(p, x2, T(1.0f));
+        return p * x;
+    }
+
+    // slerp of W quaternion pairs, one per lane, along the shorter arc. dot(q0, q1) is made positive so theta is in
+    // [0, pi / 2] where approx_acos and approx_sin hold, and sin(theta) is sqrt((1 - d) * (1 + d)) rather than a
+    // third sin, which avoids the cancellation of 1 - d^2 for close quaternions. identical lanes fall back to lerp
+    // weights. the result is within 1e-6 per component of slerp.
+    template <size_t W>
+    maths_inline Vec<4, Wide<W>> slerp(const Vec<4, Wide<W>>& q0, const Vec<4, Wide<W>>& q1, const Wide<W>& t)
+    {
+        Wide<W> d = dot(q0, q1);
+        Wide<W> sign = d & Wide<W>(-0.0f);
+        d = min(d ^ sign, Wide<W>(1.0f));
+
+        Wide<W> theta = approx_acos(d);
+        Wide<W> inv_sin = Wide<W>(1.0f) / sqrt((Wide<W>(1.0f) - d) * (Wide<W>(1.0f) + d));
+        Wide<W> t0 = Wide<W>(1.0f) - t;
+        Wide<W> identical = d >= Wide<W>(1.0f);
+        Wide<W> w0 = select(identical, t0, approx_sin(t0 * theta) * inv_sin);
+        Wide<W> w1 = select(identical, t, approx_sin(t * theta) * inv_sin) ^ sign;
+
+        Vec<4, Wide<W>> r;
+        for (size_t i = 0; i < 4; ++i)
+            r[i] = fmadd(q1[i], w1, q0[i] * w0);
+        return r;
+    }
+
+    // normalised lerp of W quaternion pairs along the shorter arc, cheaper than slerp though the angular velocity is
+    // not constant over t
+    template <size_t W>
+    maths_inline Vec<4, Wide<W>> nlerp(const Vec<4, Wide<W>>& q0, const Vec<4, Wide<W>>& q1, const Wide<W>& t)
+    {
+        Wide<W> sign = dot(q0, q1) & Wide<W>(-0.0f);
+        Wide<W> w0 = Wide<W>(1.0f) - t;
+        Wide<W> w1 = t ^ sign;
+
+        Vec<4, Wide<W>> r;
+        for (size_t i = 0; i < 4; ++i)
+            r[i] = fmadd(q1[i], w1, q0[i] * w0);
+
+        Wide<W> inv_len = Wide<W>(1.0f) / sqrt(dot(r, r));
+        for (size_t i = 0; i < 4; ++i)
+            r[i] *= inv_len;
+        return r;
+    }
+
+    // affine 3x4 matrix of translation t, rotation q and scale s for W lanes, m = T * R * S written row major to
+    // m[r * 4 + c] as in mat34. q is expected to be normalised.
+    template <size_t W>
+    maths_inline void compose_affine(const Vec<3, Wide<W>>& t, const Vec<4, Wide<W>>& q, const Vec<3, Wide<W>>& s,
+                                     Wide<W>* m)
+    {
+        Wide<W> x2 = q.x + q.x;
+        Wide<W> y2 = q.y + q.y;
+        Wide<W> z2 = q.z + q.z;
+        Wide<W> xx = q.x * x2;
+        Wide<W> yy = q.y * y2;
+        Wide<W> zz = q.z * z2;
+        Wide<W> xy = q.x * y2;
+        Wide<W> xz = q.x * z2;
+        Wide<W> yz = q.y * z2;
+        Wide<W> wx = q.w * x2;
+        Wide<W> wy = q.w * y2;
+        Wide<W> wz = q.w * z2;
+        Wide<W> one = 1.0f;
+
+        m[0] = (one - (yy + zz)) * s.x;
+        m[1] = (xy - wz) * s.y;
+        m[2] = (xz + wy) * s.z;
+        m[3] = t.x;
+        m[4] = (xy + wz) * s.x;
+        m[5] = (one - (xx + zz)) * s.y;
+        m[6] = (yz - wx) * s.z;
+        m[7] = t.y;
+        m[8] = (xz - wy) * s.x;
+        m[9] = (yz + wx) * s.y;
+        m[10] = (one - (xx + yy)) * s.z;
+        m[11] = t.z;
+    }
+
+    // runs f(q0, q1, t) over W quaternions per iteration, t is per quaternion when not null or uniform_t for all
+    template <size_t W, typename F>
+    inline void quat_batch(const soa_quatf& q0, const soa_quatf& q1, const f32* t, f32 uniform_t, soa_quatf& out, F f)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+
+        size_t n = q0.size();
+        out.resize(n);
+        for (size_t i = 0; i < n; i += W)
+        {
+            Wide<W> wt = uniform_t;
+            if (t && i + W <= n)
+            {
+                wt = Wide<W>::load(t + i);
+            }
+            else if (t)
+            {
+                // t is not padded like soa components
+                f32 tail[W] = {};
+                for (size_t j = 0; i + j < n; ++j)
+                    tail[j] = t[i + j];
+                wt = Wide<W>::load(tail);
+            }
+
+            out.store(i, f(q0.load<W>(i), q1.load<W>(i), wt));
+        }
+    }
+
+    template <size_t W>
+    inline void slerp(const soa_quatf& q0, const soa_quatf& q1, const f32* t, soa_quatf& out)
+    {
+        quat_batch<W>(q0, q1, t, 0.0f, out, [](const Vec<4, Wide<W>>& a, const Vec<4, Wide<W>>& b, const Wide<W>& wt) {
+            return slerp(a, b, wt);
+        });
+    }
+
+    template <size_t W>
+    inline void slerp(const soa_quatf& q0, const soa_quatf& q1, f32 t, soa_quatf& out)
+    {
+        quat_batch<W>(q0, q1, nullptr, t, out, [](const Vec<4, Wide<W>>& a, const Vec<4, Wide<W>>& b, const Wide<W>& wt) {
+            return slerp(a, b, wt);
+        });
+    }
+
+    template <size_t W>
+    inline void nlerp(const soa_quatf& q0, const soa_quatf& q1, const f32* t, soa_quatf& out)
+    {
+        quat_batch<W>(q0, q1, t, 0.0f, out, [](const Vec<4, Wide<W>>& a, const Vec<4, Wide<W>>& b, const Wide<W>& wt) {
+            return nlerp(a, b, wt);
+        });
+    }
+
+    template <size_t W>
+    inline void nlerp(const soa_quatf& q0, const soa_quatf& q1, f32 t, soa_quatf& out)
+    {
+        quat_batch<W>(q0, q1, nullptr, t, out, [](const Vec<4, Wide<W>>& a, const Vec<4, Wide<W>>& b, const Wide<W>& wt) {
+            return nlerp(a, b, wt);
+        });
+    }
+
+    // composes W transforms per iteration with compose_affine and writes each as a row major matrix of R rows,
+    // transposing lanes to rows as they are stored. the 4th row of a 4x4 is 0, 0, 0, 1.
+    template <size_t W, size_t R>
+    inline void compose_affine_batch(const soa3f& translations, const soa_quatf& rotations, const soa3f& scales,
+                                     f32* out)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+
+        const size_t stride = R * 4;
+        Wide<W>      m[16];
+        m[12] = m[13] = m[14] = 0.0f;
+        m[15] = 1.0f;
+
+        size_t n = translations.size();
+        for (size_t i = 0; i < n; i += W)
+        {
+            compose_affine(translations.load<W>(i), rotations.load<W>(i), scales.load<W>(i), m);
+
+            size_t lanes = std::min(W, n - i);
+            for (size_t r = 0; r < R; ++r)
+                store_transposed4(m + r * 4, out + i * stride + r * 4, stride, lanes);
+        }
+    }
+
+    // affine matrix T * R * S of each translation, rotation and scale, straight from the soa arrays with no
+    // intermediate matrices. rotations are expected to be normalised, all three arrays must be the same size.
+    template <size_t W>
+    inline void compose_affine(const soa3f& translations, const soa_quatf& rotations, const soa3f& scales, mat34* out)
+    {
+        compose_affine_batch<W, 3>(translations, rotations, scales, out[0].m);
+    }
+
+    template <size_t W>
+    inline void compose_affine(const soa3f& translations, const soa_quatf& rotations, const soa3f& scales, mat4* out)
+    {
+        compose_affine_batch<W, 4>(translations, rotations, scales, out[0].m);
+    }
+
     // returns true if sphere with centre s0 and radius r0 contains point p0
     inline bool point_inside_sphere(const vec3f& s0, f32 r0, const vec3f& p0)
     {
@@ -785,11 +1499,12 @@ namespace maths
             vec2f(1.0f, 0.0f),
         };
         static vec2i vpi = vec2i(1, 1);
+        prepared_view_projection vp = prepare_view_projection(view_projection);
         vec3f corners[2][4];
         for (size_t i = 0; i < 4; ++i)
         {
-            corners[0][i] = maths::unproject_sc(vec3f(ndc_coords[i], 0.0f), view_projection, vpi);
-            corners[1][i] = maths::unproject_sc(vec3f(ndc_coords[i], 1.0f), view_projection, vpi);
+            corners[0][i] = maths::unproject_sc(vec3f(ndc_coords[i], 0.0f), vp, vpi);
+            corners[1][i] = maths::unproject_sc(vec3f(ndc_coords[i], 1.0f), vp, vpi);
         }
 
         // construct vectors to obtain normals
@@ -825,10 +1540,11 @@ namespace maths
             vec2f(1.0f, 0.0f),
         };
         static vec2i vpi = vec2i(1, 1);
+        prepared_view_projection vp = prepare_view_projection(view_projection);
         for (size_t i = 0; i < 4; ++i)
         {
-            corners[i] = maths::unproject_sc(vec3f(ndc_coords[i], 0.0f), view_projection, vpi);
-            corners[i+4] = maths::unproject_sc(vec3f(ndc_coords[i], 1.0f), view_projection, vpi);
+            corners[i] = maths::unproject_sc(vec3f(ndc_coords[i], 0.0f), vp, vpi);
+            corners[i+4] = maths::unproject_sc(vec3f(ndc_coords[i], 1.0f), vp, vpi);
         }
     }
 
@@ -844,6 +1560,36 @@ namespace maths
         return t;
     }
 
+    // returns the 4x4 matrix T * R * S of a transform in one pass, t.rotation is expected to be normalised
+    inline mat4 get_matrix_from_transform(const transform& t)
+    {
+        const quat&  q = t.rotation;
+        const vec3f& s = t.scale;
+        f32 x2 = q.x + q.x;
+        f32 y2 = q.y + q.y;
+        f32 z2 = q.z + q.z;
+        f32 xx = q.x * x2;
+        f32 yy = q.y * y2;
+        f32 zz = q.z * z2;
+        f32 xy = q.x * y2;
+        f32 xz = q.x * z2;
+        f32 yz = q.y * z2;
+        f32 wx = q.w * x2;
+        f32 wy = q.w * y2;
+        f32 wz = q.w * z2;
+
+        return mat4((1.0f - (yy + zz)) * s.x, (xy - wz) * s.y, (xz + wy) * s.z, t.translation.x,
+                    (xy + wz) * s.x, (1.0f - (xx + zz)) * s.y, (yz - wx) * s.z, t.translation.y,
+                    (xz - wy) * s.x, (yz + wx) * s.y, (1.0f - (xx + yy)) * s.z, t.translation.z,
+                    0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    // returns the rotation and translation of a transform as a dual quaternion, scale is dropped
+    inline dual_quat get_dual_quat_from_transform(const transform& t)
+    {
+        return dual_quat(t.rotation, t.translation);
+    }
+
     // returns true if ray with origin r1 and direction rv intersects the aabb defined by emin and emax
     // Intersection point is stored in ip
     inline bool ray_vs_aabb(const vec3f& emin, const vec3f& emax, const vec3f& r1, const vec3f& rv, vec3f& ip)
@@ -875,94 +1621,308 @@ namespace maths
         return true;
     }
     
-    // returns true if there is an intersection bewteen ray with origin r1 and direction rv and obb defined by matrix mat
-    // mat will transform an aabb centred at 0 with extents -1 to 1 into an obb
-    inline bool ray_vs_obb(const mat4& mat, const vec3f& r1, const vec3f& rv, vec3f& ip)
+    // slab test for testing one ray against many aabbs, inv_rv is 1 / rv computed once per ray. returns true if the ray
+    // hits the aabb between 0 and t_max along rv, t is set to the entry distance or 0 when r1 is inside the aabb
+    inline bool ray_vs_aabb(const vec3f& emin, const vec3f& emax, const vec3f& r1, const vec3f& inv_rv, f32 t_max, f32& t)
     {
-        mat4  invm = mat::inverse4x4(mat);
-        vec3f tr1  = invm.transform_vector(vec4f(r1, 1.0f)).xyz;
+        f32 t1 = (emin.x - r1.x) * inv_rv.x;
+        f32 t2 = (emax.x - r1.x) * inv_rv.x;
+        f32 t3 = (emin.y - r1.y) * inv_rv.y;
+        f32 t4 = (emax.y - r1.y) * inv_rv.y;
+        f32 t5 = (emin.z - r1.z) * inv_rv.z;
+        f32 t6 = (emax.z - r1.z) * inv_rv.z;
         
-        invm.set_translation(vec3f::zero());
-        vec3f trv = invm.transform_vector(vec4f(rv, 1.0f)).xyz;
+        f32 tmin = max(max(min(t1, t2), min(t3, t4)), min(t5, t6));
+        f32 tmax = min(min(max(t1, t2), max(t3, t4)), max(t5, t6));
         
-        bool ii = ray_vs_aabb(-vec3f::one(), vec3f::one(), tr1, normalised(trv), ip);
+        t = max(tmin, 0.0f);
+        return t <= tmax && t < t_max;
+    }
+    
+    // packet version of the slab test for W rays against one aabb, r1 and inv_rv hold a ray per lane. returns a mask of
+    // lanes which hit the aabb between 0 and t_max, t is set to the entry distance of every lane (see ray_vs_aabb)
+    template<size_t W>
+    inline Wide<W> ray_vs_aabb(const vec3f& emin, const vec3f& emax, const Vec<3, Wide<W>>& r1, const Vec<3, Wide<W>>& inv_rv,
+                               const Wide<W>& t_max, Wide<W>& t)
+    {
+        Wide<W> t1 = (Wide<W>(emin.x) - r1.x) * inv_rv.x;
+        Wide<W> t2 = (Wide<W>(emax.x) - r1.x) * inv_rv.x;
+        Wide<W> t3 = (Wide<W>(emin.y) - r1.y) * inv_rv.y;
+        Wide<W> t4 = (Wide<W>(emax.y) - r1.y) * inv_rv.y;
+        Wide<W> t5 = (Wide<W>(emin.z) - r1.z) * inv_rv.z;
+        Wide<W> t6 = (Wide<W>(emax.z) - r1.z) * inv_rv.z;
+        
+        Wide<W> tmin = max(max(min(t1, t2), min(t3, t4)), min(t5, t6));
+        Wide<W> tmax = min(min(max(t1, t2), max(t3, t4)), max(t5, t6));
+        
+        t = max(tmin, Wide<W>(0.0f));
+        return (t <= tmax) & (t < t_max);
+    }
+    
+    // packet version of ray_vs_triangle for W rays against one triangle, r0 and rv hold a ray per lane. returns a mask
+    // of lanes which hit, t is set for every lane and is only meaningful where the mask is set. lanes parallel to the
+    // triangle divide by 0 and the nan / inf barycentrics fail the range checks
+    template<size_t W>
+    inline Wide<W> ray_vs_triangle(const Vec<3, Wide<W>>& r0, const Vec<3, Wide<W>>& rv, const vec3f& t0, const vec3f& t1,
+                                   const vec3f& t2, Wide<W>& t)
+    {
+        vec3f e1 = t1 - t0;
+        vec3f e2 = t2 - t0;
         
-        ip = mat.transform_vector(vec4f(ip, 1.0f)).xyz;
-        return ii;
+        // pv = cross(rv, e2)
+        Wide<W> px = rv.y * e2.z - rv.z * e2.y;
+        Wide<W> py = rv.z * e2.x - rv.x * e2.z;
+        Wide<W> pz = rv.x * e2.y - rv.y * e2.x;
+        
+        Wide<W> inv_det = Wide<W>(1.0f) / fmadd(px, e1.x, fmadd(py, e1.y, pz * e1.z));
+        
+        Wide<W> tx = r0.x - t0.x;
+        Wide<W> ty = r0.y - t0.y;
+        Wide<W> tz = r0.z - t0.z;
+        Wide<W> u = fmadd(tx, px, fmadd(ty, py, tz * pz)) * inv_det;
+        
+        // qv = cross(tv, e1)
+        Wide<W> qx = ty * e1.z - tz * e1.y;
+        Wide<W> qy = tz * e1.x - tx * e1.z;
+        Wide<W> qz = tx * e1.y - ty * e1.x;
+        Wide<W> v = fmadd(rv.x, qx, fmadd(rv.y, qy, rv.z * qz)) * inv_det;
+        
+        t = fmadd(qx, e2.x, fmadd(qy, e2.y, qz * e2.z)) * inv_det;
+        
+        Wide<W> zero = 0.0f;
+        Wide<W> one = 1.0f;
+        return (u >= zero) & (u <= one) & (v >= zero) & (u + v <= one) & (t >= zero);
+    }
+    
+    // returns true if there is an intersection bewteen ray with origin r1 and direction rv and obb defined by matrix mat
+    // mat will transform an aabb centred at 0 with extents -1 to 1 into an obb
+    inline bool ray_vs_obb(const mat4& mat, const vec3f& r1, const vec3f& rv, vec3f& ip)
+    {
+        return ray_vs_obb(prepare_obb(mat), r1, rv, ip);
     }
     
     // returns the closest point to point p on the obb defined by mat
     // mat will transform an aabb centred at 0 with extents -1 to 1 into an obb
     inline vec3f closest_point_on_obb(const mat4& mat, const vec3f& p)
     {
-        mat4  invm = mat::inverse4x4(mat);
-        vec3f tp   = invm.transform_vector(vec4f(p, 1.0f)).xyz;
-        
-        vec3f cp = closest_point_on_aabb(tp, -vec3f::one(), vec3f::one());
-        
-        vec3f tcp = mat.transform_vector(vec4f(cp, 1.0f)).xyz;
-        return tcp;
+        return closest_point_on_obb(prepare_obb(mat), p);
     }
     
     // returns if the point p is inside the obb defined by mat
     // mat will transform an aabb centred at 0 with extents -1 to 1 into an obb
     inline bool point_inside_obb(const mat4& mat, const vec3f& p)
     {
-        mat4  invm = mat::inverse4x4(mat);
-        vec3f tp   = invm.transform_vector(vec4f(p, 1.0f)).xyz;
+        return point_inside_obb(prepare_obb(mat), p);
+    }
+
+    // computes the inverse of the obb matrix once so it can be reused by the prepared_obb queries
+    inline prepared_obb prepare_obb(const mat4& mat)
+    {
+        prepared_obb obb;
+        obb.mat = mat;
+        obb.inverse = mat::inverse4x4(mat);
+        return obb;
+    }
+
+    // ray_vs_obb using the precomputed inverse of a prepared obb
+    inline bool ray_vs_obb(const prepared_obb& obb, const vec3f& r1, const vec3f& rv, vec3f& ip)
+    {
+        vec3f tr1 = obb.inverse.transform_vector(vec4f(r1, 1.0f)).xyz;
+        vec3f trv = obb.inverse.transform_vector(vec4f(rv, 0.0f)).xyz;
+        
+        bool ii = ray_vs_aabb(-vec3f::one(), vec3f::one(), tr1, normalised(trv), ip);
+        
+        ip = obb.mat.transform_vector(vec4f(ip, 1.0f)).xyz;
+        return ii;
+    }
+
+    // closest_point_on_obb using the precomputed inverse of a prepared obb
+    inline vec3f closest_point_on_obb(const prepared_obb& obb, const vec3f& p)
+    {
+        vec3f tp = obb.inverse.transform_vector(vec4f(p, 1.0f)).xyz;
+        vec3f cp = closest_point_on_aabb(tp, -vec3f::one(), vec3f::one());
+        
+        return obb.mat.transform_vector(vec4f(cp, 1.0f)).xyz;
+    }
+
+    // point_inside_obb using the precomputed inverse of a prepared obb
+    inline bool point_inside_obb(const prepared_obb& obb, const vec3f& p)
+    {
+        vec3f tp = obb.inverse.transform_vector(vec4f(p, 1.0f)).xyz;
         
         return point_inside_aabb(-vec3f::one(), vec3f::one(), tp);
     }
+
+    // batch ray_vs_obb for count rays, intersection points are written to ip and hits as a packed bitmask where
+    // bit (i % 32) of hit[i / 32] is set if ray i intersects, hit must have space for (count + 31) / 32 elements.
+    inline void ray_vs_obb(const prepared_obb& obb, const vec3f* r1, const vec3f* rv, vec3f* ip, size_t count, u32* hit)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i % 32 == 0)
+                hit[i / 32] = 0;
+            if (ray_vs_obb(obb, r1[i], rv[i], ip[i]))
+                hit[i / 32] |= 1u << (i % 32);
+        }
+    }
+
+    // batch closest_point_on_obb for count points p, writing the results to out
+    inline void closest_point_on_obb(const prepared_obb& obb, const vec3f* p, vec3f* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = closest_point_on_obb(obb, p[i]);
+    }
+
+    // batch point_inside_obb for count points p, writing a packed bitmask where bit (i % 32) of inside[i / 32] is set
+    // if point i is inside, inside must have space for (count + 31) / 32 elements.
+    inline void point_inside_obb(const prepared_obb& obb, const vec3f* p, size_t count, u32* inside)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i % 32 == 0)
+                inside[i / 32] = 0;
+            if (point_inside_obb(obb, p[i]))
+                inside[i / 32] |= 1u << (i % 32);
+        }
+    }
     
-    // returns a convex hull wound clockwise from point cloud "points"
+    // returns a convex hull wound clockwise from point cloud "points", appended to hull
     inline void convex_hull_from_points(std::vector<vec2f>& hull, const std::vector<vec2f>& points)
     {
-        std::vector<vec3f> to_sort;
+        std::vector<vec2f> scratch(points.size());
         
-        for (auto& p : points)
-            to_sort.push_back({p, 0.0f});
+        size_t base = hull.size();
+        hull.resize(base + points.size() + 1);
         
-        //find right most
-        vec3f cur = to_sort[0];
-        size_t curi = 0;
-        for (size_t i = 1; i < to_sort.size(); ++i)
-        {
-            if(to_sort[i].x > cur.x)
-                if(to_sort[i].y > cur.y)
+        size_t n = convex_hull_from_points(&hull[base], points.data(), points.size(), scratch.data());
+        hull.resize(base + n);
+    }
+
+    // computes the convex hull of count points with monotone chain in O(n log n), wound the same as the vector version
+    // starting at the right most point, collinear points are removed and coincident points give a hull of 1 point.
+    // scratch must have space for count points and hull space for count + 1, returns the number of points written to
+    // hull. with max_threads 1 no memory is allocated, otherwise starting threads allocates.
+    // before sorting, points inside the octagon of extreme points (min / max of x, y, x + y and x - y) are discarded,
+    // this pre-pass is split across threads for large inputs, max_threads 1 runs it on the calling thread.
+    inline size_t convex_hull_from_points(vec2f* hull, const vec2f* points, size_t count, vec2f* scratch, u32 max_threads)
+    {
+        if (count == 0)
+            return 0;
+        
+        static const size_t k_min_range = 1 << 14;
+        u32 ranges = parallel_range_count(count, k_min_range, max_threads);
+        
+        // extreme points along 8 directions wound ccw: -y, x - y, x, x + y, y, y - x, -x, -x - y
+        static const vec2f dirs[8] = {
+            vec2f(0.0f, -1.0f), vec2f(1.0f, -1.0f), vec2f(1.0f, 0.0f), vec2f(1.0f, 1.0f),
+            vec2f(0.0f, 1.0f), vec2f(-1.0f, 1.0f), vec2f(-1.0f, 0.0f), vec2f(-1.0f, -1.0f)
+        };
+        size_t extremes[k_max_parallel_ranges][8];
+        parallel_for(count, k_min_range, [&](u32 r, size_t begin, size_t end) {
+            f32 best[8];
+            for (size_t d = 0; d < 8; ++d)
+            {
+                best[d] = dot(points[begin], dirs[d]);
+                extremes[r][d] = begin;
+            }
+            for (size_t i = begin + 1; i < end; ++i)
+            {
+                const vec2f& p = points[i];
+                f32 v[8] = {-p.y, p.x - p.y, p.x, p.x + p.y, p.y, p.y - p.x, -p.x, -p.x - p.y};
+                for (size_t d = 0; d < 8; ++d)
                 {
-                    cur = to_sort[i];
-                    curi = i;
+                    if (v[d] > best[d])
+                    {
+                        best[d] = v[d];
+                        extremes[r][d] = i;
+                    }
                 }
-        }
+            }
+        }, ranges);
         
-        // wind
-        hull.push_back(cur.xy);
-        for(;;)
+        vec2f oct[8];
+        for (size_t d = 0; d < 8; ++d)
         {
-            size_t rm = (curi+1)%to_sort.size();
-            vec3f x1 = to_sort[rm];
-            for (size_t i = 0; i < to_sort.size(); ++i)
+            size_t e = extremes[0][d];
+            for (u32 r = 1; r < ranges; ++r)
+                if (dot(points[extremes[r][d]], dirs[d]) > dot(points[e], dirs[d]))
+                    e = extremes[r][d];
+            oct[d] = points[e];
+        }
+        
+        // remove duplicate corners of the octagon and get edge vectors
+        size_t num_oct = 0;
+        for (size_t d = 0; d < 8; ++d)
+            if (num_oct == 0 || (oct[d] != oct[num_oct - 1] && (d < 7 || oct[d] != oct[0])))
+                oct[num_oct++] = oct[d];
+        
+        vec2f edge[8];
+        for (size_t j = 0; j < num_oct; ++j)
+            edge[j] = oct[(j + 1) % num_oct] - oct[j];
+        
+        // each range writes surviving points to the start of its own section of scratch
+        size_t kept[k_max_parallel_ranges];
+        parallel_for(count, k_min_range, [&](u32 r, size_t begin, size_t end) {
+            size_t k = begin;
+            for (size_t i = begin; i < end; ++i)
             {
-                if(i == curi)
-                    continue;
-                
-                vec3f x2 = to_sort[i];
-                vec3f v1 = x1 - cur;
-                vec3f v2 = x2 - cur;
-                vec3f cp = cross(v2, v1);
-                if (cp.z > 0.0f)
-                {
-                    x1 = to_sort[i];
-                    rm = i;
-                }
+                bool inside = num_oct >= 3;
+                for (size_t j = 0; j < num_oct && inside; ++j)
+                    inside = cross(edge[j], points[i] - oct[j]) > 0.0f;
+                if (!inside)
+                    scratch[k++] = points[i];
             }
-            if(almost_equal((vec2f)x1.xy, hull[0], 0.0001f))
-                break;
-            
-            cur = x1;
-            curi = rm;
-            hull.push_back(x1.xy);
+            kept[r] = k - begin;
+        }, ranges);
+        
+        // compact sections
+        size_t n = kept[0];
+        size_t range_size = (count + ranges - 1) / ranges;
+        for (u32 r = 1; r < ranges; ++r)
+        {
+            size_t begin = r * range_size;
+            for (size_t i = 0; i < kept[r]; ++i)
+                scratch[n++] = scratch[begin + i];
+        }
+        
+        std::sort(scratch, scratch + n, [](const vec2f& a, const vec2f& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        
+        // all points coincident
+        if (scratch[0] == scratch[n - 1])
+        {
+            hull[0] = scratch[0];
+            return 1;
+        }
+        
+        // lower then upper chain, ccw
+        size_t k = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            while (k >= 2 && cross(hull[k - 1] - hull[k - 2], scratch[i] - hull[k - 2]) <= 0.0f)
+                --k;
+            hull[k++] = scratch[i];
         }
+        
+        for (size_t i = n - 1, t = k + 1; i > 0; --i)
+        {
+            while (k >= t && cross(hull[k - 1] - hull[k - 2], scratch[i - 1] - hull[k - 2]) <= 0.0f)
+                --k;
+            hull[k++] = scratch[i - 1];
+        }
+        
+        // last point is a duplicate of the first
+        --k;
+        
+        // start at the right most point
+        size_t start = 0;
+        for (size_t i = 1; i < k; ++i)
+            if (hull[i].x > hull[start].x || (hull[i].x == hull[start].x && hull[i].y > hull[start].y))
+                start = i;
+        std::rotate(hull, hull + start, hull + k);
+        
+        return k;
     }
     
     // return the centre point of a 2d convex hull
@@ -973,4 +1933,142 @@ namespace maths
             cp += p;
         return cp / (f32)hull.size();
     }
+
+    // maps points inside aabb_min, aabb_max to integer coordinates in [0, 2^bits), points outside are clamped to the
+    // edge cells and a flat axis maps to 0
+    struct curve_quantiser
+    {
+        vec3f offset;
+        vec3f scale;
+        f32   max_cell;
+
+        curve_quantiser(const vec3f& aabb_min, const vec3f& aabb_max, u32 bits)
+        {
+            f32 cells = (f32)((u64)1 << bits);
+            vec3f extent = aabb_max - aabb_min;
+            offset = aabb_min;
+            for (u32 i = 0; i < 3; ++i)
+                scale[i] = extent[i] > 0.0f ? cells / extent[i] : 0.0f;
+            max_cell = cells - 1.0f;
+        }
+
+        maths_inline void operator()(const vec3f& p, u64* c) const
+        {
+            for (u32 i = 0; i < 3; ++i)
+                c[i] = (u64)(u32)(int)std::min(std::max((p[i] - offset[i]) * scale[i], 0.0f), max_cell);
+        }
+    };
+
+    template <typename T>
+    inline void morton_encode_generic(const vec3f* points, size_t count, const curve_quantiser& q, T* codes)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            u64 c[3];
+            q(points[i], c);
+            T d;
+            morton_xyz3d((T)c[0], (T)c[1], (T)c[2], &d);
+            codes[i] = d;
+        }
+    }
+
+    template <typename T>
+    inline void hilbert_encode_generic(const vec3f* points, size_t count, const curve_quantiser& q, u32 bits, T* codes)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            u64 c[3];
+            q(points[i], c);
+            hilbert_axes_to_transpose(c, bits);
+            T d;
+            morton_xyz3d((T)c[2], (T)c[1], (T)c[0], &d);
+            codes[i] = d;
+        }
+    }
+
+#ifdef MATHS_BMI2
+    template <typename T>
+    inline maths_target_bmi2 void morton_encode_bmi2(const vec3f* points, size_t count, const curve_quantiser& q,
+                                                     T* codes)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            u64 c[3];
+            q(points[i], c);
+            codes[i] = (T)morton_xyz3d_bmi2(c[0], c[1], c[2]);
+        }
+    }
+
+    template <typename T>
+    inline maths_target_bmi2 void hilbert_encode_bmi2(const vec3f* points, size_t count, const curve_quantiser& q,
+                                                      u32 bits, T* codes)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            u64 c[3];
+            q(points[i], c);
+            hilbert_axes_to_transpose(c, bits);
+            codes[i] = (T)morton_xyz3d_bmi2(c[2], c[1], c[0]);
+        }
+    }
+#endif
+
+    template <typename T>
+    inline void morton_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                              T* codes, u32 bits)
+    {
+        curve_quantiser q(aabb_min, aabb_max, bits);
+#ifdef MATHS_BMI2
+        if (cpu_supports_bmi2())
+        {
+            morton_encode_bmi2(points, count, q, codes);
+            return;
+        }
+#endif
+        morton_encode_generic(points, count, q, codes);
+    }
+
+    template <typename T>
+    inline void hilbert_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                               T* codes, u32 bits)
+    {
+        curve_quantiser q(aabb_min, aabb_max, bits);
+#ifdef MATHS_BMI2
+        if (cpu_supports_bmi2())
+        {
+            hilbert_encode_bmi2(points, count, q, bits, codes);
+            return;
+        }
+#endif
+        hilbert_encode_generic(points, count, q, bits, codes);
+    }
+
+    // writes the 30 bit morton code of each point, quantised to 10 bits per axis inside aabb_min, aabb_max, to codes.
+    // with MATHS_SIMD the interleave uses bmi2 pdep when the cpu supports it, checked once per call.
+    inline void morton_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                              u32* codes)
+    {
+        morton_encode(points, count, aabb_min, aabb_max, codes, 10);
+    }
+
+    // 63 bit morton codes with 21 bits per axis, see above
+    inline void morton_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                              u64* codes)
+    {
+        morton_encode(points, count, aabb_min, aabb_max, codes, 21);
+    }
+
+    // writes the 30 bit hilbert index of each point, quantised to 10 bits per axis inside aabb_min, aabb_max, to codes
+    inline void hilbert_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                               u32* codes)
+    {
+        hilbert_encode(points, count, aabb_min, aabb_max, codes, 10);
+    }
+
+    // 63 bit hilbert indices with 21 bits per axis, see above
+    inline void hilbert_encode(const vec3f* points, size_t count, const vec3f& aabb_min, const vec3f& aabb_max,
+                               u64* codes)
+    {
+        hilbert_encode(points, count, aabb_min, aabb_max, codes, 21);
+    }
 } // namespace maths
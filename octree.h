@@ -0,0 +1,332 @@
+// octree.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <vector>
+
+// dynamic loose octree for many moving aabbs. nodes are loose by a factor of 2, so an object is stored at the
+// deepest level where its extent fits the cell size and in the cell containing its centre. that makes the node an
+// object belongs to a function of its bounds, a morton key, and a move only relinks the object when the key changes,
+// walking up to the common ancestor and down again. nodes and objects live in pools with free lists and objects in
+// a node are an intrusive list, so moves do not allocate once the pools have grown.
+//
+// maths::octree tree;
+// maths::create_octree(tree, vec3f::zero(), 1000.0f);
+// u32 id = maths::octree_add(tree, aabb_min, aabb_max);
+// maths::octree_move(tree, id, new_min, new_max);
+// maths::octree_vs_frustum(tree, planes, visible);
+
+namespace maths
+{
+    static const u32 k_octree_none = 0xffffffff;
+    static const u32 k_octree_max_depth = 20; // 3 bits per level plus a marker bit in a u64 key
+
+    struct octree_node
+    {
+        vec3f centre;
+        f32   half;         // half size of the cell, objects in the node fit inside centre +/- half * 2
+        u64   key;          // 1 << (3 * depth) | morton code of the cell at depth
+        u32   depth;
+        u32   parent;
+        u32   children[8];  // indexed by the low 3 bits of the child key, x in bit 0
+        u32   num_children;
+        u32   first;        // first object in the node
+        u32   num_objects;
+    };
+
+    struct octree_object
+    {
+        vec3f aabb_min;
+        u32   node; // k_octree_none when the object is free
+        vec3f aabb_max;
+        u32   next;
+        u32   prev;
+    };
+
+    struct octree
+    {
+        vec3f                      centre;
+        f32                        half;
+        u32                        max_depth;
+        std::vector<octree_node>   nodes;   // pool, nodes[0] is the root
+        std::vector<octree_object> objects; // pool indexed by object id
+        std::vector<u32>           free_nodes;
+        std::vector<u32>           free_objects;
+    };
+
+    void create_octree(octree& tree, const vec3f& centre, f32 half_size, u32 max_depth = 8);
+    u32  octree_add(octree& tree, const vec3f& aabb_min, const vec3f& aabb_max);
+    void octree_move(octree& tree, u32 id, const vec3f& aabb_min, const vec3f& aabb_max);
+    void octree_remove(octree& tree, u32 id);
+    void octree_vs_frustum(const octree& tree, vec4f* planes, std::vector<u32>& results);
+    void ray_vs_octree(const octree& tree, const vec3f& r0, const vec3f& rv, std::vector<u32>& results, f32 t_max = FLT_MAX);
+
+    //
+    // Implementation
+    //
+
+    // key of the node an aabb belongs in, objects larger than the world or centred outside of it go in the root.
+    // scalar maths as this runs for every move.
+    inline u64 octree_key(const octree& tree, const vec3f& aabb_min, const vec3f& aabb_max, u32& depth)
+    {
+        f32 inv = 0.5f / tree.half;
+        f32 rel[3];
+        f32 extent = 0.0f;
+        for (u32 i = 0; i < 3; ++i)
+        {
+            rel[i] = ((aabb_min[i] + aabb_max[i]) * 0.5f - tree.centre[i]) * inv + 0.5f;
+            extent = std::max(extent, aabb_max[i] - aabb_min[i]);
+        }
+        extent *= 0.5f;
+
+        depth = 0;
+        if (!(rel[0] >= 0.0f && rel[1] >= 0.0f && rel[2] >= 0.0f && rel[0] < 1.0f && rel[1] < 1.0f && rel[2] < 1.0f))
+            return 1;
+
+        f32 h = tree.half * 0.5f;
+        while (depth < tree.max_depth && extent <= h)
+        {
+            h *= 0.5f;
+            ++depth;
+        }
+
+        u64 n = (u64)1 << depth;
+        u64 c[3];
+        for (u32 i = 0; i < 3; ++i)
+            c[i] = std::min((u64)(rel[i] * (f32)n), n - 1);
+
+        u64 d;
+        morton_xyz3d(c[0], c[1], c[2], &d);
+        return ((u64)1 << (3 * depth)) | d;
+    }
+
+    inline u32 octree_alloc_node(octree& tree, u32 parent, u32 child)
+    {
+        u32 n;
+        if (!tree.free_nodes.empty())
+        {
+            n = tree.free_nodes.back();
+            tree.free_nodes.pop_back();
+        }
+        else
+        {
+            n = (u32)tree.nodes.size();
+            tree.nodes.push_back(octree_node());
+        }
+
+        octree_node& node = tree.nodes[n];
+        node.parent = parent;
+        node.first = k_octree_none;
+        node.num_objects = 0;
+        node.num_children = 0;
+        for (u32 i = 0; i < 8; ++i)
+            node.children[i] = k_octree_none;
+
+        if (parent == k_octree_none)
+        {
+            node.centre = tree.centre;
+            node.half = tree.half;
+            node.key = 1;
+            node.depth = 0;
+        }
+        else
+        {
+            octree_node& p = tree.nodes[parent];
+            f32 h = p.half * 0.5f;
+            node.centre = p.centre + vec3f(child & 1 ? h : -h, child & 2 ? h : -h, child & 4 ? h : -h);
+            node.half = h;
+            node.key = (p.key << 3) | child;
+            node.depth = p.depth + 1;
+            p.children[child] = n;
+            ++p.num_children;
+        }
+
+        return n;
+    }
+
+    // finds or creates the node for key, walking up from node n to the first ancestor of key and then down
+    inline u32 octree_find_node(octree& tree, u32 n, u64 key, u32 depth)
+    {
+        for (;;)
+        {
+            const octree_node& node = tree.nodes[n];
+            if (node.depth <= depth && (key >> (3 * (depth - node.depth))) == node.key)
+                break;
+            n = node.parent;
+        }
+
+        for (u32 d = tree.nodes[n].depth + 1; d <= depth; ++d)
+        {
+            u32 child = (u32)(key >> (3 * (depth - d))) & 7;
+            u32 c = tree.nodes[n].children[child];
+            n = c != k_octree_none ? c : octree_alloc_node(tree, n, child);
+        }
+
+        return n;
+    }
+
+    inline void octree_link(octree& tree, u32 id, u32 n)
+    {
+        octree_object& obj = tree.objects[id];
+        octree_node&   node = tree.nodes[n];
+        obj.node = n;
+        obj.prev = k_octree_none;
+        obj.next = node.first;
+        if (node.first != k_octree_none)
+            tree.objects[node.first].prev = id;
+        node.first = id;
+        ++node.num_objects;
+    }
+
+    inline void octree_unlink(octree& tree, u32 id)
+    {
+        octree_object& obj = tree.objects[id];
+        octree_node&   node = tree.nodes[obj.node];
+        if (obj.prev != k_octree_none)
+            tree.objects[obj.prev].next = obj.next;
+        else
+            node.first = obj.next;
+        if (obj.next != k_octree_none)
+            tree.objects[obj.next].prev = obj.prev;
+        --node.num_objects;
+    }
+
+    // frees empty leaves from n towards the root
+    inline void octree_prune(octree& tree, u32 n)
+    {
+        while (n != 0)
+        {
+            octree_node& node = tree.nodes[n];
+            if (node.num_objects || node.num_children)
+                return;
+
+            octree_node& p = tree.nodes[node.parent];
+            p.children[node.key & 7] = k_octree_none;
+            --p.num_children;
+            tree.free_nodes.push_back(n);
+            n = node.parent;
+        }
+    }
+
+    // creates an empty octree covering centre +/- half_size, max_depth is clamped to k_octree_max_depth. queries are
+    // fastest when the deepest nodes hold a few objects each rather than one, so for many small objects spread through
+    // the world a shallower max_depth is usually better.
+    inline void create_octree(octree& tree, const vec3f& centre, f32 half_size, u32 max_depth)
+    {
+        tree.centre = centre;
+        tree.half = half_size;
+        tree.max_depth = std::min(max_depth, k_octree_max_depth);
+        tree.nodes.clear();
+        tree.objects.clear();
+        tree.free_nodes.clear();
+        tree.free_objects.clear();
+        octree_alloc_node(tree, k_octree_none, 0);
+    }
+
+    inline u32 octree_add(octree& tree, const vec3f& aabb_min, const vec3f& aabb_max)
+    {
+        u32 id;
+        if (!tree.free_objects.empty())
+        {
+            id = tree.free_objects.back();
+            tree.free_objects.pop_back();
+        }
+        else
+        {
+            id = (u32)tree.objects.size();
+            tree.objects.push_back(octree_object());
+        }
+
+        u32 depth;
+        u64 key = octree_key(tree, aabb_min, aabb_max, depth);
+        tree.objects[id].aabb_min = aabb_min;
+        tree.objects[id].aabb_max = aabb_max;
+        octree_link(tree, id, octree_find_node(tree, 0, key, depth));
+        return id;
+    }
+
+    // updates the bounds of an object, it only changes node when its key changes which for small moves is a walk to
+    // a nearby ancestor, the old node and any ancestors left empty are returned to the pool
+    inline void octree_move(octree& tree, u32 id, const vec3f& aabb_min, const vec3f& aabb_max)
+    {
+        octree_object& obj = tree.objects[id];
+        obj.aabb_min = aabb_min;
+        obj.aabb_max = aabb_max;
+
+        u32 depth;
+        u64 key = octree_key(tree, aabb_min, aabb_max, depth);
+        u32 old = obj.node;
+        if (tree.nodes[old].key == key)
+            return;
+
+        u32 n = octree_find_node(tree, old, key, depth);
+        octree_unlink(tree, id);
+        octree_link(tree, id, n);
+        octree_prune(tree, old);
+    }
+
+    inline void octree_remove(octree& tree, u32 id)
+    {
+        u32 old = tree.objects[id].node;
+        octree_unlink(tree, id);
+        octree_prune(tree, old);
+        tree.objects[id].node = k_octree_none;
+        tree.free_objects.push_back(id);
+    }
+
+    // walks nodes whose loose bounds pass test(aabb_min, aabb_max) and calls f(id) for objects which pass too. the
+    // root is always visited as it holds objects outside of the world bounds.
+    template <typename T, typename F>
+    inline void octree_query(const octree& tree, T test, F f)
+    {
+        u32 stack[8 * k_octree_max_depth + 8];
+        u32 sp = 0;
+        stack[sp++] = 0;
+
+        while (sp > 0)
+        {
+            const octree_node& node = tree.nodes[stack[--sp]];
+            vec3f loose = vec3f(node.half * 2.0f);
+            if (node.depth > 0 && !test(node.centre - loose, node.centre + loose))
+                continue;
+
+            for (u32 id = node.first; id != k_octree_none; id = tree.objects[id].next)
+            {
+                const octree_object& obj = tree.objects[id];
+                if (test(obj.aabb_min, obj.aabb_max))
+                    f(id);
+            }
+
+            if (node.num_children)
+                for (u32 i = 0; i < 8; ++i)
+                    if (node.children[i] != k_octree_none)
+                        stack[sp++] = node.children[i];
+        }
+    }
+
+    // appends the id of every object whose aabb passes aabb_vs_frustum
+    inline void octree_vs_frustum(const octree& tree, vec4f* planes, std::vector<u32>& results)
+    {
+        octree_query(tree, [&](const vec3f& emin, const vec3f& emax) {
+            return aabb_vs_frustum((emin + emax) * 0.5f, (emax - emin) * 0.5f, planes);
+        }, [&](u32 id) {
+            results.push_back(id);
+        });
+    }
+
+    // appends the id of every object whose aabb is hit by the ray between 0 and t_max along rv, in no particular order
+    inline void ray_vs_octree(const octree& tree, const vec3f& r0, const vec3f& rv, std::vector<u32>& results, f32 t_max)
+    {
+        vec3f inv_rv = vec3f::one() / rv;
+        octree_query(tree, [&](const vec3f& emin, const vec3f& emax) {
+            f32 t;
+            return ray_vs_aabb(emin, emax, r0, inv_rv, t_max, t);
+        }, [&](u32 id) {
+            results.push_back(id);
+        });
+    }
+}
@@ -0,0 +1,51 @@
+// parallel.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "util.h"
+
+#include <thread>
+
+// minimal fork / join helpers used by the batch and spatial functions to split large inputs across threads.
+// std::thread is used directly so on some platforms you need to link with -pthread.
+
+namespace maths
+{
+    static const u32 k_max_parallel_ranges = 64;
+
+    // returns the number of ranges parallel_for will split count elements into, each range has at least min_range
+    // elements. max_threads 0 uses std::thread::hardware_concurrency, 1 runs everything on the calling thread.
+    inline u32 parallel_range_count(size_t count, size_t min_range, u32 max_threads = 0)
+    {
+        if (max_threads == 0)
+            max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+        size_t ranges = count / std::max(min_range, (size_t)1);
+        ranges = std::min(ranges, (size_t)std::min(max_threads, k_max_parallel_ranges));
+        return (u32)std::max(ranges, (size_t)1);
+    }
+
+    // splits [0, count) into parallel_range_count contiguous ranges and calls f(range_index, begin, end) for each one
+    // on its own thread, the calling thread processes range 0 and waits for the others to finish.
+    template <typename F>
+    inline void parallel_for(size_t count, size_t min_range, F f, u32 max_threads = 0)
+    {
+        u32    ranges = parallel_range_count(count, min_range, max_threads);
+        size_t range_size = (count + ranges - 1) / ranges;
+
+        std::thread threads[k_max_parallel_ranges];
+        for (u32 r = 1; r < ranges; ++r)
+        {
+            size_t begin = std::min(r * range_size, count);
+            size_t end = std::min(begin + range_size, count);
+            threads[r] = std::thread(f, r, begin, end);
+        }
+
+        f(0u, (size_t)0, std::min(range_size, count));
+
+        for (u32 r = 1; r < ranges; ++r)
+            threads[r].join();
+    }
+}
@@ -81,7 +81,8 @@ template<typename T>
 maths_inline Quat<T> normalized(Quat<T>& q)
 {
     Quat<T> q2 = q;
-    return normalise(q2);
+    normalise(q2);
+    return q2;
 }
 
 
@@ -95,7 +96,8 @@ template<typename T>
 maths_inline Quat<T> lerp(const Quat<T>& l, const Quat<T>& r, T t)
 {
     Quat<T> lerped = (l * ((T)1 - t) + r * t);
-    return normalise(lerped);
+    normalise(lerped);
+    return lerped;
 }
 
 template<typename T>
@@ -219,7 +221,7 @@ maths_inline Quat<T> Quat<T>::operator*(const Quat<T>& rhs) const
     Quat<T> res;
     res.w = w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z;
     res.x = w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y;
-    res.y = w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.z;
+    res.y = w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x;
     res.z = w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w;
 
     return res;
@@ -231,7 +233,7 @@ maths_inline Quat<T>& Quat<T>::operator*=(const Quat<T>& rhs)
     Quat<T> res;
     res.w = w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z;
     res.x = w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y;
-    res.y = w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.z;
+    res.y = w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x;
     res.z = w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w;
 
     *this = res;
@@ -419,6 +421,154 @@ inline Vec<3, T> Quat<T>::to_euler() const
     return euler;
 }
 
+// rigid transform as a dual quaternion, real is the rotation and dual is 0.5 * t * real for a translation t, so
+// points are rotated and then translated. scale can not be represented. unlike matrices, dual quaternions can be
+// blended while staying a rigid transform.
+template<typename T>
+struct DualQuat
+{
+    Quat<T> real;
+    Quat<T> dual;
+
+    DualQuat();
+    DualQuat(const Quat<T>& rotation, const Vec<3, T>& translation);
+    DualQuat(const Quat<T>& real, const Quat<T>& dual);
+
+    DualQuat  operator*(const T& scale) const;
+    DualQuat  operator+(const DualQuat<T>& dq) const;
+    DualQuat  operator*(const DualQuat<T>& rhs) const;
+
+    Quat<T>   get_rotation() const;
+    Vec<3, T> get_translation() const;
+    void      get_matrix(Mat<4, 4, T>& lmatrix) const;
+    void      from_matrix(const Mat<4, 4, T>& m);
+    Vec<3, T> transform_point(const Vec<3, T>& p) const;
+    Vec<3, T> transform_vector(const Vec<3, T>& v) const;
+};
+
+// free funcs
+template<typename T>
+maths_inline void normalise(DualQuat<T>& dq)
+{
+    // unit real and dual orthogonal to it
+    T rmag = (T)1 / sqrt(dot(dq.real, dq.real));
+    dq.real *= rmag;
+    dq.dual *= rmag;
+    dq.dual = dq.dual + dq.real * -dot(dq.real, dq.dual);
+}
+
+template<typename T>
+maths_inline DualQuat<T> normalised(const DualQuat<T>& dq)
+{
+    DualQuat<T> dq2 = dq;
+    normalise(dq2);
+    return dq2;
+}
+
+// dual quaternion linear blending, the weighted sum of count dual quaternions normalised. each is flipped into
+// the hemisphere of the first so the blend takes the shorter path, weights do not need to sum to 1.
+template<typename T>
+inline DualQuat<T> blend(const DualQuat<T>* dqs, const T* weights, size_t count)
+{
+    DualQuat<T> b = dqs[0] * weights[0];
+    for (size_t i = 1; i < count; ++i)
+    {
+        T w = dot(dqs[i].real, dqs[0].real) < (T)0 ? -weights[i] : weights[i];
+        b = b + dqs[i] * w;
+    }
+    normalise(b);
+    return b;
+}
+
+// constructors
+template<typename T>
+maths_inline DualQuat<T>::DualQuat()
+{
+    dual = Quat<T>((T)0, (T)0, (T)0, (T)0);
+}
+
+template<typename T>
+maths_inline DualQuat<T>::DualQuat(const Quat<T>& rotation, const Vec<3, T>& translation)
+{
+    real = rotation;
+    dual = Quat<T>(translation.x, translation.y, translation.z, (T)0) * rotation * (T)0.5;
+}
+
+template<typename T>
+maths_inline DualQuat<T>::DualQuat(const Quat<T>& real, const Quat<T>& dual)
+{
+    this->real = real;
+    this->dual = dual;
+}
+
+// operators
+template<typename T>
+maths_inline DualQuat<T> DualQuat<T>::operator*(const T& scale) const
+{
+    return DualQuat<T>(real * scale, dual * scale);
+}
+
+template<typename T>
+maths_inline DualQuat<T> DualQuat<T>::operator+(const DualQuat<T>& dq) const
+{
+    return DualQuat<T>(real + dq.real, dual + dq.dual);
+}
+
+// non commutative, the transform of rhs followed by this
+template<typename T>
+maths_inline DualQuat<T> DualQuat<T>::operator*(const DualQuat<T>& rhs) const
+{
+    return DualQuat<T>(real * rhs.real, real * rhs.dual + dual * rhs.real);
+}
+
+// member funcs
+template<typename T>
+maths_inline Quat<T> DualQuat<T>::get_rotation() const
+{
+    return real;
+}
+
+// vector part of 2 * dual * conjugate(real)
+template<typename T>
+maths_inline Vec<3, T> DualQuat<T>::get_translation() const
+{
+    Vec<3, T> r = Vec<3, T>(real.x, real.y, real.z);
+    Vec<3, T> d = Vec<3, T>(dual.x, dual.y, dual.z);
+    return (d * real.w - r * dual.w + cross(r, d)) * (T)2;
+}
+
+template<typename T>
+inline void DualQuat<T>::get_matrix(Mat<4, 4, T>& lmatrix) const
+{
+    Quat<T> r = real;
+    r.get_matrix(lmatrix);
+    lmatrix.set_translation(get_translation());
+}
+
+// m is expected to be a rotation and translation only
+template<typename T>
+inline void DualQuat<T>::from_matrix(const Mat<4, 4, T>& m)
+{
+    Quat<T> r;
+    r.from_matrix(m);
+    *this = DualQuat<T>(r, m.get_translation());
+}
+
+// expects a unit dual quaternion
+template<typename T>
+maths_inline Vec<3, T> DualQuat<T>::transform_point(const Vec<3, T>& p) const
+{
+    return transform_vector(p) + get_translation();
+}
+
+// rotates v without translating it, expects a unit dual quaternion
+template<typename T>
+maths_inline Vec<3, T> DualQuat<T>::transform_vector(const Vec<3, T>& v) const
+{
+    Vec<3, T> r = Vec<3, T>(real.x, real.y, real.z);
+    return v + cross(r, cross(r, v) + v * real.w) * (T)2;
+}
+
 template <typename T>
 maths_inline std::ostream& operator<<(std::ostream& out, const Quat<T>& q)
 {
@@ -431,3 +581,7 @@ maths_inline std::ostream& operator<<(std::ostream& out, const Quat<T>& q)
 typedef Quat<float> quat;
 typedef Quat<float> quatf;
 typedef Quat<double> quatd;
+
+typedef DualQuat<float> dual_quat;
+typedef DualQuat<float> dual_quatf;
+typedef DualQuat<double> dual_quatd;
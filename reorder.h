@@ -0,0 +1,145 @@
+// reorder.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <vector>
+
+// spatial reordering of point and mesh data. points are keyed by their position along a space filling curve inside
+// their bounds and radix sorted, so points which are close in space end up close in memory. per point maths over
+// the reordered arrays streams through the cache instead of jumping around it, which matters most where data is
+// accessed indirectly, such as vertices through an index buffer or neighbours found by a query.
+//
+// std::vector<u32> perm;
+// maths::spatial_sort(positions.data(), positions.size(), perm);
+// maths::reorder(positions.data(), perm.data(), perm.size(), sorted_positions.data());
+// maths::reorder(normals.data(), perm.data(), perm.size(), sorted_normals.data());
+//
+// for an indexed mesh, remap the index buffer with the inverse permutation:
+// maths::invert_permutation(perm.data(), perm.size(), inv.data());
+// for (auto& i : indices) i = inv[i];
+
+namespace maths
+{
+    enum e_space_filling_curve
+    {
+        CURVE_MORTON  = 0,
+        CURVE_HILBERT = 1
+    };
+
+    void radix_sort(u32* keys, u32* values, size_t count, u32 key_bits = 32);
+    void spatial_sort(const vec3f* points, size_t count, std::vector<u32>& permutation,
+                      e_space_filling_curve curve = CURVE_MORTON);
+    template <typename T>
+    void reorder(const T* src, const u32* permutation, size_t count, T* dst);
+    void invert_permutation(const u32* permutation, size_t count, u32* inverse);
+
+    //
+    // Implementation
+    //
+
+    // lsd radix sort of keys carrying values along, stable. 11 bit digits so 30 bit curve keys take 3 passes, the
+    // histograms for every pass are counted up front in one read of the keys and passes where all keys share a
+    // digit are skipped. the result ends up back in keys and values.
+    inline void radix_sort(u32* keys, u32* values, size_t count, u32 key_bits)
+    {
+        static const u32 k_digit_bits = 11;
+        static const u32 k_buckets = 1 << k_digit_bits;
+        static const u32 k_max_passes = (32 + k_digit_bits - 1) / k_digit_bits;
+
+        u32 passes = std::min((key_bits + k_digit_bits - 1) / k_digit_bits, k_max_passes);
+        std::vector<u32> histograms(k_buckets * passes, 0);
+        for (size_t i = 0; i < count; ++i)
+            for (u32 p = 0; p < passes; ++p)
+                ++histograms[p * k_buckets + ((keys[i] >> (p * k_digit_bits)) & (k_buckets - 1))];
+
+        std::vector<u32> scratch_keys(count);
+        std::vector<u32> scratch_values(count);
+        u32* src_keys = keys;
+        u32* src_values = values;
+        u32* dst_keys = scratch_keys.data();
+        u32* dst_values = scratch_values.data();
+
+        for (u32 p = 0; p < passes; ++p)
+        {
+            u32* offsets = &histograms[p * k_buckets];
+            u32  shift = p * k_digit_bits;
+            if (count == 0 || offsets[(src_keys[0] >> shift) & (k_buckets - 1)] == count)
+                continue;
+
+            u32 sum = 0;
+            for (u32 b = 0; b < k_buckets; ++b)
+            {
+                u32 c = offsets[b];
+                offsets[b] = sum;
+                sum += c;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                u32 o = offsets[(src_keys[i] >> shift) & (k_buckets - 1)]++;
+                dst_keys[o] = src_keys[i];
+                dst_values[o] = src_values[i];
+            }
+
+            std::swap(src_keys, dst_keys);
+            std::swap(src_values, dst_values);
+        }
+
+        if (src_keys != keys)
+        {
+            std::copy(src_keys, src_keys + count, keys);
+            std::copy(src_values, src_values + count, values);
+        }
+    }
+
+    // fills permutation with the indices of points in curve order, so permutation[i] is the source index of the
+    // point which goes at i. keys are 30 bit codes of the points quantised to 1024 cells per axis of their bounds,
+    // points sharing a cell keep their original order. hilbert order is a little more coherent than morton as it
+    // has no long jumps, but keys are slower to compute.
+    inline void spatial_sort(const vec3f* points, size_t count, std::vector<u32>& permutation,
+                             e_space_filling_curve curve)
+    {
+        permutation.resize(count);
+        if (count == 0)
+            return;
+
+        vec3f bmin = points[0];
+        vec3f bmax = points[0];
+        for (size_t i = 1; i < count; ++i)
+        {
+            bmin = min_union(bmin, points[i]);
+            bmax = max_union(bmax, points[i]);
+        }
+
+        std::vector<u32> keys(count);
+        if (curve == CURVE_HILBERT)
+            hilbert_encode(points, count, bmin, bmax, keys.data());
+        else
+            morton_encode(points, count, bmin, bmax, keys.data());
+
+        for (size_t i = 0; i < count; ++i)
+            permutation[i] = (u32)i;
+
+        radix_sort(keys.data(), permutation.data(), count, 30);
+    }
+
+    // gathers src into dst in the order of permutation, dst[i] = src[permutation[i]]. works for any attribute type,
+    // dst must not alias src.
+    template <typename T>
+    inline void reorder(const T* src, const u32* permutation, size_t count, T* dst)
+    {
+        for (size_t i = 0; i < count; ++i)
+            dst[i] = src[permutation[i]];
+    }
+
+    // inverse[permutation[i]] = i, maps an old index to its new position for remapping index buffers
+    inline void invert_permutation(const u32* permutation, size_t count, u32* inverse)
+    {
+        for (size_t i = 0; i < count; ++i)
+            inverse[permutation[i]] = (u32)i;
+    }
+}
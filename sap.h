@@ -0,0 +1,362 @@
+// sap.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+// incremental sweep and prune broadphase for moving aabbs. the min and max endpoints of every box are kept sorted on
+// each axis across updates, boxes which move a little between frames only need a few insertion sort swaps, and each
+// swap of a min past a max is where a pair can start or stop overlapping. overlapping pairs are kept in a set and
+// the changes since the last update are reported as added and removed events.
+//
+// maths::sweep_and_prune sap;
+// u32 id = maths::sap_add(sap, aabb_min, aabb_max);
+// maths::sap_move(sap, id, new_min, new_max);
+// maths::sap_update(sap);
+// for (auto& p : sap.added)
+//     begin_contact(p.a, p.b);
+
+namespace maths
+{
+    struct sap_pair
+    {
+        u32 a; // a < b
+        u32 b;
+    };
+
+    struct sap_endpoint
+    {
+        f32 value;
+        u32 key; // box id << 1 | 1 for a max endpoint
+    };
+
+    struct sap_aabb
+    {
+        vec3f aabb_min;
+        vec3f aabb_max;
+    };
+
+    struct sweep_and_prune
+    {
+        std::vector<sap_aabb>     aabbs;       // indexed by id
+        std::vector<sap_endpoint> axis[3];     // sorted endpoints on x, y and z
+        std::vector<u32>          index[3];    // position of each endpoint in axis, indexed by endpoint key
+        std::unordered_set<u64>   pairs;       // currently overlapping pairs, a << 32 | b
+        std::vector<sap_pair>     added;       // pairs which started overlapping in the last update
+        std::vector<sap_pair>     removed;     // pairs which stopped overlapping in the last update
+        std::vector<u32>          free_ids;
+        std::vector<u32>          pending;     // boxes removed since the last update
+        std::vector<u32>          moved;       // boxes moved or removed since the last update
+        size_t                    num_added = 0;
+    };
+
+    u32  sap_add(sweep_and_prune& sap, const vec3f& aabb_min, const vec3f& aabb_max);
+    void sap_remove(sweep_and_prune& sap, u32 id);
+    void sap_move(sweep_and_prune& sap, u32 id, const vec3f& aabb_min, const vec3f& aabb_max);
+    void sap_update(sweep_and_prune& sap);
+    void sap_clear(sweep_and_prune& sap);
+
+    //
+    // Implementation
+    //
+
+    maths_inline u64 sap_pair_key(u32 a, u32 b)
+    {
+        return a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a;
+    }
+
+    // mins sort before maxes with the same value, so boxes which touch are ordered as overlapping to match aabb_vs_aabb
+    maths_inline bool sap_less(const sap_endpoint& l, const sap_endpoint& r)
+    {
+        return l.value < r.value || (l.value == r.value && (l.key & 1) < (r.key & 1));
+    }
+
+    // removed boxes are inverted so they overlap nothing, including each other
+    maths_inline bool sap_removed(const sweep_and_prune& sap, u32 id)
+    {
+        return sap.aabbs[id].aabb_min.x > sap.aabbs[id].aabb_max.x;
+    }
+
+    // true if the endpoint order of a and b overlaps on the two axes other than axis
+    maths_inline bool sap_overlap_order(const sweep_and_prune& sap, u32 a, u32 b, u32 axis)
+    {
+        for (u32 k = 1; k < 3; ++k)
+        {
+            const u32* index = sap.index[(axis + k) % 3].data();
+            if (index[(a << 1) | 1] < index[b << 1] || index[(b << 1) | 1] < index[a << 1])
+                return false;
+        }
+        return true;
+    }
+
+    inline void sap_begin_overlap(sweep_and_prune& sap, u32 a, u32 b)
+    {
+        // bounds are already final on every axis, so a pair overlapping here still overlaps once all axes are sorted
+        const sap_aabb& ba = sap.aabbs[a];
+        const sap_aabb& bb = sap.aabbs[b];
+        if (!aabb_vs_aabb(ba.aabb_min, ba.aabb_max, bb.aabb_min, bb.aabb_max))
+            return;
+
+        if (sap.pairs.insert(sap_pair_key(a, b)).second)
+            sap.added.push_back({std::min(a, b), std::max(a, b)});
+    }
+
+    inline void sap_end_overlap(sweep_and_prune& sap, u32 a, u32 b)
+    {
+        if (sap.pairs.erase(sap_pair_key(a, b)))
+            sap.removed.push_back({std::min(a, b), std::max(a, b)});
+    }
+
+    inline u32 sap_add(sweep_and_prune& sap, const vec3f& aabb_min, const vec3f& aabb_max)
+    {
+        u32 id;
+        if (!sap.free_ids.empty())
+        {
+            id = sap.free_ids.back();
+            sap.free_ids.pop_back();
+        }
+        else
+        {
+            id = (u32)sap.aabbs.size();
+            sap.aabbs.push_back(sap_aabb());
+            for (u32 a = 0; a < 3; ++a)
+                sap.index[a].resize(sap.aabbs.size() * 2);
+        }
+
+        // endpoints are appended unsorted, the next update sorts them in and reports the new pairs
+        sap.aabbs[id] = {aabb_min, aabb_max};
+        for (u32 a = 0; a < 3; ++a)
+        {
+            sap.index[a][id << 1] = (u32)sap.axis[a].size();
+            sap.index[a][(id << 1) | 1] = (u32)sap.axis[a].size() + 1;
+            sap.axis[a].push_back({aabb_min[a], id << 1});
+            sap.axis[a].push_back({aabb_max[a], (id << 1) | 1});
+        }
+        ++sap.num_added;
+
+        return id;
+    }
+
+    // only stores the bounds, endpoints pick them up in sap_update. once more than a quarter of the boxes have moved
+    // the ids are no longer tracked and sap_update gathers all bounds in one pass instead.
+    inline void sap_move(sweep_and_prune& sap, u32 id, const vec3f& aabb_min, const vec3f& aabb_max)
+    {
+        sap.aabbs[id] = {aabb_min, aabb_max};
+        if (sap.moved.size() <= sap.aabbs.size() / 4)
+            sap.moved.push_back(id);
+    }
+
+    // the box is inverted so its maxes sort to the start and mins to the end of each axis, the next update reports its
+    // pairs as removed and drops its endpoints. the id can be reused by sap_add after that update.
+    inline void sap_remove(sweep_and_prune& sap, u32 id)
+    {
+        if (sap_removed(sap, id))
+            return;
+
+        sap_move(sap, id, vec3f(FLT_MAX), vec3f(-FLT_MAX));
+        sap.pending.push_back(id);
+    }
+
+    // copies the bounds of one box into its endpoints
+    inline void sap_scatter(sweep_and_prune& sap, u32 id)
+    {
+        const sap_aabb& box = sap.aabbs[id];
+        for (u32 a = 0; a < 3; ++a)
+        {
+            sap.axis[a][sap.index[a][id << 1]].value = box.aabb_min[a];
+            sap.axis[a][sap.index[a][(id << 1) | 1]].value = box.aabb_max[a];
+        }
+    }
+
+    // copies the bounds of all boxes into the endpoints of axis a
+    inline void sap_gather(sweep_and_prune& sap, u32 a)
+    {
+        static_assert(sizeof(sap_aabb) == sizeof(f32) * 6, "error: sap_aabb must be 6 packed floats");
+        const f32*    bounds = &sap.aabbs.data()->aabb_min[a];
+        sap_endpoint* axis = sap.axis[a].data();
+        size_t        n = sap.axis[a].size();
+        for (size_t i = 0; i < n; ++i)
+        {
+            u32 key = axis[i].key;
+            axis[i].value = bounds[(key >> 1) * 6 + (key & 1) * 3];
+        }
+    }
+
+    // drops the endpoints of removed boxes and frees their ids
+    inline void sap_compact(sweep_and_prune& sap)
+    {
+        for (u32 a = 0; a < 3; ++a)
+        {
+            std::vector<sap_endpoint>& axis = sap.axis[a];
+            size_t w = 0;
+            for (size_t i = 0; i < axis.size(); ++i)
+            {
+                if (sap_removed(sap, axis[i].key >> 1))
+                    continue;
+
+                axis[w] = axis[i];
+                sap.index[a][axis[i].key] = (u32)w;
+                ++w;
+            }
+            axis.resize(w);
+        }
+
+        sap.free_ids.insert(sap.free_ids.end(), sap.pending.begin(), sap.pending.end());
+        sap.pending.clear();
+    }
+
+    // full sort and sweep used when many boxes were added at once, where insertion sort would be quadratic. the
+    // new pair set is found by sweeping the x axis and diffed against the old one to produce the events.
+    inline void sap_rebuild(sweep_and_prune& sap)
+    {
+        sap_compact(sap);
+
+        for (u32 a = 0; a < 3; ++a)
+        {
+            std::vector<sap_endpoint>& axis = sap.axis[a];
+            sap_gather(sap, a);
+            std::sort(axis.begin(), axis.end(), sap_less);
+            for (size_t i = 0; i < axis.size(); ++i)
+                sap.index[a][axis[i].key] = (u32)i;
+        }
+
+        std::unordered_set<u64> pairs;
+        pairs.reserve(sap.pairs.size());
+
+        // boxes open on the sweep axis, bounds are copied in so the inner loop reads memory linearly
+        std::vector<sap_aabb> active;
+        std::vector<u32>      active_ids;
+        std::vector<u32>      active_index(sap.aabbs.size());
+        for (const sap_endpoint& e : sap.axis[0])
+        {
+            u32 id = e.key >> 1;
+            if (e.key & 1)
+            {
+                // swap remove from the active list
+                u32 i = active_index[id];
+                u32 last = active_ids.back();
+                active[i] = active.back();
+                active_ids[i] = last;
+                active_index[last] = i;
+                active.pop_back();
+                active_ids.pop_back();
+                continue;
+            }
+
+            const sap_aabb& box = sap.aabbs[id];
+            for (size_t i = 0; i < active.size(); ++i)
+            {
+                if (!aabb_vs_aabb(box.aabb_min, box.aabb_max, active[i].aabb_min, active[i].aabb_max))
+                    continue;
+
+                u32 other = active_ids[i];
+                u64 key = sap_pair_key(id, other);
+                pairs.insert(key);
+                if (!sap.pairs.count(key))
+                    sap.added.push_back({std::min(id, other), std::max(id, other)});
+            }
+
+            active_index[id] = (u32)active.size();
+            active.push_back(box);
+            active_ids.push_back(id);
+        }
+
+        for (u64 key : sap.pairs)
+            if (!pairs.count(key))
+                sap.removed.push_back({(u32)(key >> 32), (u32)(key & 0xffffffff)});
+
+        sap.pairs.swap(pairs);
+    }
+
+    // insertion sorts each axis, which is close to linear when boxes have moved a little since the last update
+    inline void sap_update(sweep_and_prune& sap)
+    {
+        sap.added.clear();
+        sap.removed.clear();
+
+        size_t num_added = sap.num_added;
+        sap.num_added = 0;
+        if (num_added > 64 && num_added * 4 > sap.axis[0].size() / 2)
+        {
+            sap.moved.clear();
+            sap_rebuild(sap);
+            return;
+        }
+
+        bool gather = sap.moved.size() > sap.aabbs.size() / 4;
+        if (!gather)
+        {
+            for (u32 id : sap.moved)
+                sap_scatter(sap, id);
+        }
+        sap.moved.clear();
+
+        for (u32 a = 0; a < 3; ++a)
+        {
+            sap_endpoint* axis = sap.axis[a].data();
+            u32*          index = sap.index[a].data();
+            size_t        n = sap.axis[a].size();
+            if (gather)
+                sap_gather(sap, a);
+
+            for (size_t i = 1; i < n; ++i)
+            {
+                if (!sap_less(axis[i], axis[i - 1]))
+                    continue;
+
+                sap_endpoint e = axis[i];
+                u32          id = e.key >> 1;
+                size_t       j = i;
+                while (j > 0 && sap_less(e, axis[j - 1]))
+                {
+                    sap_endpoint prev = axis[j - 1];
+                    u32          other = prev.key >> 1;
+
+                    // a min moving down past a max starts an overlap on this axis, a max moving past a min ends one.
+                    // a pair in the set overlaps in endpoint order on the other axes, axes already sorted would have
+                    // removed it otherwise, so the order check skips most of the set lookups
+                    if ((e.key ^ prev.key) & 1)
+                    {
+                        if (!(e.key & 1))
+                            sap_begin_overlap(sap, id, other);
+                        else if (sap_overlap_order(sap, id, other, a))
+                            sap_end_overlap(sap, id, other);
+                    }
+
+                    axis[j] = prev;
+                    index[prev.key] = (u32)j;
+                    --j;
+                }
+
+                axis[j] = e;
+                index[e.key] = (u32)j;
+            }
+        }
+
+        if (!sap.pending.empty())
+            sap_compact(sap);
+    }
+
+    inline void sap_clear(sweep_and_prune& sap)
+    {
+        sap.aabbs.clear();
+        for (u32 a = 0; a < 3; ++a)
+        {
+            sap.axis[a].clear();
+            sap.index[a].clear();
+        }
+        sap.pairs.clear();
+        sap.added.clear();
+        sap.removed.clear();
+        sap.free_ids.clear();
+        sap.pending.clear();
+        sap.moved.clear();
+        sap.num_added = 0;
+    }
+}
@@ -0,0 +1,654 @@
+// simd.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "util.h"
+#include "vec.h"
+
+// Wide<W> holds W floats which are processed together, one lane per element of a batch.
+// it is a drop in scalar type, Vec<3, Wide<8>> is 8 vec3's with one register per component and the vec free functions
+// (dot, cross, mag, normalised, lerp...) work on it. comparisons return masks with all bits of a lane set when true.
+// W = 4 is backed by sse and W = 8 by avx when MATHS_SIMD is enabled and supported, wider lanes are processed as
+// two halves and other widths use scalar loops.
+// the registers may require 32 byte alignment, keep lane types on the stack and store batches in arrays of f32 (see soa.h)
+
+template <size_t W>
+struct Wide;
+
+template <size_t W>
+struct wide_ops;
+
+template <size_t W>
+struct wide_simd
+{
+    typedef simd_none type;
+};
+
+#ifdef MATHS_SSE
+template <>
+struct wide_simd<4>
+{
+    typedef __m128 type;
+};
+#endif
+
+#ifdef MATHS_AVX
+template <>
+struct wide_simd<8>
+{
+    typedef __m256 type;
+};
+#elif defined(MATHS_SSE)
+template <>
+struct wide_simd<8>
+{
+    typedef Wide<4> type[2];
+};
+#endif
+
+#ifdef MATHS_SSE
+template <>
+struct wide_simd<16>
+{
+    typedef Wide<8> type[2];
+};
+#endif
+
+template <size_t W>
+struct Wide
+{
+    typedef wide_ops<W> ops;
+
+    union {
+        f32 v[W];
+        u32 u[W];
+        typename wide_simd<W>::type simd;
+    };
+
+    Wide() = default;
+
+    Wide(f32 value_for_all)
+    {
+        *this = ops::splat(value_for_all);
+    }
+
+    // loads and stores are unaligned
+    static Wide load(const f32* p)
+    {
+        return ops::load(p);
+    }
+
+    void store(f32* p) const
+    {
+        ops::store(p, *this);
+    }
+
+    f32& operator[](size_t index)
+    {
+        return v[index];
+    }
+
+    const f32& operator[](size_t index) const
+    {
+        return v[index];
+    }
+
+    Wide& operator+=(const Wide& rhs)
+    {
+        *this = ops::add(*this, rhs);
+        return *this;
+    }
+
+    Wide& operator-=(const Wide& rhs)
+    {
+        *this = ops::sub(*this, rhs);
+        return *this;
+    }
+
+    Wide& operator*=(const Wide& rhs)
+    {
+        *this = ops::mul(*this, rhs);
+        return *this;
+    }
+
+    Wide& operator/=(const Wide& rhs)
+    {
+        *this = ops::div(*this, rhs);
+        return *this;
+    }
+
+    // friends so scalars convert implicitly, ie. (1 - f)
+    friend Wide operator+(const Wide& a, const Wide& b) { return ops::add(a, b); }
+    friend Wide operator-(const Wide& a, const Wide& b) { return ops::sub(a, b); }
+    friend Wide operator*(const Wide& a, const Wide& b) { return ops::mul(a, b); }
+    friend Wide operator/(const Wide& a, const Wide& b) { return ops::div(a, b); }
+    friend Wide operator-(const Wide& a) { return ops::bit_xor(ops::splat(-0.0f), a); }
+
+    // masks
+    friend Wide operator<(const Wide& a, const Wide& b) { return ops::cmplt(a, b); }
+    friend Wide operator<=(const Wide& a, const Wide& b) { return ops::cmple(a, b); }
+    friend Wide operator>(const Wide& a, const Wide& b) { return ops::cmplt(b, a); }
+    friend Wide operator>=(const Wide& a, const Wide& b) { return ops::cmple(b, a); }
+    friend Wide operator==(const Wide& a, const Wide& b) { return ops::cmpeq(a, b); }
+    friend Wide operator!=(const Wide& a, const Wide& b) { return ops::cmpneq(a, b); }
+    friend Wide operator&(const Wide& a, const Wide& b) { return ops::bit_and(a, b); }
+    friend Wide operator|(const Wide& a, const Wide& b) { return ops::bit_or(a, b); }
+    friend Wide operator^(const Wide& a, const Wide& b) { return ops::bit_xor(a, b); }
+
+    // ~a & b
+    friend Wide andnot(const Wide& a, const Wide& b) { return ops::bit_andnot(a, b); }
+
+    // per lane mask ? a : b
+    friend Wide select(const Wide& mask, const Wide& a, const Wide& b) { return ops::select(mask, a, b); }
+
+    // bit i is set if lane i of mask is set
+    friend u32 movemask(const Wide& mask) { return ops::movemask(mask); }
+
+    friend bool any(const Wide& mask) { return ops::movemask(mask) != 0; }
+    friend bool all(const Wide& mask) { return ops::movemask(mask) == (u32)((1ull << W) - 1); }
+
+    // a * b + c
+    friend Wide fmadd(const Wide& a, const Wide& b, const Wide& c) { return ops::fmadd(a, b, c); }
+
+    friend Wide min(const Wide& a, const Wide& b) { return ops::min(a, b); }
+    friend Wide max(const Wide& a, const Wide& b) { return ops::max(a, b); }
+    friend Wide sqrt(const Wide& a) { return ops::sqrt(a); }
+    friend Wide floor(const Wide& a) { return ops::floor(a); }
+    friend Wide abs(const Wide& a) { return ops::bit_andnot(ops::splat(-0.0f), a); }
+    friend Wide fabs(const Wide& a) { return ops::bit_andnot(ops::splat(-0.0f), a); }
+};
+
+// scalar implementation
+template <size_t W>
+struct wide_ops
+{
+    typedef Wide<W> wide;
+
+    #define WIDE_LANES(EXPR)        \
+        wide r;                     \
+        for (size_t i = 0; i < W; ++i) \
+            EXPR;                   \
+        return r
+
+    #define WIDE_MASK(COND) (COND) ? 0xffffffff : 0
+
+    static maths_inline wide splat(f32 a) { WIDE_LANES(r.v[i] = a); }
+    static maths_inline wide load(const f32* p) { WIDE_LANES(r.v[i] = p[i]); }
+    static maths_inline wide add(const wide& a, const wide& b) { WIDE_LANES(r.v[i] = a.v[i] + b.v[i]); }
+    static maths_inline wide sub(const wide& a, const wide& b) { WIDE_LANES(r.v[i] = a.v[i] - b.v[i]); }
+    static maths_inline wide mul(const wide& a, const wide& b) { WIDE_LANES(r.v[i] = a.v[i] * b.v[i]); }
+    static maths_inline wide div(const wide& a, const wide& b) { WIDE_LANES(r.v[i] = a.v[i] / b.v[i]); }
+    static maths_inline wide fmadd(const wide& a, const wide& b, const wide& c) { WIDE_LANES(r.v[i] = a.v[i] * b.v[i] + c.v[i]); }
+    static maths_inline wide min(const wide& a, const wide& b) { WIDE_LANES(r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+    static maths_inline wide max(const wide& a, const wide& b) { WIDE_LANES(r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+    static maths_inline wide sqrt(const wide& a) { WIDE_LANES(r.v[i] = std::sqrt(a.v[i])); }
+    static maths_inline wide floor(const wide& a) { WIDE_LANES(r.v[i] = std::floor(a.v[i])); }
+    static maths_inline wide cmplt(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = WIDE_MASK(a.v[i] < b.v[i])); }
+    static maths_inline wide cmple(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = WIDE_MASK(a.v[i] <= b.v[i])); }
+    static maths_inline wide cmpeq(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = WIDE_MASK(a.v[i] == b.v[i])); }
+    static maths_inline wide cmpneq(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = WIDE_MASK(a.v[i] != b.v[i])); }
+    static maths_inline wide bit_and(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = a.u[i] & b.u[i]); }
+    static maths_inline wide bit_or(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = a.u[i] | b.u[i]); }
+    static maths_inline wide bit_xor(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = a.u[i] ^ b.u[i]); }
+    static maths_inline wide bit_andnot(const wide& a, const wide& b) { WIDE_LANES(r.u[i] = ~a.u[i] & b.u[i]); }
+    static maths_inline wide select(const wide& m, const wide& a, const wide& b) { WIDE_LANES(r.u[i] = (a.u[i] & m.u[i]) | (b.u[i] & ~m.u[i])); }
+
+    #undef WIDE_LANES
+    #undef WIDE_MASK
+
+    static maths_inline void store(f32* p, const wide& a)
+    {
+        for (size_t i = 0; i < W; ++i)
+            p[i] = a.v[i];
+    }
+
+    static maths_inline u32 movemask(const wide& m)
+    {
+        u32 bits = 0;
+        for (size_t i = 0; i < W; ++i)
+            bits |= (m.u[i] >> 31) << i;
+        return bits;
+    }
+};
+
+#ifdef MATHS_SSE
+template <>
+struct wide_ops<4>
+{
+    typedef Wide<4> wide;
+
+    static maths_inline wide make(__m128 s)
+    {
+        wide r;
+        r.simd = s;
+        return r;
+    }
+
+    static maths_inline wide splat(f32 a) { return make(_mm_set1_ps(a)); }
+    static maths_inline wide load(const f32* p) { return make(_mm_loadu_ps(p)); }
+    static maths_inline void store(f32* p, const wide& a) { _mm_storeu_ps(p, a.simd); }
+    static maths_inline wide add(const wide& a, const wide& b) { return make(_mm_add_ps(a.simd, b.simd)); }
+    static maths_inline wide sub(const wide& a, const wide& b) { return make(_mm_sub_ps(a.simd, b.simd)); }
+    static maths_inline wide mul(const wide& a, const wide& b) { return make(_mm_mul_ps(a.simd, b.simd)); }
+    static maths_inline wide div(const wide& a, const wide& b) { return make(_mm_div_ps(a.simd, b.simd)); }
+    static maths_inline wide min(const wide& a, const wide& b) { return make(_mm_min_ps(a.simd, b.simd)); }
+    static maths_inline wide max(const wide& a, const wide& b) { return make(_mm_max_ps(a.simd, b.simd)); }
+    static maths_inline wide sqrt(const wide& a) { return make(_mm_sqrt_ps(a.simd)); }
+    static maths_inline wide floor(const wide& a) { return make(_mm_floor_ps(a.simd)); }
+    static maths_inline wide cmplt(const wide& a, const wide& b) { return make(_mm_cmplt_ps(a.simd, b.simd)); }
+    static maths_inline wide cmple(const wide& a, const wide& b) { return make(_mm_cmple_ps(a.simd, b.simd)); }
+    static maths_inline wide cmpeq(const wide& a, const wide& b) { return make(_mm_cmpeq_ps(a.simd, b.simd)); }
+    static maths_inline wide cmpneq(const wide& a, const wide& b) { return make(_mm_cmpneq_ps(a.simd, b.simd)); }
+    static maths_inline wide bit_and(const wide& a, const wide& b) { return make(_mm_and_ps(a.simd, b.simd)); }
+    static maths_inline wide bit_or(const wide& a, const wide& b) { return make(_mm_or_ps(a.simd, b.simd)); }
+    static maths_inline wide bit_xor(const wide& a, const wide& b) { return make(_mm_xor_ps(a.simd, b.simd)); }
+    static maths_inline wide bit_andnot(const wide& a, const wide& b) { return make(_mm_andnot_ps(a.simd, b.simd)); }
+    static maths_inline wide select(const wide& m, const wide& a, const wide& b) { return make(_mm_blendv_ps(b.simd, a.simd, m.simd)); }
+    static maths_inline u32  movemask(const wide& m) { return (u32)_mm_movemask_ps(m.simd); }
+
+    static maths_inline wide fmadd(const wide& a, const wide& b, const wide& c)
+    {
+#ifdef MATHS_FMA
+        return make(_mm_fmadd_ps(a.simd, b.simd, c.simd));
+#else
+        return make(_mm_add_ps(_mm_mul_ps(a.simd, b.simd), c.simd));
+#endif
+    }
+};
+#endif
+
+#ifdef MATHS_AVX
+template <>
+struct wide_ops<8>
+{
+    typedef Wide<8> wide;
+
+    static maths_inline wide make(__m256 s)
+    {
+        wide r;
+        r.simd = s;
+        return r;
+    }
+
+    static maths_inline wide splat(f32 a) { return make(_mm256_set1_ps(a)); }
+    static maths_inline wide load(const f32* p) { return make(_mm256_loadu_ps(p)); }
+    static maths_inline void store(f32* p, const wide& a) { _mm256_storeu_ps(p, a.simd); }
+    static maths_inline wide add(const wide& a, const wide& b) { return make(_mm256_add_ps(a.simd, b.simd)); }
+    static maths_inline wide sub(const wide& a, const wide& b) { return make(_mm256_sub_ps(a.simd, b.simd)); }
+    static maths_inline wide mul(const wide& a, const wide& b) { return make(_mm256_mul_ps(a.simd, b.simd)); }
+    static maths_inline wide div(const wide& a, const wide& b) { return make(_mm256_div_ps(a.simd, b.simd)); }
+    static maths_inline wide min(const wide& a, const wide& b) { return make(_mm256_min_ps(a.simd, b.simd)); }
+    static maths_inline wide max(const wide& a, const wide& b) { return make(_mm256_max_ps(a.simd, b.simd)); }
+    static maths_inline wide sqrt(const wide& a) { return make(_mm256_sqrt_ps(a.simd)); }
+    static maths_inline wide floor(const wide& a) { return make(_mm256_floor_ps(a.simd)); }
+    static maths_inline wide cmplt(const wide& a, const wide& b) { return make(_mm256_cmp_ps(a.simd, b.simd, _CMP_LT_OQ)); }
+    static maths_inline wide cmple(const wide& a, const wide& b) { return make(_mm256_cmp_ps(a.simd, b.simd, _CMP_LE_OQ)); }
+    static maths_inline wide cmpeq(const wide& a, const wide& b) { return make(_mm256_cmp_ps(a.simd, b.simd, _CMP_EQ_OQ)); }
+    static maths_inline wide cmpneq(const wide& a, const wide& b) { return make(_mm256_cmp_ps(a.simd, b.simd, _CMP_NEQ_UQ)); }
+    static maths_inline wide bit_and(const wide& a, const wide& b) { return make(_mm256_and_ps(a.simd, b.simd)); }
+    static maths_inline wide bit_or(const wide& a, const wide& b) { return make(_mm256_or_ps(a.simd, b.simd)); }
+    static maths_inline wide bit_xor(const wide& a, const wide& b) { return make(_mm256_xor_ps(a.simd, b.simd)); }
+    static maths_inline wide bit_andnot(const wide& a, const wide& b) { return make(_mm256_andnot_ps(a.simd, b.simd)); }
+    static maths_inline wide select(const wide& m, const wide& a, const wide& b) { return make(_mm256_blendv_ps(b.simd, a.simd, m.simd)); }
+    static maths_inline u32  movemask(const wide& m) { return (u32)_mm256_movemask_ps(m.simd); }
+
+    static maths_inline wide fmadd(const wide& a, const wide& b, const wide& c)
+    {
+#ifdef MATHS_FMA
+        return make(_mm256_fmadd_ps(a.simd, b.simd, c.simd));
+#else
+        return make(_mm256_add_ps(_mm256_mul_ps(a.simd, b.simd), c.simd));
+#endif
+    }
+};
+#endif
+
+// lanes wider than the isa, simd holds two halves
+template <size_t W>
+struct wide_ops_split
+{
+    typedef Wide<W>         wide;
+    typedef wide_ops<W / 2> half;
+
+    #define WIDE_SPLIT_1(NAME)                                             \
+        static maths_inline wide NAME(const wide& a)                       \
+        {                                                                  \
+            wide r;                                                        \
+            r.simd[0] = half::NAME(a.simd[0]);                             \
+            r.simd[1] = half::NAME(a.simd[1]);                             \
+            return r;                                                      \
+        }
+
+    #define WIDE_SPLIT_2(NAME)                                             \
+        static maths_inline wide NAME(const wide& a, const wide& b)        \
+        {                                                                  \
+            wide r;                                                        \
+            r.simd[0] = half::NAME(a.simd[0], b.simd[0]);                  \
+            r.simd[1] = half::NAME(a.simd[1], b.simd[1]);                  \
+            return r;                                                      \
+        }
+
+    #define WIDE_SPLIT_3(NAME)                                             \
+        static maths_inline wide NAME(const wide& a, const wide& b, const wide& c) \
+        {                                                                  \
+            wide r;                                                        \
+            r.simd[0] = half::NAME(a.simd[0], b.simd[0], c.simd[0]);       \
+            r.simd[1] = half::NAME(a.simd[1], b.simd[1], c.simd[1]);       \
+            return r;                                                      \
+        }
+
+    WIDE_SPLIT_2(add)
+    WIDE_SPLIT_2(sub)
+    WIDE_SPLIT_2(mul)
+    WIDE_SPLIT_2(div)
+    WIDE_SPLIT_3(fmadd)
+    WIDE_SPLIT_2(min)
+    WIDE_SPLIT_2(max)
+    WIDE_SPLIT_1(sqrt)
+    WIDE_SPLIT_1(floor)
+    WIDE_SPLIT_2(cmplt)
+    WIDE_SPLIT_2(cmple)
+    WIDE_SPLIT_2(cmpeq)
+    WIDE_SPLIT_2(cmpneq)
+    WIDE_SPLIT_2(bit_and)
+    WIDE_SPLIT_2(bit_or)
+    WIDE_SPLIT_2(bit_xor)
+    WIDE_SPLIT_2(bit_andnot)
+    WIDE_SPLIT_3(select)
+
+    #undef WIDE_SPLIT_1
+    #undef WIDE_SPLIT_2
+    #undef WIDE_SPLIT_3
+
+    static maths_inline wide splat(f32 a)
+    {
+        wide r;
+        r.simd[0] = half::splat(a);
+        r.simd[1] = r.simd[0];
+        return r;
+    }
+
+    static maths_inline wide load(const f32* p)
+    {
+        wide r;
+        r.simd[0] = half::load(p);
+        r.simd[1] = half::load(p + W / 2);
+        return r;
+    }
+
+    static maths_inline void store(f32* p, const wide& a)
+    {
+        half::store(p, a.simd[0]);
+        half::store(p + W / 2, a.simd[1]);
+    }
+
+    static maths_inline u32 movemask(const wide& m)
+    {
+        return half::movemask(m.simd[0]) | (half::movemask(m.simd[1]) << (W / 2));
+    }
+};
+
+#if defined(MATHS_SSE) && !defined(MATHS_AVX)
+template <>
+struct wide_ops<8> : wide_ops_split<8>
+{
+};
+#endif
+
+#ifdef MATHS_SSE
+template <>
+struct wide_ops<16> : wide_ops_split<16>
+{
+};
+#endif
+
+//
+// vec free functions which branch per component, overloaded for lanes to use masks instead
+//
+
+template <size_t N, size_t W>
+maths_inline Vec<N, Wide<W>> min_union(const Vec<N, Wide<W>>& a, const Vec<N, Wide<W>>& b)
+{
+    Vec<N, Wide<W>> m;
+    for (size_t i = 0; i < N; ++i)
+        m.v[i] = min(a.v[i], b.v[i]);
+    return m;
+}
+
+template <size_t N, size_t W>
+maths_inline Vec<N, Wide<W>> max_union(const Vec<N, Wide<W>>& a, const Vec<N, Wide<W>>& b)
+{
+    Vec<N, Wide<W>> m;
+    for (size_t i = 0; i < N; ++i)
+        m.v[i] = max(a.v[i], b.v[i]);
+    return m;
+}
+
+template <size_t N, size_t W>
+maths_inline Vec<N, Wide<W>> clamp(const Vec<N, Wide<W>>& a, Wide<W> lower, Wide<W> upper)
+{
+    Vec<N, Wide<W>> res;
+    for (size_t i = 0; i < N; ++i)
+        res.v[i] = min(max(a.v[i], lower), upper);
+    return res;
+}
+
+template <size_t N, size_t W>
+maths_inline Vec<N, Wide<W>> clamp(const Vec<N, Wide<W>>& a, const Vec<N, Wide<W>>& lower, const Vec<N, Wide<W>>& upper)
+{
+    Vec<N, Wide<W>> res;
+    for (size_t i = 0; i < N; ++i)
+        res.v[i] = min(max(a.v[i], lower.v[i]), upper.v[i]);
+    return res;
+}
+
+// returns a mask of lanes where the vectors are equal
+template <size_t N, size_t W>
+maths_inline Wide<W> equals(const Vec<N, Wide<W>>& lhs, const Vec<N, Wide<W>>& rhs)
+{
+    Wide<W> m = lhs.v[0] == rhs.v[0];
+    for (size_t i = 1; i < N; ++i)
+        m = m & (lhs.v[i] == rhs.v[i]);
+    return m;
+}
+
+template <size_t N, size_t W>
+maths_inline Vec<N, Wide<W>> select(const Wide<W>& mask, const Vec<N, Wide<W>>& a, const Vec<N, Wide<W>>& b)
+{
+    Vec<N, Wide<W>> res;
+    for (size_t i = 0; i < N; ++i)
+        res.v[i] = select(mask, a.v[i], b.v[i]);
+    return res;
+}
+
+// broadcast a single vec into all lanes
+template <size_t W, size_t N>
+maths_inline Vec<N, Wide<W>> splat(const Vec<N, f32>& v)
+{
+    Vec<N, Wide<W>> res;
+    for (size_t i = 0; i < N; ++i)
+        res.v[i] = Wide<W>(v.v[i]);
+    return res;
+}
+
+// transpose count vecs from an array of structures into lanes, lanes past count repeat v[0] so they hold valid values
+template <size_t W, size_t N>
+maths_inline Vec<N, Wide<W>> gather(const Vec<N, f32>* v, size_t count = W)
+{
+    Vec<N, Wide<W>> res;
+    for (size_t l = 0; l < W; ++l)
+        for (size_t i = 0; i < N; ++i)
+            res.v[i].v[l] = v[l < count ? l : 0].v[i];
+    return res;
+}
+
+// extract lane of a wide vec
+template <size_t N, size_t W>
+maths_inline Vec<N, f32> lane(const Vec<N, Wide<W>>& v, size_t lane_index)
+{
+    Vec<N, f32> res;
+    for (size_t i = 0; i < N; ++i)
+        res.v[i] = v.v[i].v[lane_index];
+    return res;
+}
+
+// writes 4 components of count lanes as 4 contiguous floats per lane at out + lane * stride, the transpose of storing
+// each component. for writing lanes back to an array of structures, such as the rows of matrices
+template <size_t W>
+maths_inline void store_transposed4(const Wide<W>* v, f32* out, size_t stride, size_t count = W)
+{
+    for (size_t l = 0; l < count; ++l)
+        for (size_t i = 0; i < 4; ++i)
+            out[l * stride + i] = v[i].v[l];
+}
+
+// loads 4 contiguous floats from p[lane] for each lane into 4 components, the inverse of store_transposed4 with a
+// pointer per lane so elements can be gathered from anywhere, such as through an index
+template <size_t W>
+maths_inline void load_transposed4(const f32* const* p, Wide<W>* v)
+{
+    for (size_t l = 0; l < W; ++l)
+        for (size_t i = 0; i < 4; ++i)
+            v[i].v[l] = p[l][i];
+}
+
+#ifdef MATHS_SSE
+maths_inline void store_transposed4(const Wide<4>* v, f32* out, size_t stride, size_t count = 4)
+{
+    if (count < 4)
+    {
+        store_transposed4<4>(v, out, stride, count);
+        return;
+    }
+
+    __m128 r0 = v[0].simd, r1 = v[1].simd, r2 = v[2].simd, r3 = v[3].simd;
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(out, r0);
+    _mm_storeu_ps(out + stride, r1);
+    _mm_storeu_ps(out + stride * 2, r2);
+    _mm_storeu_ps(out + stride * 3, r3);
+}
+
+maths_inline void load_transposed4(const f32* const* p, Wide<4>* v)
+{
+    __m128 r0 = _mm_loadu_ps(p[0]), r1 = _mm_loadu_ps(p[1]), r2 = _mm_loadu_ps(p[2]), r3 = _mm_loadu_ps(p[3]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    v[0].simd = r0;
+    v[1].simd = r1;
+    v[2].simd = r2;
+    v[3].simd = r3;
+}
+
+// lanes split into two halves
+template <size_t W>
+maths_inline void load_transposed4_split(const f32* const* p, Wide<W>* v)
+{
+    const size_t h = W / 2;
+    Wide<h>      lo[4], hi[4];
+    load_transposed4(p, lo);
+    load_transposed4(p + h, hi);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        v[i].simd[0] = lo[i];
+        v[i].simd[1] = hi[i];
+    }
+}
+
+template <size_t W>
+maths_inline void store_transposed4_split(const Wide<W>* v, f32* out, size_t stride, size_t count)
+{
+    const size_t h = W / 2;
+    Wide<h>      lo[4], hi[4];
+    for (size_t i = 0; i < 4; ++i)
+    {
+        lo[i] = v[i].simd[0];
+        hi[i] = v[i].simd[1];
+    }
+    store_transposed4(lo, out, stride, std::min(count, h));
+    if (count > h)
+        store_transposed4(hi, out + h * stride, stride, count - h);
+}
+
+maths_inline void store_transposed4(const Wide<16>* v, f32* out, size_t stride, size_t count = 16)
+{
+    store_transposed4_split<16>(v, out, stride, count);
+}
+
+maths_inline void load_transposed4(const f32* const* p, Wide<16>* v)
+{
+    load_transposed4_split<16>(p, v);
+}
+#endif
+
+#ifdef MATHS_AVX
+// 4x4 transposes within each 128 bit half, the low half holds lanes 0-3 and the high half lanes 4-7
+maths_inline void store_transposed4(const Wide<8>* v, f32* out, size_t stride, size_t count = 8)
+{
+    if (count < 8)
+    {
+        store_transposed4<8>(v, out, stride, count);
+        return;
+    }
+
+    __m256 t0 = _mm256_unpacklo_ps(v[0].simd, v[1].simd);
+    __m256 t1 = _mm256_unpackhi_ps(v[0].simd, v[1].simd);
+    __m256 t2 = _mm256_unpacklo_ps(v[2].simd, v[3].simd);
+    __m256 t3 = _mm256_unpackhi_ps(v[2].simd, v[3].simd);
+    __m256 r0 = _mm256_shuffle_ps(t0, t2, 0x44);
+    __m256 r1 = _mm256_shuffle_ps(t0, t2, 0xee);
+    __m256 r2 = _mm256_shuffle_ps(t1, t3, 0x44);
+    __m256 r3 = _mm256_shuffle_ps(t1, t3, 0xee);
+    _mm_storeu_ps(out, _mm256_castps256_ps128(r0));
+    _mm_storeu_ps(out + stride, _mm256_castps256_ps128(r1));
+    _mm_storeu_ps(out + stride * 2, _mm256_castps256_ps128(r2));
+    _mm_storeu_ps(out + stride * 3, _mm256_castps256_ps128(r3));
+    _mm_storeu_ps(out + stride * 4, _mm256_extractf128_ps(r0, 1));
+    _mm_storeu_ps(out + stride * 5, _mm256_extractf128_ps(r1, 1));
+    _mm_storeu_ps(out + stride * 6, _mm256_extractf128_ps(r2, 1));
+    _mm_storeu_ps(out + stride * 7, _mm256_extractf128_ps(r3, 1));
+}
+
+// lanes 0-3 in the low halves and 4-7 in the high halves, then 4x4 transposes within each half
+maths_inline void load_transposed4(const f32* const* p, Wide<8>* v)
+{
+    __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[0])), _mm_loadu_ps(p[4]), 1);
+    __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[1])), _mm_loadu_ps(p[5]), 1);
+    __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[2])), _mm_loadu_ps(p[6]), 1);
+    __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[3])), _mm_loadu_ps(p[7]), 1);
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    v[0].simd = _mm256_shuffle_ps(t0, t2, 0x44);
+    v[1].simd = _mm256_shuffle_ps(t0, t2, 0xee);
+    v[2].simd = _mm256_shuffle_ps(t1, t3, 0x44);
+    v[3].simd = _mm256_shuffle_ps(t1, t3, 0xee);
+}
+#elif defined(MATHS_SSE)
+maths_inline void store_transposed4(const Wide<8>* v, f32* out, size_t stride, size_t count = 8)
+{
+    store_transposed4_split<8>(v, out, stride, count);
+}
+
+maths_inline void load_transposed4(const f32* const* p, Wide<8>* v)
+{
+    load_transposed4_split<8>(p, v);
+}
+#endif
+
+//
+// abbreviations
+//
+
+typedef Wide<4>  f32x4;
+typedef Wide<8>  f32x8;
+typedef Wide<16> f32x16;
+
+typedef Vec<2, f32x4> vec2f_x4;
+typedef Vec<3, f32x4> vec3f_x4;
+typedef Vec<4, f32x4> vec4f_x4;
+typedef Vec<2, f32x8> vec2f_x8;
+typedef Vec<3, f32x8> vec3f_x8;
+typedef Vec<4, f32x8> vec4f_x8;
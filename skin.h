@@ -0,0 +1,171 @@
+// skin.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "maths.h"
+
+// dual quaternion skinning of vertices with up to 4 bone influences. the bone transforms of each vertex are blended
+// as dual quaternions, which stays a rigid transform where blended matrices collapse towards the joint when it
+// twists, the candy wrapper artefact. W vertices are skinned per iteration, the dual quaternions of each influence
+// are gathered from the bones with transposing loads and batches of vertices are split across threads.
+//
+// bones are the skinning transforms, the world transform of each bone multiplied by its inverse bind pose, and
+// bone_indices holds 4 per vertex. unused influences have a weight of 0 and any valid index.
+//
+// for (size_t i = 0; i < num_bones; ++i)
+//     bones[i] = maths::get_dual_quat_from_transform(skinning_transforms[i]);
+// maths::skin_dual_quat(bones.data(), bone_indices.data(), weights, positions, normals, out_positions, out_normals);
+
+namespace maths
+{
+    static const size_t k_skin_max_influences = 4;
+
+    template <size_t W = 8>
+    void skin_dual_quat(const dual_quat* bones, const u32* bone_indices, const soa4f& weights, const soa3f& positions,
+                        soa3f& out_positions, u32 max_threads = 0);
+    template <size_t W = 8>
+    void skin_dual_quat(const dual_quat* bones, const u32* bone_indices, const soa4f& weights, const soa3f& positions,
+                        const soa3f& normals, soa3f& out_positions, soa3f& out_normals, u32 max_threads = 0);
+
+    //
+    // Implementation
+    //
+
+    // blends the bones of W vertices starting at i into a unit dual quaternion per lane, as blend in quat.h. lanes
+    // past count gather the bones of the last vertex and their weights are zeroed, as the padding of weights may
+    // hold anything. the dual part is not made orthogonal to the real part as transforming points does not need it.
+    template <size_t W>
+    inline void skin_blend_lanes(const dual_quat* bones, const u32* bone_indices, const soa4f& weights, size_t i,
+                                 size_t count, Vec<4, Wide<W>>& real, Vec<4, Wide<W>>& dual)
+    {
+        static_assert(sizeof(dual_quat) == 8 * sizeof(f32), "error: dual_quat must be 8 packed floats");
+
+        const u32* vi[W];
+        for (size_t j = 0; j < W; ++j)
+            vi[j] = bone_indices + std::min(i + j, count - 1) * k_skin_max_influences;
+
+        Vec<4, Wide<W>> w = weights.load<W>(i);
+        if (i + W > count)
+        {
+            f32 lane[W];
+            for (size_t j = 0; j < W; ++j)
+                lane[j] = (f32)j;
+            Wide<W> live = Wide<W>::load(lane) < Wide<W>((f32)(count - i));
+            for (size_t k = 0; k < k_skin_max_influences; ++k)
+                w[k] = select(live, w[k], Wide<W>(0.0f));
+        }
+
+        Vec<4, Wide<W>> r0;
+        for (size_t k = 0; k < k_skin_max_influences; ++k)
+        {
+            const f32* pr[W];
+            const f32* pd[W];
+            for (size_t j = 0; j < W; ++j)
+            {
+                const dual_quat& b = bones[vi[j][k]];
+                pr[j] = b.real.v;
+                pd[j] = b.dual.v;
+            }
+
+            Vec<4, Wide<W>> r, d;
+            load_transposed4(pr, r.v);
+            load_transposed4(pd, d.v);
+
+            Wide<W> wk = w[k];
+            if (k == 0)
+            {
+                r0 = r;
+                real = r * wk;
+                dual = d * wk;
+                continue;
+            }
+
+            // flip into the hemisphere of the first influence
+            wk = wk ^ ((dot(r, r0) < Wide<W>(0.0f)) & Wide<W>(-0.0f));
+            for (size_t c = 0; c < 4; ++c)
+            {
+                real[c] = fmadd(r[c], wk, real[c]);
+                dual[c] = fmadd(d[c], wk, dual[c]);
+            }
+        }
+
+        // zero weights give zero rather than nan
+        Wide<W> inv_len = Wide<W>(1.0f) / sqrt(max(dot(real, real), Wide<W>(FLT_MIN)));
+        for (size_t c = 0; c < 4; ++c)
+        {
+            real[c] *= inv_len;
+            dual[c] *= inv_len;
+        }
+    }
+
+    // rotates v by the real part of unit dual quaternions, as DualQuat::transform_vector
+    template <size_t W>
+    maths_inline Vec<3, Wide<W>> skin_rotate(const Vec<4, Wide<W>>& real, const Vec<3, Wide<W>>& v)
+    {
+        Vec<3, Wide<W>> r = Vec<3, Wide<W>>(real.x, real.y, real.z);
+        Vec<3, Wide<W>> c = cross(r, v);
+        for (size_t i = 0; i < 3; ++i)
+            c[i] = fmadd(v[i], real.w, c[i]);
+        return v + cross(r, c) * Wide<W>(2.0f);
+    }
+
+    // translation of unit dual quaternions, as DualQuat::get_translation
+    template <size_t W>
+    maths_inline Vec<3, Wide<W>> skin_translation(const Vec<4, Wide<W>>& real, const Vec<4, Wide<W>>& dual)
+    {
+        Vec<3, Wide<W>> r = Vec<3, Wide<W>>(real.x, real.y, real.z);
+        Vec<3, Wide<W>> d = Vec<3, Wide<W>>(dual.x, dual.y, dual.z);
+        return (d * real.w - r * dual.w + cross(r, d)) * Wide<W>(2.0f);
+    }
+
+    // skins vertices in batches of W, split into ranges of whole batches across threads so no two threads store
+    // to the same batch
+    template <size_t W>
+    inline void skin_batches(const dual_quat* bones, const u32* bone_indices, const soa4f& weights,
+                             const soa3f& positions, const soa3f* normals, soa3f& out_positions, soa3f* out_normals,
+                             u32 max_threads)
+    {
+        static_assert(32 % W == 0 && W <= k_soa_pad, "error: batch width must be a power of 2 and <= 16");
+
+        size_t n = positions.size();
+        out_positions.resize(n);
+        if (out_normals)
+            out_normals->resize(n);
+        if (n == 0)
+            return;
+
+        static const size_t k_min_range = (1 << 12) / W;
+        parallel_for(positions.batches<W>(), k_min_range, [&](u32, size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b)
+            {
+                size_t          i = b * W;
+                Vec<4, Wide<W>> real, dual;
+                skin_blend_lanes<W>(bones, bone_indices, weights, i, n, real, dual);
+
+                out_positions.store(i, skin_rotate(real, positions.load<W>(i)) + skin_translation(real, dual));
+                if (normals)
+                    out_normals->store(i, skin_rotate(real, normals->load<W>(i)));
+            }
+        }, max_threads);
+    }
+
+    // skins positions into out_positions, resized to match. weights of each vertex in components 0 to 3 are for the
+    // bones at bone_indices[vertex * 4 + 0 to 3].
+    template <size_t W>
+    inline void skin_dual_quat(const dual_quat* bones, const u32* bone_indices, const soa4f& weights,
+                               const soa3f& positions, soa3f& out_positions, u32 max_threads)
+    {
+        skin_batches<W>(bones, bone_indices, weights, positions, nullptr, out_positions, nullptr, max_threads);
+    }
+
+    // skins positions and normals together, normals are rotated only and stay unit length
+    template <size_t W>
+    inline void skin_dual_quat(const dual_quat* bones, const u32* bone_indices, const soa4f& weights,
+                               const soa3f& positions, const soa3f& normals, soa3f& out_positions, soa3f& out_normals,
+                               u32 max_threads)
+    {
+        skin_batches<W>(bones, bone_indices, weights, positions, &normals, out_positions, &out_normals, max_threads);
+    }
+}
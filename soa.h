@@ -0,0 +1,138 @@
+// soa.h
+// Copyright 2014 - 2020 Alex Dixon.
+// License: https://github.com/polymonster/maths/blob/master/license.md
+
+#pragma once
+
+#include "simd.h"
+
+#include <algorithm>
+#include <vector>
+
+// structure of arrays storage for batches of N component vectors, each component is stored contiguously so a
+// batch of W elements loads as one Wide<W> per component. components are padded to a multiple of k_soa_pad so
+// lanes can be loaded past size() on the last batch without reading out of bounds. resize zeroes the padding but
+// store writes whole batches into it, so kernels must ignore the values of lanes past size().
+//
+// soa3f pos(points);
+// for(size_t i = 0; i < pos.size(); i += 8)
+// {
+//     vec3f_x8 p = pos.load<8>(i);
+//     pos.store(i, normalised(p));
+// }
+// pos.to_aos(points);
+
+static const size_t k_soa_pad = 16;
+
+template <size_t N>
+struct Soa
+{
+    std::vector<f32> c[N];
+    size_t           count = 0;
+
+    Soa()
+    {
+    }
+
+    Soa(size_t n)
+    {
+        resize(n);
+    }
+
+    Soa(const std::vector<Vec<N, f32>>& aos)
+    {
+        from_aos(aos);
+    }
+
+    // new elements and the padding are zeroed
+    void resize(size_t n)
+    {
+        size_t first = std::min(count, n);
+        count = n;
+        size_t padded = ((n + k_soa_pad - 1) / k_soa_pad) * k_soa_pad;
+        for (size_t i = 0; i < N; ++i)
+        {
+            c[i].resize(padded, 0.0f);
+            std::fill(c[i].begin() + first, c[i].end(), 0.0f);
+        }
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    // number of batches of width W required to cover size()
+    template <size_t W>
+    size_t batches() const
+    {
+        return (count + W - 1) / W;
+    }
+
+    Vec<N, f32> get(size_t i) const
+    {
+        Vec<N, f32> r;
+        for (size_t j = 0; j < N; ++j)
+            r.v[j] = c[j][i];
+        return r;
+    }
+
+    void set(size_t i, const Vec<N, f32>& v)
+    {
+        for (size_t j = 0; j < N; ++j)
+            c[j][i] = v.v[j];
+    }
+
+    // load lanes i to i + W
+    template <size_t W>
+    Vec<N, Wide<W>> load(size_t i) const
+    {
+        Vec<N, Wide<W>> r;
+        for (size_t j = 0; j < N; ++j)
+            r.v[j] = Wide<W>::load(&c[j][i]);
+        return r;
+    }
+
+    // store lanes i to i + W, lanes past size() write whatever they hold into the padding
+    template <size_t W>
+    void store(size_t i, const Vec<N, Wide<W>>& v)
+    {
+        for (size_t j = 0; j < N; ++j)
+            v.v[j].store(&c[j][i]);
+    }
+
+    f32* component(size_t j)
+    {
+        return c[j].data();
+    }
+
+    const f32* component(size_t j) const
+    {
+        return c[j].data();
+    }
+
+    void from_aos(const std::vector<Vec<N, f32>>& aos)
+    {
+        resize(aos.size());
+        for (size_t i = 0; i < count; ++i)
+            set(i, aos[i]);
+    }
+
+    void to_aos(std::vector<Vec<N, f32>>& aos) const
+    {
+        aos.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            aos[i] = get(i);
+    }
+};
+
+//
+// abbreviations
+//
+
+typedef Soa<2> soa2f;
+typedef Soa<3> soa3f;
+typedef Soa<4> soa4f;
+typedef Soa<9> soa_mat3f;  // 3x3 matrices, component r * 3 + c
+typedef Soa<16> soa_mat4f; // 4x4 matrices, component r * 4 + c, set with Vec<16, f32>(mat.m)
+typedef Soa<4> soa_quatf;   // quaternions, components x, y, z, w
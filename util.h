@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <float.h>
 #include <iostream>
 #include <vector>
@@ -23,6 +24,49 @@
 #endif
 #endif
 
+// simd is opt-in, define MATHS_SIMD before including to enable sse / avx code paths.
+// paths are only taken when the isa is enabled for the target (-msse4.1, -mavx2, /arch:AVX2),
+// otherwise everything falls back to the scalar implementation.
+#ifdef MATHS_SIMD
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define MATHS_SSE
+#include <smmintrin.h>
+#endif
+#if defined(__AVX__)
+#define MATHS_AVX
+#include <immintrin.h>
+#endif
+#if defined(__AVX2__)
+#define MATHS_AVX2
+#endif
+// avx2 does not imply fma on gcc / clang (-mfma), msvc /arch:AVX2 enables both
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define MATHS_FMA
+#endif
+#endif
+
+// bmi2 is part of the opt-in simd, it is selected at runtime with cpu_supports_bmi2 so it does not need target
+// flags, define MATHS_NO_BMI2 to compile it out.
+#if defined(MATHS_SIMD) && !defined(MATHS_NO_BMI2) && (defined(__x86_64__) || defined(_M_X64))
+#define MATHS_BMI2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define maths_target_bmi2
+inline void maths_cpuid(int leaf, unsigned int* r)
+{
+    __cpuidex((int*)r, leaf, 0);
+}
+#else
+#include <cpuid.h>
+#define maths_target_bmi2 __attribute__((target("bmi2")))
+inline void maths_cpuid(int leaf, unsigned int* r)
+{
+    __cpuid_count(leaf, 0, r[0], r[1], r[2], r[3]);
+}
+#endif
+#endif
+
 #ifndef M_PI
 const double M_PI = 3.1415926535897932384626433832795;
 #endif
@@ -45,6 +89,9 @@ using std::max;
 using std::min;
 using std::swap;
 
+// float and double overloads of abs, otherwise unqualified abs can resolve to the int version from the c library
+using std::abs;
+
 template <typename T>
 maths_inline T sgn(T val)
 {
@@ -69,6 +116,13 @@ maths_inline T rsqrt(const T& x)
     return (T)1 / sqrt(x);
 }
 
+// a * b + c, the scalar counterpart of fmadd on Wide so lane functions can be written once for both
+template <class T>
+maths_inline T fmadd(const T& a, const T& b, const T& c)
+{
+    return a * b + c;
+}
+
 template <class T>
 maths_inline T min(T a1, T a2, T a3)
 {
@@ -377,6 +431,23 @@ maths_inline unsigned int round_down_to_power_of_two(unsigned int n)
     return 1 << exponent;
 }
 
+// integer hash with full avalanche (lowbias32 by chris wellons), every input bit affects every output bit so
+// sequential keys such as grid cell coordinates spread evenly over a power of 2 table
+maths_inline u32 hash_u32(u32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+maths_inline u32 hash_combine(u32 h, u32 v)
+{
+    return hash_u32(h ^ (v + 0x9e3779b9 + (h << 6) + (h >> 2)));
+}
+
 inline void morton_xy2d(u64 x, u64 y, u64 *d)
 {
     x = (x | (x << 16)) & 0x0000FFFF0000FFFF;
@@ -413,6 +484,217 @@ inline void morton_d2xy(u64 d, u64 &x, u64 &y)
     y = morton_1(d >> 1);
 }
 
+// morton_2 - spread the low 21 bits of x so there are 2 zero bits between each
+
+inline u64 morton_2(u64 x)
+{
+    x = x & 0x1FFFFF;
+    x = (x | (x << 32)) & 0x001F00000000FFFF;
+    x = (x | (x << 16)) & 0x001F0000FF0000FF;
+    x = (x | (x << 8))  & 0x100F00F00F00F00F;
+    x = (x | (x << 4))  & 0x10C30C30C30C30C3;
+    x = (x | (x << 2))  & 0x1249249249249249;
+    return x;
+}
+
+// morton_3 - extract every third bit
+
+inline u32 morton_3(u64 x)
+{
+    x = x & 0x1249249249249249;
+    x = (x | (x >> 2))  & 0x10C30C30C30C30C3;
+    x = (x | (x >> 4))  & 0x100F00F00F00F00F;
+    x = (x | (x >> 8))  & 0x001F0000FF0000FF;
+    x = (x | (x >> 16)) & 0x001F00000000FFFF;
+    x = (x | (x >> 32)) & 0x00000000001FFFFF;
+    return (uint32_t)x;
+}
+
+// 3d morton code interleaving 21 bits of x, y and z, x in the lowest bit
+
+inline void morton_xyz3d(u64 x, u64 y, u64 z, u64 *d)
+{
+    *d = morton_2(x) | (morton_2(y) << 1) | (morton_2(z) << 2);
+}
+
+inline void morton_d2xyz(u64 d, u64 &x, u64 &y, u64 &z)
+{
+    x = morton_3(d);
+    y = morton_3(d >> 1);
+    z = morton_3(d >> 2);
+}
+
+// 10 bit versions of morton_2 and morton_3 for 30 bit 3d codes in a u32, named apart from the u64 versions so
+// int arguments are not ambiguous
+
+inline u32 morton_2_10(u32 x)
+{
+    x = x & 0x3FF;
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x << 8))  & 0x0300F00F;
+    x = (x | (x << 4))  & 0x030C30C3;
+    x = (x | (x << 2))  & 0x09249249;
+    return x;
+}
+
+inline u32 morton_3_10(u32 x)
+{
+    x = x & 0x09249249;
+    x = (x | (x >> 2))  & 0x030C30C3;
+    x = (x | (x >> 4))  & 0x0300F00F;
+    x = (x | (x >> 8))  & 0x030000FF;
+    x = (x | (x >> 16)) & 0x000003FF;
+    return x;
+}
+
+inline void morton_xyz3d(u32 x, u32 y, u32 z, u32 *d)
+{
+    *d = morton_2_10(x) | (morton_2_10(y) << 1) | (morton_2_10(z) << 2);
+}
+
+inline void morton_d2xyz(u32 d, u32 &x, u32 &y, u32 &z)
+{
+    x = morton_3_10(d);
+    y = morton_3_10(d >> 1);
+    z = morton_3_10(d >> 2);
+}
+
+// hilbert curve using john skilling's transpose, the axes are converted in place to the "transposed" index where
+// X[0] holds the most significant bit of each 3 bit group, interleaving them gives the index. unlike morton order
+// consecutive indices are always neighbouring cells, which keeps sorted data more coherent.
+
+// if bit b of xi is set invert the bits of x0 below b, otherwise swap the bits below b between x0 and xi. branchless
+// as the bits are effectively random.
+maths_inline void hilbert_exchange(u64& x0, u64& xi, u32 b)
+{
+    u64 p = ((u64)1 << b) - 1;
+    u64 m = (u64)0 - ((xi >> b) & 1);
+    u64 t = (x0 ^ xi) & p & ~m;
+    x0 ^= (p & m) | t;
+    xi ^= t;
+}
+
+inline void hilbert_axes_to_transpose(u64* X, u32 bits)
+{
+    u64 x0 = X[0], x1 = X[1], x2 = X[2];
+    for (u32 b = bits - 1; b > 0; --b)
+    {
+        x0 ^= (((u64)1 << b) - 1) & ((u64)0 - ((x0 >> b) & 1));
+        hilbert_exchange(x0, x1, b);
+        hilbert_exchange(x0, x2, b);
+    }
+
+    // gray encode, t is the prefix xor of the bits of x2 above each bit
+    x1 ^= x0;
+    x2 ^= x1;
+    u64 t = x2 >> 1;
+    t ^= t >> 1;
+    t ^= t >> 2;
+    t ^= t >> 4;
+    t ^= t >> 8;
+    t ^= t >> 16;
+    t ^= t >> 32;
+
+    X[0] = x0 ^ t;
+    X[1] = x1 ^ t;
+    X[2] = x2 ^ t;
+}
+
+inline void hilbert_transpose_to_axes(u64* X, u32 bits)
+{
+    u64 x0 = X[0], x1 = X[1], x2 = X[2];
+    u64 t = x2 >> 1;
+    x2 ^= x1;
+    x1 ^= x0;
+    x0 ^= t;
+
+    for (u32 b = 1; b < bits; ++b)
+    {
+        hilbert_exchange(x0, x2, b);
+        hilbert_exchange(x0, x1, b);
+        x0 ^= (((u64)1 << b) - 1) & ((u64)0 - ((x0 >> b) & 1));
+    }
+
+    X[0] = x0;
+    X[1] = x1;
+    X[2] = x2;
+}
+
+// 3d hilbert index of x, y, z with bits per axis, 21 max for u64 and 10 max for u32
+
+inline void hilbert_xyz3d(u64 x, u64 y, u64 z, u64 *d, u32 bits = 21)
+{
+    u64 X[3] = {x, y, z};
+    hilbert_axes_to_transpose(X, bits);
+    morton_xyz3d(X[2], X[1], X[0], d);
+}
+
+inline void hilbert_d2xyz(u64 d, u64 &x, u64 &y, u64 &z, u32 bits = 21)
+{
+    u64 X[3];
+    morton_d2xyz(d, X[2], X[1], X[0]);
+    hilbert_transpose_to_axes(X, bits);
+    x = X[0];
+    y = X[1];
+    z = X[2];
+}
+
+inline void hilbert_xyz3d(u32 x, u32 y, u32 z, u32 *d, u32 bits = 10)
+{
+    u64 d64;
+    hilbert_xyz3d((u64)x, (u64)y, (u64)z, &d64, bits);
+    *d = (u32)d64;
+}
+
+inline void hilbert_d2xyz(u32 d, u32 &x, u32 &y, u32 &z, u32 bits = 10)
+{
+    u64 x64, y64, z64;
+    hilbert_d2xyz((u64)d, x64, y64, z64, bits);
+    x = (u32)x64;
+    y = (u32)y64;
+    z = (u32)z64;
+}
+
+// bmi2 pdep / pext versions of the 3d morton interleave. these are compiled for bmi2 regardless of the target flags
+// so only call them when cpu_supports_bmi2() is true, batch functions check once and pick a loop.
+#ifdef MATHS_BMI2
+inline maths_target_bmi2 u64 morton_xyz3d_bmi2(u64 x, u64 y, u64 z)
+{
+    return _pdep_u64(x, 0x1249249249249249) | _pdep_u64(y, 0x2492492492492492) | _pdep_u64(z, 0x4924924924924924);
+}
+
+inline maths_target_bmi2 void morton_d2xyz_bmi2(u64 d, u64 &x, u64 &y, u64 &z)
+{
+    x = _pext_u64(d, 0x1249249249249249);
+    y = _pext_u64(d, 0x2492492492492492);
+    z = _pext_u64(d, 0x4924924924924924);
+}
+
+// pdep and pext are microcoded on amd before zen 3 and much slower than the shift and mask versions there
+inline bool cpu_supports_bmi2()
+{
+    static const bool supported = []() {
+        u32 r[4];
+        maths_cpuid(0, r);
+        if (r[0] < 7)
+            return false;
+        bool amd = r[1] == 0x68747541; // "Auth"
+        maths_cpuid(1, r);
+        u32 family = ((r[0] >> 8) & 0xf) + ((r[0] >> 20) & 0xff);
+        if (amd && family < 0x19)
+            return false;
+        maths_cpuid(7, r);
+        return (r[1] & (1 << 8)) != 0;
+    }();
+    return supported;
+}
+#else
+inline bool cpu_supports_bmi2()
+{
+    return false;
+}
+#endif
+
 inline int intlog2(int x)
 {
     int exp = -1;
@@ -103,6 +103,25 @@ struct Vec
 
 #include "swizzle.h"
 
+// simd register aliased with the components of a vec, only present when MATHS_SIMD is enabled and supported
+struct simd_none
+{
+};
+
+template <size_t N, typename T>
+struct vec_simd
+{
+    typedef simd_none type;
+};
+
+#ifdef MATHS_SSE
+template <>
+struct vec_simd<4, float>
+{
+    typedef __m128 type;
+};
+#endif
+
 // Template specialisations for 2, 3, 4
 template <typename T>
 struct Vec<2, T>
@@ -372,6 +391,7 @@ struct Vec<4, T>
             T r, g, b, a;
         };
         swizzle_v4;
+        typename vec_simd<4, T>::type simd;
     };
 
     Vec<4, T>(void)
@@ -541,6 +561,88 @@ struct Vec<4, T>
     }
 };
 
+// vec3 padded to 4 components and aligned to 16 bytes so it can be loaded into a simd register.
+// the padding is kept at zero, arithmetic is performed via Vec<4, T> so it takes the simd paths when enabled
+template <typename T>
+struct alignas(16) Vec3a
+{
+    union {
+        T v[3];
+        struct
+        {
+            T x, y, z;
+        };
+        struct
+        {
+            T r, g, b;
+        };
+        swizzle_v3;
+        T padded[4];
+        typename vec_simd<4, T>::type simd;
+    };
+
+    Vec3a<T>(void)
+    {
+        padded[3] = 0;
+    }
+
+    Vec3a<T>(T value_for_all)
+    {
+        for (size_t i = 0; i < 3; ++i)
+            v[i] = value_for_all;
+        padded[3] = 0;
+    }
+
+    Vec3a<T>(T v0, T v1, T v2)
+    {
+        v[0] = v0;
+        v[1] = v1;
+        v[2] = v2;
+        padded[3] = 0;
+    }
+
+    Vec3a<T>(const Vec<3, T>& v3)
+    {
+        for (size_t i = 0; i < 3; ++i)
+            v[i] = v3[i];
+        padded[3] = 0;
+    }
+
+    template<typename T2, size_t W, size_t... SW>
+    Vec3a<T>(const Swizzle<T2, W, SW...>& lhs)
+    {
+        size_t ii[] = {SW...};
+        for(size_t i = 0; i < sizeof...(SW); ++i)
+            v[i] = lhs.v[ii[i]];
+        padded[3] = 0;
+    }
+
+    operator Vec<3, T>() const
+    {
+        return Vec<3, T>(v[0], v[1], v[2]);
+    }
+
+    T& operator[](size_t index)
+    {
+        return v[index];
+    }
+
+    const T& operator[](size_t index) const
+    {
+        return v[index];
+    }
+
+    inline static Vec3a<T> one()
+    {
+        return Vec3a<T>(1, 1, 1);
+    }
+
+    inline static Vec3a<T> zero()
+    {
+        return Vec3a<T>(0, 0, 0);
+    }
+};
+
 //
 // operators
 //
@@ -784,13 +886,20 @@ maths_inline T component_wise_max(const Vec<N, T>& v)
 template <size_t N, typename T>
 maths_inline Vec<N, T> lerp(const Vec<N, T>& value0, const Vec<N, T>& value1, T f)
 {
-    return value0 * (1 - f) + value1 * f;
+    Vec<N, T> res;
+    T         f0 = 1 - f;
+    for (size_t i = 0; i < N; ++i)
+        res.v[i] = value0.v[i] * f0 + value1.v[i] * f;
+    return res;
 }
 
 template <size_t N, typename T>
 maths_inline Vec<N, T> lerp(const Vec<N, T>& value0, const Vec<N, T>& value1, const Vec<N, T>& f)
 {
-    return value0 * (1 - f) + value1 * f;
+    Vec<N, T> res;
+    for (size_t i = 0; i < N; ++i)
+        res.v[i] = value0.v[i] * (1 - f.v[i]) + value1.v[i] * f.v[i];
+    return res;
 }
 
 template <size_t N, typename T>
@@ -1207,6 +1316,447 @@ maths_inline void update_minmax(const Vec<N, T>& x, Vec<N, T>& xmin, Vec<N, T>&
         update_minmax(x[i], xmin[i], xmax[i]);
 }
 
+//
+// simd specialisations, enabled by MATHS_SIMD and fall back to the scalar templates above otherwise
+//
+
+#define VEC4_SIMD_OPS(T, LOAD, STORE, SPLAT, ADD, SUB, MUL, DIV, MIN, MAX)                      \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator+=(Vec<4, T>& lhs, const Vec<4, T>& rhs)                        \
+{                                                                                               \
+    STORE(lhs, ADD(LOAD(lhs), LOAD(rhs)));                                                      \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator+(const Vec<4, T>& lhs, const Vec<4, T>& rhs)                    \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, ADD(LOAD(lhs), LOAD(rhs)));                                                        \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator-=(Vec<4, T>& lhs, const Vec<4, T>& rhs)                        \
+{                                                                                               \
+    STORE(lhs, SUB(LOAD(lhs), LOAD(rhs)));                                                      \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator-(const Vec<4, T>& lhs, const Vec<4, T>& rhs)                    \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, SUB(LOAD(lhs), LOAD(rhs)));                                                        \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator-(const Vec<4, T>& rhs)                                          \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MUL(LOAD(rhs), SPLAT((T)-1)));                                                     \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator*=(Vec<4, T>& lhs, const Vec<4, T>& rhs)                        \
+{                                                                                               \
+    STORE(lhs, MUL(LOAD(lhs), LOAD(rhs)));                                                      \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator*(const Vec<4, T>& lhs, const Vec<4, T>& rhs)                    \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MUL(LOAD(lhs), LOAD(rhs)));                                                        \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator/=(Vec<4, T>& lhs, const Vec<4, T>& rhs)                        \
+{                                                                                               \
+    STORE(lhs, DIV(LOAD(lhs), LOAD(rhs)));                                                      \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator/(const Vec<4, T>& lhs, const Vec<4, T>& rhs)                    \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, DIV(LOAD(lhs), LOAD(rhs)));                                                        \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator+=(Vec<4, T>& lhs, T a)                                         \
+{                                                                                               \
+    STORE(lhs, ADD(LOAD(lhs), SPLAT(a)));                                                       \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator+(const Vec<4, T>& lhs, T a)                                     \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, ADD(LOAD(lhs), SPLAT(a)));                                                         \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator-=(Vec<4, T>& lhs, T a)                                         \
+{                                                                                               \
+    STORE(lhs, SUB(LOAD(lhs), SPLAT(a)));                                                       \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator-(const Vec<4, T>& lhs, T a)                                     \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, SUB(LOAD(lhs), SPLAT(a)));                                                         \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator*=(Vec<4, T>& lhs, T a)                                         \
+{                                                                                               \
+    STORE(lhs, MUL(LOAD(lhs), SPLAT(a)));                                                       \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator*(const Vec<4, T>& lhs, T a)                                     \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MUL(LOAD(lhs), SPLAT(a)));                                                         \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator*(T a, const Vec<4, T>& rhs)                                     \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MUL(SPLAT(a), LOAD(rhs)));                                                         \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T>& operator/=(Vec<4, T>& lhs, T a)                                         \
+{                                                                                               \
+    STORE(lhs, DIV(LOAD(lhs), SPLAT(a)));                                                       \
+    return lhs;                                                                                 \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> operator/(const Vec<4, T>& lhs, T a)                                     \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, DIV(LOAD(lhs), SPLAT(a)));                                                         \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> min_union(const Vec<4, T>& a, const Vec<4, T>& b)                        \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MIN(LOAD(a), LOAD(b)));                                                            \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> max_union(const Vec<4, T>& a, const Vec<4, T>& b)                        \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MAX(LOAD(a), LOAD(b)));                                                            \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> lerp(const Vec<4, T>& value0, const Vec<4, T>& value1, T f)              \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, ADD(MUL(LOAD(value0), SPLAT(1 - f)), MUL(LOAD(value1), SPLAT(f))));                \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> clamp(const Vec<4, T>& a, T lower, T upper)                              \
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MIN(MAX(LOAD(a), SPLAT(lower)), SPLAT(upper)));                                    \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> clamp(const Vec<4, T>& a, const Vec<4, T>& lower, const Vec<4, T>& upper)\
+{                                                                                               \
+    Vec<4, T> r;                                                                                \
+    STORE(r, MIN(MAX(LOAD(a), LOAD(lower)), LOAD(upper)));                                      \
+    return r;                                                                                   \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline T mag2(const Vec<4, T>& a)                                                         \
+{                                                                                               \
+    return dot(a, a);                                                                           \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline T dist2(const Vec<4, T>& a, const Vec<4, T>& b)                                    \
+{                                                                                               \
+    Vec<4, T> d = a - b;                                                                        \
+    return dot(d, d);                                                                           \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> normalised(const Vec<4, T>& a)                                           \
+{                                                                                               \
+    return a / (T)sqrt(dot(a, a));                                                              \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline Vec<4, T> normalized(const Vec<4, T>& a)                                           \
+{                                                                                               \
+    return a / (T)sqrt(dot(a, a));                                                              \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline void normalise(Vec<4, T>& a)                                                       \
+{                                                                                               \
+    a /= (T)sqrt(dot(a, a));                                                                    \
+}                                                                                               \
+template <>                                                                                     \
+maths_inline void normalize(Vec<4, T>& a)                                                       \
+{                                                                                               \
+    a /= (T)sqrt(dot(a, a));                                                                    \
+}
+
+#ifdef MATHS_SSE
+#define VEC4F_LOAD(V) (V).simd
+#define VEC4F_STORE(V, R) (V).simd = (R)
+
+template <>
+maths_inline f32 dot(const Vec<4, f32>& a, const Vec<4, f32>& b)
+{
+    return _mm_cvtss_f32(_mm_dp_ps(a.simd, b.simd, 0xff));
+}
+
+VEC4_SIMD_OPS(f32, VEC4F_LOAD, VEC4F_STORE, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_div_ps, _mm_min_ps,
+              _mm_max_ps);
+#endif
+
+#ifdef MATHS_AVX
+// vec4d has no register in its union to avoid requiring 32 byte aligned allocations, it uses unaligned loads instead
+#define VEC4D_LOAD(V) _mm256_loadu_pd((V).v)
+#define VEC4D_STORE(V, R) _mm256_storeu_pd((V).v, (R))
+
+template <>
+maths_inline f64 dot(const Vec<4, f64>& a, const Vec<4, f64>& b)
+{
+    __m256d m = _mm256_mul_pd(_mm256_loadu_pd(a.v), _mm256_loadu_pd(b.v));
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+VEC4_SIMD_OPS(f64, VEC4D_LOAD, VEC4D_STORE, _mm256_set1_pd, _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_div_pd,
+              _mm256_min_pd, _mm256_max_pd);
+#endif
+
+//
+// vec3a, padded vec3 operations performed through Vec<4, T>
+//
+
+template <typename T>
+maths_inline Vec<4, T> to_vec4(const Vec3a<T>& a)
+{
+    return Vec<4, T>(a.padded[0], a.padded[1], a.padded[2], a.padded[3]);
+}
+
+template <typename T>
+maths_inline Vec3a<T> to_vec3a(const Vec<4, T>& a)
+{
+    Vec3a<T> r;
+    for (size_t i = 0; i < 4; ++i)
+        r.padded[i] = a.v[i];
+    return r;
+}
+
+#ifdef MATHS_SSE
+template <>
+maths_inline Vec<4, f32> to_vec4(const Vec3a<f32>& a)
+{
+    Vec<4, f32> r;
+    r.simd = a.simd;
+    return r;
+}
+
+template <>
+maths_inline Vec3a<f32> to_vec3a(const Vec<4, f32>& a)
+{
+    Vec3a<f32> r;
+    r.simd = a.simd;
+    return r;
+}
+#endif
+
+#define VEC3A_OP(OP)                                                                \
+template <typename T>                                                               \
+maths_inline Vec3a<T> operator OP(const Vec3a<T>& lhs, const Vec3a<T>& rhs)         \
+{                                                                                   \
+    return to_vec3a(to_vec4(lhs) OP to_vec4(rhs));                                  \
+}                                                                                   \
+template <typename T>                                                               \
+maths_inline Vec3a<T>& operator OP##=(Vec3a<T>& lhs, const Vec3a<T>& rhs)           \
+{                                                                                   \
+    lhs = to_vec3a(to_vec4(lhs) OP to_vec4(rhs));                                   \
+    return lhs;                                                                     \
+}
+
+VEC3A_OP(+);
+VEC3A_OP(-);
+VEC3A_OP(*);
+
+// the padding is 0 so division needs a non zero divisor for w, scalar add / subtract need a zero w
+template <typename T>
+maths_inline Vec3a<T> operator/(const Vec3a<T>& lhs, const Vec3a<T>& rhs)
+{
+    Vec<4, T> d = to_vec4(rhs);
+    d.w = 1;
+    return to_vec3a(to_vec4(lhs) / d);
+}
+
+template <typename T>
+maths_inline Vec3a<T>& operator/=(Vec3a<T>& lhs, const Vec3a<T>& rhs)
+{
+    lhs = lhs / rhs;
+    return lhs;
+}
+
+template <typename T>
+maths_inline Vec3a<T> operator+(const Vec3a<T>& lhs, T a)
+{
+    return lhs + Vec3a<T>(a);
+}
+
+template <typename T>
+maths_inline Vec3a<T> operator-(const Vec3a<T>& lhs, T a)
+{
+    return lhs - Vec3a<T>(a);
+}
+
+template <typename T>
+maths_inline Vec3a<T> operator*(const Vec3a<T>& lhs, T a)
+{
+    return to_vec3a(to_vec4(lhs) * a);
+}
+
+template <typename T>
+maths_inline Vec3a<T> operator*(T a, const Vec3a<T>& rhs)
+{
+    return to_vec3a(to_vec4(rhs) * a);
+}
+
+template <typename T>
+maths_inline Vec3a<T> operator/(const Vec3a<T>& lhs, T a)
+{
+    return to_vec3a(to_vec4(lhs) / a);
+}
+
+template <typename T>
+maths_inline Vec3a<T>& operator*=(Vec3a<T>& lhs, T a)
+{
+    lhs = lhs * a;
+    return lhs;
+}
+
+template <typename T>
+maths_inline Vec3a<T>& operator/=(Vec3a<T>& lhs, T a)
+{
+    lhs = lhs / a;
+    return lhs;
+}
+
+template <typename T>
+maths_inline Vec3a<T> operator-(const Vec3a<T>& rhs) // unary minus
+{
+    return to_vec3a(-to_vec4(rhs));
+}
+
+template <typename T>
+maths_inline T dot(const Vec3a<T>& a, const Vec3a<T>& b)
+{
+    return dot(to_vec4(a), to_vec4(b));
+}
+
+template <typename T>
+maths_inline T mag2(const Vec3a<T>& a)
+{
+    return dot(a, a);
+}
+
+template <typename T>
+maths_inline T mag(const Vec3a<T>& a)
+{
+    return sqrt(dot(a, a));
+}
+
+template <typename T>
+maths_inline T dist2(const Vec3a<T>& a, const Vec3a<T>& b)
+{
+    return mag2(a - b);
+}
+
+template <typename T>
+maths_inline T dist(const Vec3a<T>& a, const Vec3a<T>& b)
+{
+    return sqrt(mag2(a - b));
+}
+
+template <typename T>
+maths_inline Vec3a<T> normalised(const Vec3a<T>& a)
+{
+    return to_vec3a(normalised(to_vec4(a)));
+}
+
+template <typename T>
+maths_inline Vec3a<T> normalized(const Vec3a<T>& a)
+{
+    return to_vec3a(normalised(to_vec4(a)));
+}
+
+template <typename T>
+maths_inline void normalise(Vec3a<T>& a)
+{
+    a = normalised(a);
+}
+
+template <typename T>
+maths_inline void normalize(Vec3a<T>& a)
+{
+    a = normalised(a);
+}
+
+template <typename T>
+maths_inline Vec3a<T> min_union(const Vec3a<T>& a, const Vec3a<T>& b)
+{
+    return to_vec3a(min_union(to_vec4(a), to_vec4(b)));
+}
+
+template <typename T>
+maths_inline Vec3a<T> max_union(const Vec3a<T>& a, const Vec3a<T>& b)
+{
+    return to_vec3a(max_union(to_vec4(a), to_vec4(b)));
+}
+
+template <typename T>
+maths_inline Vec3a<T> lerp(const Vec3a<T>& value0, const Vec3a<T>& value1, T f)
+{
+    return to_vec3a(lerp(to_vec4(value0), to_vec4(value1), f));
+}
+
+template <typename T>
+maths_inline Vec3a<T> clamp(const Vec3a<T>& a, T lower, T upper)
+{
+    Vec3a<T> r = to_vec3a(clamp(to_vec4(a), lower, upper));
+    r.padded[3] = 0;
+    return r;
+}
+
+template <typename T>
+maths_inline Vec3a<T> cross(const Vec3a<T>& a, const Vec3a<T>& b)
+{
+    return Vec3a<T>(cross((Vec<3, T>)a, (Vec<3, T>)b));
+}
+
+#ifdef MATHS_SSE
+template <>
+maths_inline Vec3a<f32> cross(const Vec3a<f32>& a, const Vec3a<f32>& b)
+{
+    __m128 a_yzx = _mm_shuffle_ps(a.simd, a.simd, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b_yzx = _mm_shuffle_ps(b.simd, b.simd, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c     = _mm_sub_ps(_mm_mul_ps(a.simd, b_yzx), _mm_mul_ps(a_yzx, b.simd));
+
+    Vec3a<f32> r;
+    r.simd = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    return r;
+}
+#endif
+
 //
 // vec functions of cmath, performing component wise op
 //
@@ -1286,10 +1836,14 @@ typedef Vec<4, unsigned short> Vec4us;
 typedef Vec<4, char>           Vec4c;
 typedef Vec<4, unsigned char>  Vec4uc;
 
+typedef Vec3a<float>           Vec3fa;
+typedef Vec3a<double>          Vec3da;
+
 typedef Vec2i   vec2i;
 typedef Vec2f   vec2f;
 typedef Vec3f   vec3f;
 typedef Vec3d   vec3d;
+typedef Vec3fa  vec3fa;
 typedef Vec3ui  vec3ui;
 typedef Vec3i   vec3i;
 typedef Vec4f   vec4f;